@@ -1,6 +1,7 @@
 #pragma once
 
 #include "types.hpp"
+#include <chrono>
 #include <cstring>
 
 // Do not compile on systems with non-8-bit bytes
@@ -22,6 +23,12 @@ constexpr uint64_t FooterLength = /* opcode */ 1 +
                                   /* summary crc */ 4 +
                                   /* magic bytes */ sizeof(Magic);
 
+inline uint64_t SteadyClockNs() {
+  return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count());
+}
+
 inline std::string ToHex(uint8_t byte) {
   std::string result{2, '\0'};
   result[0] = "0123456789ABCDEF"[(uint8_t(byte) >> 4) & 0x0F];
@@ -2,6 +2,7 @@
 
 #include "intervaltree.hpp"
 #include "read_job_queue.hpp"
+#include "thread_pool.hpp"
 #include "types.hpp"
 #include "visibility.hpp"
 #include <cstdio>
@@ -37,6 +38,14 @@ enum struct ReadSummaryMethod {
   ForceScan,
 };
 
+/**
+ * @brief Bytes of an IReadable from `start` to `end` (excluded).
+ */
+struct MCAP_PUBLIC ByteRange {
+  ByteOffset start = 0;
+  ByteOffset end = 0;
+};
+
 /**
  * @brief An abstract interface for reading MCAP data.
  */
@@ -66,6 +75,25 @@ struct MCAP_PUBLIC IReadable {
    *   method should return 0.
    */
   virtual uint64_t read(std::byte** output, uint64_t offset, uint64_t size) = 0;
+  /**
+   * @brief Returns true if the pointers returned by `read()` remain valid for
+   * the lifetime of this object, rather than only until the next call to
+   * `read()`. Readers can then refer to the data in place instead of copying
+   * it, for example when the whole file is in memory or memory-mapped. Such
+   * sources must also support concurrent calls to `read()`.
+   */
+  virtual bool stablePointers() const {
+    return false;
+  }
+  /**
+   * @brief Hint that `ranges` are going to be read next, in this order, e.g. the chunks that a
+   * `ChunkPrefetcher` is going to take. Sources that can read ahead of time, without blocking
+   * the caller, start doing so; the default does nothing. Each call replaces the previous
+   * hint.
+   */
+  virtual void willRead(const std::vector<ByteRange>& ranges) {
+    (void)ranges;
+  }
 };
 
 /**
@@ -138,6 +166,9 @@ public:
   uint64_t read(std::byte** output, uint64_t offset, uint64_t size) override;
   uint64_t size() const override;
   Status status() const override;
+  bool stablePointers() const override {
+    return true;
+  }
 
   BufferReader() = default;
   BufferReader(const BufferReader&) = delete;
@@ -248,6 +279,13 @@ public:
    * if not provided, messages from all channels are provided.
    */
   std::function<bool(std::string_view)> topicFilter;
+  /**
+   * @brief If provided, `channelFilter` is called with the channel id of each message (or once per
+   * channel when reading in log time order), before its channel is looked up. Messages are only
+   * included if it returns true. Unlike `topicFilter`, it tells apart channels sharing a topic,
+   * and involves no string. Both filters apply when both are provided.
+   */
+  std::function<bool(ChannelId)> channelFilter;
   enum struct ReadOrder { FileOrder, LogTimeOrder, ReverseLogTimeOrder };
   /**
    * @brief Set the expected order that messages should be returned in.
@@ -256,6 +294,23 @@ public:
    * if readOrder == ReverseLogTimeOrder, messages will be returned in descending log time order.
    */
   ReadOrder readOrder = ReadOrder::FileOrder;
+  /**
+   * @brief Number of chunks read and decompressed ahead of time on background threads, when
+   * reading in log time order. Zero (the default) decompresses each chunk when its first message
+   * is needed, on the calling thread. Each read-ahead chunk is held in memory twice, compressed and
+   * uncompressed.
+   */
+  size_t readAheadChunks = 0;
+  /**
+   * @brief Number of threads decompressing read-ahead chunks. Zero means one per read-ahead
+   * chunk, up to the number of cores.
+   */
+  unsigned decompressionThreads = 0;
+  /**
+   * @brief Called after each compressed Chunk is decompressed, with the time it took. Chunks
+   * decompressed ahead of time report from the decompression threads.
+   */
+  ChunkCodecCallback onChunkDecompressed;
 
   ReadMessageOptions(Timestamp start, Timestamp end)
       : startTime(start)
@@ -319,11 +374,32 @@ public:
    * available. This will populate internal indexes to allow for efficient
    * summarization and random access. This method will automatically be called
    * upon requesting summary data or first seek if Summary section parsing is
-   * allowed by the configuration options.
+   * allowed by the configuration options. A scan lists in the Chunk Indexes the
+   * Message Index records that directly follow each Chunk, so that a file
+   * without Summary section can still be read in log time order if it has them.
    */
   Status readSummary(
     ReadSummaryMethod method, const ProblemCallback& onProblem = [](const Status&) {});
 
+  /**
+   * @brief Set the number of threads scanning the Data section when `readSummary()` falls back
+   * to a scan. The section is split in regions that are scanned concurrently, starting at Chunk
+   * records found near the region boundaries, and the result is the same as a sequential scan.
+   * Zero or one scans sequentially. Data sources without stable pointers (see
+   * `IReadable::stablePointers()`) are always scanned sequentially.
+   */
+  void setScanThreads(unsigned threads);
+
+  /**
+   * @brief Read the Summary section of another MCAP file instead of scanning this one, e.g. a
+   * cache of a previous scan. Its Chunk, Attachment and Metadata indexes must refer to offsets
+   * in this file.
+   *
+   * @param summarySource An MCAP file made of a Summary section describing this file.
+   * @param dataEnd The end of this file's Data section, see `dataEnd()`.
+   */
+  Status readSummaryFrom(IReadable& summarySource, ByteOffset dataEnd);
+
   /**
    * @brief Returns an iterable view with `begin()` and `end()` methods for
    * iterating Messages in the MCAP file. If a non-zero `startTime` is provided,
@@ -398,6 +474,12 @@ public:
    */
   const std::optional<Statistics>& statistics() const;
 
+  /**
+   * @brief Returns the end of the Data section: the Data End record if `readSummary()` found
+   * one, or else the start of the Summary section, or the end of the file.
+   */
+  ByteOffset dataEnd() const;
+
   /**
    * @brief Returns all of the parsed Channel records. Call `readSummary()`
    * first to fully populate this data structure.
@@ -432,6 +514,13 @@ public:
    */
   const std::vector<ChunkIndex>& chunkIndexes() const;
 
+  /**
+   * @brief Returns all of the parsed AttachmentIndex records. Call `readSummary()`
+   * first to fully populate this data structure.
+   * The multimap's keys are the `name` field from each indexed Attachment.
+   */
+  const std::multimap<std::string, AttachmentIndex>& attachmentIndexes() const;
+
   /**
    * @brief Returns all of the parsed MetadataIndex records. Call `readSummary()`
    * first to fully populate this data structure.
@@ -489,8 +578,10 @@ private:
   Timestamp startTime_ = 0;
   Timestamp endTime_ = 0;
   bool parsedSummary_ = false;
+  unsigned scanThreads_ = 0;
 
   void reset_();
+  void indexChunks_();
   Status readSummarySection_(IReadable& reader);
   Status readSummaryFromScan_(IReadable& reader);
 };
@@ -573,6 +664,7 @@ struct MCAP_PUBLIC TypedRecordReader {
   std::function<void(const DataEnd&, ByteOffset)> onDataEnd;
   std::function<void(const Record&, ByteOffset, std::optional<ByteOffset>)> onUnknownRecord;
   std::function<void(ByteOffset)> onChunkEnd;
+  ChunkCodecCallback onChunkDecompressed;
 
   TypedRecordReader(IReadable& dataSource, ByteOffset startOffset,
                     ByteOffset endOffset = EndOffset);
@@ -595,6 +687,111 @@ private:
   bool parsingChunk_;
 };
 
+/**
+ * @brief A Chunk record and the Message Index records following it, read by ChunkPrefetcher.
+ */
+struct MCAP_PUBLIC PrefetchedChunk {
+  /**
+   * @brief The bytes of the Chunk record followed by its Message Index records, as found in the
+   * file. Points into the data source if it has stable pointers, or into `recordsBuffer`.
+   */
+  const std::byte* records = nullptr;
+  uint64_t recordsSize = 0;
+  /**
+   * @brief The parsed Chunk record. `chunk.records` points into `records`.
+   */
+  Chunk chunk;
+  /**
+   * @brief The uncompressed records of the chunk, if decompression was requested. Uncompressed
+   * chunks are not copied, so this points into `records` for them.
+   */
+  const std::byte* uncompressedRecords = nullptr;
+  uint64_t uncompressedSize = 0;
+  /**
+   * @brief The result of reading, parsing and decompressing the chunk.
+   */
+  Status status;
+
+  /**
+   * @brief Storage for `records` and `uncompressedRecords`, when they need one.
+   */
+  ByteArray recordsBuffer;
+  ByteArray uncompressedBuffer;
+};
+
+/**
+ * @brief Reads chunks ahead of the caller and decompresses them on a pool of threads. The data
+ * source is only read from the thread calling `take()`, so it does not need to be thread safe.
+ */
+class MCAP_PUBLIC ChunkPrefetcher {
+public:
+  struct Request {
+    ByteOffset chunkStartOffset = 0;
+    /**
+     * @brief End of the Message Index records following the chunk. Use the end of the Chunk
+     * record to read the chunk alone.
+     */
+    ByteOffset messageIndexEndOffset = 0;
+    bool decompress = true;
+  };
+
+  /**
+   * @brief Create a prefetcher.
+   *
+   * @param dataSource Where the chunks are read from.
+   * @param requests The chunks in the order they are expected to be taken.
+   * @param readAhead Maximum number of chunks read before they are taken. Zero reads and
+   *   decompresses every chunk in `take()`.
+   * @param threadCount Number of decompression threads. Zero means one per read-ahead chunk, up
+   *   to the number of cores.
+   * @param onDecompressed Optional, see `ReadMessageOptions::onChunkDecompressed`.
+   */
+  ChunkPrefetcher(IReadable& dataSource, std::vector<Request> requests, size_t readAhead,
+                  unsigned threadCount = 0, ChunkCodecCallback onDecompressed = {});
+  ~ChunkPrefetcher();
+
+  ChunkPrefetcher(const ChunkPrefetcher&) = delete;
+  ChunkPrefetcher& operator=(const ChunkPrefetcher&) = delete;
+
+  /**
+   * @brief Returns the requested chunk, waiting for its decompression if needed. Chunks taken
+   * out of the expected order, or unknown to the prefetcher, are read synchronously.
+   */
+  std::unique_ptr<PrefetchedChunk> take(const Request& request);
+
+  /**
+   * @brief Give a chunk back, so that its buffers are reused for the next ones.
+   */
+  void recycle(std::unique_ptr<PrefetchedChunk> chunk);
+
+  /**
+   * @brief Decompress `chunk` into `output`. Safe to call from multiple threads at once.
+   * `onDecompressed` is called if the chunk is compressed.
+   */
+  static Status DecompressChunk(const Chunk& chunk, ByteArray* output,
+                                const ChunkCodecCallback& onDecompressed = {});
+
+private:
+  struct InFlight {
+    std::unique_ptr<PrefetchedChunk> chunk;
+    std::future<void> decompressed;
+  };
+
+  IReadable& dataSource_;
+  std::vector<Request> requests_;
+  size_t nextRequest_ = 0;
+  size_t readAhead_ = 0;
+  ChunkCodecCallback onDecompressed_;
+  std::unordered_map<ByteOffset, InFlight> inFlight_;
+  std::unordered_set<ByteOffset> taken_;
+  std::vector<std::unique_ptr<PrefetchedChunk>> recycled_;
+  // Declared last, so that its threads are joined before the chunks they work on are destroyed
+  std::unique_ptr<internal::ThreadPool> pool_;
+
+  void readAhead();
+  InFlight read(const Request& request);
+};
+
 /**
  * @brief Uses message indices to read messages out of an MCAP in log time order.
  * The underlying MCAP must be chunked, with a summary section and message indexes.
@@ -627,6 +824,10 @@ public:
 private:
   struct ChunkSlot {
     ByteArray decompressedChunk;
+    // The uncompressed records: decompressedChunk, or a view into the data source or prefetched
+    const std::byte* data = nullptr;
+    uint64_t size = 0;
+    std::unique_ptr<PrefetchedChunk> prefetched;
     ByteOffset chunkStartOffset;
     int unreadMessages = 0;
   };
@@ -635,14 +836,12 @@ private:
   Status status_;
   McapReader& mcapReader_;
   RecordReader recordReader_;
-#ifndef MCAP_COMPRESSION_NO_LZ4
-  LZ4Reader lz4Reader_;
-#endif
   ReadMessageOptions options_;
   std::unordered_set<ChannelId> selectedChannels_;
   std::function<void(const Message&, RecordOffset)> onMessage_;
   internal::ReadJobQueue queue_;
   std::vector<ChunkSlot> chunkSlots_;
+  std::unique_ptr<ChunkPrefetcher> prefetcher_;
 };
 
 /**
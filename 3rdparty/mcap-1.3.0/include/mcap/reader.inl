@@ -1,6 +1,11 @@
 #include "internal.hpp"
+#include "thread_pool.hpp"
 #include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <tuple>
 #ifndef MCAP_COMPRESSION_NO_LZ4
 #  include <lz4frame.h>
 #endif
@@ -359,6 +364,7 @@ void McapReader::reset_() {
   statistics_ = std::nullopt;
   chunkIndexes_.clear();
   attachmentIndexes_.clear();
+  metadataIndexes_.clear();
   schemas_.clear();
   channels_.clear();
   dataStart_ = 0;
@@ -400,6 +406,29 @@ Status McapReader::readSummary(ReadSummaryMethod method, const ProblemCallback&
     }
   }
 
+  indexChunks_();
+  return StatusCode::Success;
+}
+
+Status McapReader::readSummaryFrom(IReadable& summarySource, ByteOffset dataEnd) {
+  if (!input_) {
+    return StatusCode::NotOpen;
+  }
+
+  // The Footer of this file, if any, is kept
+  const auto footer = footer_;
+  const auto status = readSummarySection_(summarySource);
+  footer_ = footer;
+  dataEnd_ = dataEnd;
+  if (!status.ok()) {
+    return status;
+  }
+
+  indexChunks_();
+  return StatusCode::Success;
+}
+
+void McapReader::indexChunks_() {
   // Convert the list of chunk indexes to an interval tree indexed by message start/end times
   std::vector<ChunkInterval> chunkIntervals;
   chunkIntervals.reserve(chunkIndexes_.size());
@@ -409,7 +438,6 @@ Status McapReader::readSummary(ReadSummaryMethod method, const ProblemCallback&
   chunkRanges_ = internal::IntervalTree<ByteOffset, ChunkIndex>{std::move(chunkIntervals)};
 
   parsedSummary_ = true;
-  return StatusCode::Success;
 }
 
 Status McapReader::readSummarySection_(IReadable& reader) {
@@ -486,31 +514,57 @@ Status McapReader::readSummarySection_(IReadable& reader) {
   return readStatistics ? StatusCode::Success : StatusCode::MissingStatistics;
 }
 
-Status McapReader::readSummaryFromScan_(IReadable& reader) {
-  bool done = false;
+namespace internal {
+
+/**
+ * @brief What the scan of a part of the Data section found, see `ScanDataRegion()`.
+ */
+struct ScanRegion {
+  ByteOffset start = 0;
+  // Offset of the first record that was not read
+  ByteOffset end = 0;
+  std::unordered_map<SchemaId, SchemaPtr> schemas;
+  std::unordered_map<ChannelId, ChannelPtr> channels;
+  std::vector<AttachmentIndex> attachmentIndexes;
+  std::vector<MetadataIndex> metadataIndexes;
+  std::vector<ChunkIndex> chunkIndexes;
+  // Message Index records at the start of the region, before any Chunk: they index the last
+  // Chunk of the previous region if they follow it
+  std::vector<std::pair<ChannelId, ByteOffset>> leadingMessageIndexes;
+  uint64_t leadingMessageIndexLength = 0;
   Statistics statistics{};
-  statistics.messageStartTime = EndOffset;
+  std::optional<ByteOffset> dataEnd;
+  // A record could not be read, e.g. in a truncated file: the scan stops there
+  bool readFailed = false;
+  Status status;
+};
 
-  schemas_.clear();
-  channels_.clear();
-  attachmentIndexes_.clear();
-  metadataIndexes_.clear();
-  chunkIndexes_.clear();
+// Minimum length of the regions of a parallel scan, and how much is searched at once for the
+// start of a region
+constexpr uint64_t MinScanRegionSize = 4 * 1024 * 1024;
+constexpr uint64_t ScanSyncWindowSize = 1024 * 1024;
 
-  TypedRecordReader typedReader{reader, dataStart_, dataEnd_};
+/**
+ * @brief Scans the records starting in [start, end), the last one can end after `end`.
+ */
+ScanRegion ScanDataRegion(IReadable& reader, ByteOffset start, ByteOffset end) {
+  ScanRegion region;
+  region.start = start;
+  region.statistics.messageStartTime = EndOffset;
+  bool done = false;
+
+  TypedRecordReader typedReader{reader, start, end};
   typedReader.onSchema = [&](SchemaPtr schemaPtr, ByteOffset, std::optional<ByteOffset>) {
-    schemas_.try_emplace(schemaPtr->id, schemaPtr);
+    region.schemas.try_emplace(schemaPtr->id, schemaPtr);
   };
   typedReader.onChannel = [&](ChannelPtr channelPtr, ByteOffset, std::optional<ByteOffset>) {
-    channels_.try_emplace(channelPtr->id, channelPtr);
+    region.channels.try_emplace(channelPtr->id, channelPtr);
   };
   typedReader.onAttachment = [&](const Attachment& attachment, ByteOffset fileOffset) {
-    AttachmentIndex attachmentIndex{attachment, fileOffset};
-    attachmentIndexes_.emplace(attachment.name, attachmentIndex);
+    region.attachmentIndexes.emplace_back(attachment, fileOffset);
   };
   typedReader.onMetadata = [&](const Metadata& metadata, ByteOffset fileOffset) {
-    MetadataIndex metadataIndex{metadata, fileOffset};
-    metadataIndexes_.emplace(metadata.name, metadataIndex);
+    region.metadataIndexes.emplace_back(metadata, fileOffset);
   };
   typedReader.onChunk = [&](const Chunk& chunk, ByteOffset fileOffset) {
     ChunkIndex chunkIndex{};
@@ -524,9 +578,28 @@ Status McapReader::readSummaryFromScan_(IReadable& reader) {
     chunkIndex.compressedSize = chunk.compressedSize;
     chunkIndex.uncompressedSize = chunk.uncompressedSize;
 
-    chunkIndexes_.emplace_back(std::move(chunkIndex));
+    region.chunkIndexes.emplace_back(std::move(chunkIndex));
+  };
+  // The Message Index records written right after a Chunk (as by a recording that was
+  // interrupted before its Summary section) index it, which lets it be read in log time order
+  typedReader.onMessageIndex = [&](const MessageIndex& messageIndex, ByteOffset fileOffset) {
+    const uint64_t length = 9 + 2 + 4 + messageIndex.records.size() * 16;
+    if (region.chunkIndexes.empty()) {
+      if (fileOffset == region.start + region.leadingMessageIndexLength) {
+        region.leadingMessageIndexes.emplace_back(messageIndex.channelId, fileOffset);
+        region.leadingMessageIndexLength += length;
+      }
+      return;
+    }
+    auto& chunkIndex = region.chunkIndexes.back();
+    if (fileOffset ==
+        chunkIndex.chunkStartOffset + chunkIndex.chunkLength + chunkIndex.messageIndexLength) {
+      chunkIndex.messageIndexOffsets.emplace(messageIndex.channelId, fileOffset);
+      chunkIndex.messageIndexLength += length;
+    }
   };
   typedReader.onMessage = [&](const Message& message, ByteOffset, std::optional<ByteOffset>) {
+    auto& statistics = region.statistics;
     if (message.logTime < statistics.messageStartTime) {
       statistics.messageStartTime = message.logTime;
     }
@@ -537,16 +610,208 @@ Status McapReader::readSummaryFromScan_(IReadable& reader) {
     statistics.channelMessageCounts[message.channelId]++;
   };
   typedReader.onDataEnd = [&](const DataEnd&, ByteOffset fileOffset) {
-    dataEnd_ = fileOffset;
+    region.dataEnd = fileOffset;
     done = true;
   };
 
   while (!done && typedReader.next()) {
     const auto& status = typedReader.status();
     if (!status.ok()) {
-      return status;
+      region.status = status;
+      return region;
+    }
+  }
+  region.readFailed = !typedReader.status().ok();
+  region.end = typedReader.offset();
+  return region;
+}
+
+/**
+ * @brief Returns true if a Chunk record that fits before `dataEnd` starts at `offset`. The
+ * lengths in the record must be consistent, which is unlikely to happen by chance in the middle
+ * of another record.
+ */
+bool IsPlausibleChunk(IReadable& reader, ByteOffset offset, ByteOffset dataEnd) {
+  constexpr uint64_t PreambleSize = 9 + 8 + 8 + 8 + 4 + 4;
+  constexpr uint64_t MaxCompressionSize = 4;
+  std::byte* data = nullptr;
+  const uint64_t size = reader.read(&data, offset, PreambleSize + MaxCompressionSize + 8);
+  if (size < PreambleSize + 8 || OpCode(data[0]) != OpCode::Chunk) {
+    return false;
+  }
+  const uint64_t length = ParseUint64(data + 1);
+  if (length > dataEnd || offset + 9 > dataEnd - length) {
+    return false;
+  }
+  const uint32_t compressionSize = ParseUint32(data + PreambleSize - 4);
+  if (compressionSize > MaxCompressionSize || size < PreambleSize + compressionSize + 8) {
+    return false;
+  }
+  const std::string_view compression{reinterpret_cast<const char*>(data + PreambleSize),
+                                     compressionSize};
+  if (!McapReader::ParseCompression(compression).has_value()) {
+    return false;
+  }
+  const uint64_t messageStartTime = ParseUint64(data + 9);
+  const uint64_t messageEndTime = ParseUint64(data + 9 + 8);
+  const uint64_t uncompressedSize = ParseUint64(data + 9 + 8 + 8);
+  const uint64_t compressedSize = ParseUint64(data + PreambleSize + compressionSize);
+  return messageStartTime <= messageEndTime &&
+         compressedSize + (PreambleSize - 9) + compressionSize + 8 == length &&
+         (compressionSize != 0 || compressedSize == uncompressedSize);
+}
+
+/**
+ * @brief Returns the offset of the first plausible Chunk record starting in [start, end), or
+ * `end` if there is none.
+ */
+ByteOffset FindChunkRecord(IReadable& reader, ByteOffset start, ByteOffset end,
+                           ByteOffset dataEnd) {
+  for (ByteOffset window = start; window < end; window += ScanSyncWindowSize) {
+    std::byte* data = nullptr;
+    const uint64_t size =
+      reader.read(&data, window, std::min<uint64_t>(ScanSyncWindowSize, end - window));
+    if (size == 0) {
+      break;
+    }
+    const void* found = data;
+    const auto* last = data + size;
+    while ((found = std::memchr(found, int(OpCode::Chunk),
+                                size_t(last - static_cast<const std::byte*>(found))))) {
+      const ByteOffset offset = window + ByteOffset(static_cast<const std::byte*>(found) - data);
+      if (IsPlausibleChunk(reader, offset, dataEnd)) {
+        return offset;
+      }
+      found = static_cast<const std::byte*>(found) + 1;
+    }
+  }
+  return end;
+}
+
+}  // namespace internal
+
+void McapReader::setScanThreads(unsigned threads) {
+  scanThreads_ = threads;
+}
+
+Status McapReader::readSummaryFromScan_(IReadable& reader) {
+  Statistics statistics{};
+  statistics.messageStartTime = EndOffset;
+
+  schemas_.clear();
+  channels_.clear();
+  attachmentIndexes_.clear();
+  metadataIndexes_.clear();
+  chunkIndexes_.clear();
+
+  // Merged in file order, so that the first definition of a schema or channel wins, as when
+  // scanning sequentially. Returns false when the scan stops in this region.
+  Status status;
+  auto merge = [&](internal::ScanRegion&& region) {
+    for (auto& [id, schema] : region.schemas) {
+      schemas_.try_emplace(id, std::move(schema));
+    }
+    for (auto& [id, channel] : region.channels) {
+      channels_.try_emplace(id, std::move(channel));
+    }
+    for (auto& attachmentIndex : region.attachmentIndexes) {
+      attachmentIndexes_.emplace(attachmentIndex.name, std::move(attachmentIndex));
+    }
+    for (auto& metadataIndex : region.metadataIndexes) {
+      metadataIndexes_.emplace(metadataIndex.name, std::move(metadataIndex));
+    }
+    if (!chunkIndexes_.empty() && !region.leadingMessageIndexes.empty()) {
+      // The previous region ended with a Chunk running past its end, and these index it
+      auto& chunkIndex = chunkIndexes_.back();
+      if (chunkIndex.chunkStartOffset + chunkIndex.chunkLength + chunkIndex.messageIndexLength ==
+          region.start) {
+        for (const auto& [channelId, offset] : region.leadingMessageIndexes) {
+          chunkIndex.messageIndexOffsets.emplace(channelId, offset);
+        }
+        chunkIndex.messageIndexLength += region.leadingMessageIndexLength;
+      }
+    }
+    std::move(region.chunkIndexes.begin(), region.chunkIndexes.end(),
+              std::back_inserter(chunkIndexes_));
+
+    const auto& regionStatistics = region.statistics;
+    statistics.messageStartTime =
+      std::min(statistics.messageStartTime, regionStatistics.messageStartTime);
+    statistics.messageEndTime =
+      std::max(statistics.messageEndTime, regionStatistics.messageEndTime);
+    statistics.messageCount += regionStatistics.messageCount;
+    for (const auto& [channelId, count] : regionStatistics.channelMessageCounts) {
+      statistics.channelMessageCounts[channelId] += count;
+    }
+
+    if (region.dataEnd) {
+      dataEnd_ = *region.dataEnd;
+    }
+    status = region.status;
+    return status.ok() && !region.dataEnd && !region.readFailed;
+  };
+
+  const ByteOffset dataEnd = std::min(dataEnd_, reader.size());
+  const uint64_t dataSize = dataEnd > dataStart_ ? dataEnd - dataStart_ : 0;
+  const uint64_t regionCount =
+    reader.stablePointers()
+      ? std::min<uint64_t>(4 * uint64_t(scanThreads_), dataSize / internal::MinScanRegionSize)
+      : 0;
+
+  if (scanThreads_ <= 1 || regionCount <= 1) {
+    merge(internal::ScanDataRegion(reader, dataStart_, dataEnd));
+  } else {
+    internal::ThreadPool pool(std::min<uint64_t>(scanThreads_, regionCount));
+
+    // Regions start at a Chunk record found after their nominal start. A region without one is
+    // merged with the previous one.
+    std::vector<std::future<ByteOffset>> syncPoints;
+    for (uint64_t i = 1; i < regionCount; ++i) {
+      const ByteOffset start = dataStart_ + dataSize * i / regionCount;
+      const ByteOffset end = dataStart_ + dataSize * (i + 1) / regionCount;
+      syncPoints.push_back(pool.submit([&reader, start, end, dataEnd] {
+        return internal::FindChunkRecord(reader, start, end, dataEnd);
+      }));
+    }
+    std::vector<ByteOffset> regionStarts{dataStart_};
+    for (auto& syncPoint : syncPoints) {
+      const ByteOffset start = syncPoint.get();
+      if (start < dataEnd && start > regionStarts.back()) {
+        regionStarts.push_back(start);
+      }
+    }
+    regionStarts.push_back(dataEnd);
+
+    std::vector<std::future<internal::ScanRegion>> regions;
+    for (size_t i = 0; i + 1 < regionStarts.size(); ++i) {
+      const ByteOffset start = regionStarts[i];
+      const ByteOffset end = regionStarts[i + 1];
+      regions.push_back(pool.submit([&reader, start, end] {
+        return internal::ScanDataRegion(reader, start, end);
+      }));
+    }
+
+    // A region is only valid if the previous one ended where it starts, otherwise its start was
+    // not a record boundary, and it is scanned again from the actual one
+    ByteOffset position = dataStart_;
+    for (size_t i = 0; i < regions.size(); ++i) {
+      auto region = regions[i].get();
+      const ByteOffset end = regionStarts[i + 1];
+      if (position >= end) {
+        continue;
+      }
+      if (region.start != position) {
+        region = internal::ScanDataRegion(reader, position, end);
+      }
+      position = region.end;
+      if (!merge(std::move(region))) {
+        break;
+      }
     }
   }
+  if (!status.ok()) {
+    return status;
+  }
 
   if (statistics.messageStartTime == EndOffset) {
     statistics.messageStartTime = 0;
@@ -623,6 +888,10 @@ const std::optional<Statistics>& McapReader::statistics() const {
   return statistics_;
 }
 
+ByteOffset McapReader::dataEnd() const {
+  return dataEnd_;
+}
+
 const std::unordered_map<ChannelId, ChannelPtr> McapReader::channels() const {
   return channels_;
 }
@@ -645,6 +914,10 @@ const std::vector<ChunkIndex>& McapReader::chunkIndexes() const {
   return chunkIndexes_;
 }
 
+const std::multimap<std::string, AttachmentIndex>& McapReader::attachmentIndexes() const {
+  return attachmentIndexes_;
+}
+
 const std::multimap<std::string, MetadataIndex>& McapReader::metadataIndexes() const {
   return metadataIndexes_;
 }
@@ -1477,7 +1750,14 @@ bool TypedRecordReader::next() {
           }
 
           // Start iterating through this chunk
+          const bool timed = onChunkDecompressed && *maybeCompression != Compression::None;
+          const uint64_t startTime = timed ? internal::SteadyClockNs() : 0;
           chunkReader_.reset(chunk, maybeCompression.value());
+          if (timed && chunkReader_.status().ok()) {
+            onChunkDecompressed({*maybeCompression, startTime,
+                                 internal::SteadyClockNs() - startTime, chunk.compressedSize,
+                                 chunk.uncompressedSize});
+          }
           status_ = chunkReader_.status();
           parsingChunk_ = true;
         }
@@ -1636,6 +1916,7 @@ LinearMessageView::Iterator::Impl::Impl(LinearMessageView& view)
   auto readMessageOptions = view.readMessageOptions_;
   if (readMessageOptions.readOrder == ReadMessageOptions::ReadOrder::FileOrder) {
     recordReader_.emplace(*(view_.mcapReader_.dataSource()), dataStart, dataEnd);
+    recordReader_->onChunkDecompressed = readMessageOptions.onChunkDecompressed;
 
     recordReader_->onSchema = [this](const SchemaPtr schema, ByteOffset,
                                      std::optional<ByteOffset>) {
@@ -1673,6 +1954,10 @@ void LinearMessageView::Iterator::Impl::onMessage(const Message& message, Record
   if (message.logTime >= view_.readMessageOptions_.endTime) {
     return;
   }
+  if (view_.readMessageOptions_.channelFilter &&
+      !view_.readMessageOptions_.channelFilter(message.channelId)) {
+    return;
+  }
   auto maybeChannel = view_.mcapReader_.channel(message.channelId);
   if (!maybeChannel) {
     view_.onProblem_(
@@ -1794,6 +2079,185 @@ Status ReadMessageOptions::validate() const {
   return Status();
 }
 
+// ChunkPrefetcher /////////////////////////////////////////////////////////////
+
+ChunkPrefetcher::ChunkPrefetcher(IReadable& dataSource, std::vector<Request> requests,
+                                 size_t readAhead, unsigned threadCount,
+                                 ChunkCodecCallback onDecompressed)
+    : dataSource_(dataSource)
+    , requests_(std::move(requests))
+    , readAhead_(readAhead)
+    , onDecompressed_(std::move(onDecompressed)) {
+  std::vector<ByteRange> ranges;
+  ranges.reserve(requests_.size());
+  for (const auto& request : requests_) {
+    ranges.push_back({request.chunkStartOffset, request.messageIndexEndOffset});
+  }
+  dataSource_.willRead(ranges);
+  if (readAhead_ > 0) {
+    if (threadCount == 0) {
+      threadCount = std::max(1u, std::thread::hardware_concurrency());
+      threadCount = unsigned(std::min<size_t>(threadCount, readAhead_));
+    }
+    pool_ = std::make_unique<internal::ThreadPool>(threadCount);
+  }
+}
+
+ChunkPrefetcher::~ChunkPrefetcher() {
+  // Wait for the tasks still using the chunks in flight
+  pool_.reset();
+}
+
+std::unique_ptr<PrefetchedChunk> ChunkPrefetcher::take(const Request& request) {
+  taken_.insert(request.chunkStartOffset);
+  readAhead();
+
+  InFlight inFlight;
+  auto it = inFlight_.find(request.chunkStartOffset);
+  if (it != inFlight_.end()) {
+    inFlight = std::move(it->second);
+    inFlight_.erase(it);
+  } else {
+    inFlight = read(request);
+  }
+  if (inFlight.decompressed.valid()) {
+    inFlight.decompressed.get();
+  }
+
+  // Keep the pool busy while the caller works on this chunk
+  readAhead();
+  return std::move(inFlight.chunk);
+}
+
+void ChunkPrefetcher::recycle(std::unique_ptr<PrefetchedChunk> chunk) {
+  if (chunk) {
+    recycled_.push_back(std::move(chunk));
+  }
+}
+
+void ChunkPrefetcher::readAhead() {
+  while (pool_ && inFlight_.size() < readAhead_ && nextRequest_ < requests_.size()) {
+    const auto& request = requests_[nextRequest_++];
+    if (taken_.count(request.chunkStartOffset) == 0) {
+      inFlight_.emplace(request.chunkStartOffset, read(request));
+    }
+  }
+}
+
+ChunkPrefetcher::InFlight ChunkPrefetcher::read(const Request& request) {
+  InFlight inFlight;
+  if (!recycled_.empty()) {
+    inFlight.chunk = std::move(recycled_.back());
+    recycled_.pop_back();
+  } else {
+    inFlight.chunk = std::make_unique<PrefetchedChunk>();
+  }
+  auto& chunk = *inFlight.chunk;
+  chunk.records = nullptr;
+  chunk.recordsSize = 0;
+  chunk.uncompressedRecords = nullptr;
+  chunk.uncompressedSize = 0;
+  chunk.status = Status();
+
+  const uint64_t size = request.messageIndexEndOffset - request.chunkStartOffset;
+  std::byte* data = nullptr;
+  const uint64_t bytesRead = dataSource_.read(&data, request.chunkStartOffset, size);
+  if (bytesRead != size) {
+    const auto msg = internal::StrCat("attempted to read ", size, " bytes for the chunk at offset ",
+                                      request.chunkStartOffset, " but only read ", bytesRead,
+                                      " bytes");
+    chunk.status = Status{StatusCode::ReadFailed, msg};
+    return inFlight;
+  }
+  // Unless the data source says otherwise, the data returned by read() only lives until the
+  // next read, so it has to be copied
+  if (!dataSource_.stablePointers()) {
+    chunk.recordsBuffer.assign(data, data + size);
+    data = chunk.recordsBuffer.data();
+  }
+  chunk.records = data;
+  chunk.recordsSize = size;
+
+  BufferReader recordsReader;
+  recordsReader.reset(chunk.records, chunk.recordsSize, chunk.recordsSize);
+  Record record;
+  chunk.status = McapReader::ReadRecord(recordsReader, 0, &record);
+  if (chunk.status.ok() && record.opcode != OpCode::Chunk) {
+    chunk.status = Status(StatusCode::InvalidRecord,
+                          internal::StrCat("expected a chunk at offset ", request.chunkStartOffset,
+                                           ", found ", OpCodeString(record.opcode)));
+  }
+  if (chunk.status.ok()) {
+    chunk.status = McapReader::ParseChunk(record, &chunk.chunk);
+  }
+  if (!chunk.status.ok() || !request.decompress) {
+    return inFlight;
+  }
+
+  // Uncompressed chunks are served in place
+  if (McapReader::ParseCompression(chunk.chunk.compression) == Compression::None) {
+    if (chunk.chunk.uncompressedSize > chunk.chunk.compressedSize) {
+      const auto msg = internal::StrCat("uncompressed chunk at offset ", request.chunkStartOffset,
+                                        " has ", chunk.chunk.compressedSize,
+                                        " bytes of records but an uncompressed size of ",
+                                        chunk.chunk.uncompressedSize);
+      chunk.status = Status{StatusCode::InvalidRecord, msg};
+      return inFlight;
+    }
+    chunk.uncompressedRecords = chunk.chunk.records;
+    chunk.uncompressedSize = chunk.chunk.uncompressedSize;
+    return inFlight;
+  }
+
+  auto decompress = [this, chunk = inFlight.chunk.get()] {
+    chunk->status = DecompressChunk(chunk->chunk, &chunk->uncompressedBuffer, onDecompressed_);
+    chunk->uncompressedRecords = chunk->uncompressedBuffer.data();
+    chunk->uncompressedSize = chunk->uncompressedBuffer.size();
+  };
+  if (pool_) {
+    inFlight.decompressed = pool_->submit(decompress);
+  } else {
+    decompress();
+  }
+  return inFlight;
+}
+
+Status ChunkPrefetcher::DecompressChunk(const Chunk& chunk, ByteArray* output,
+                                        const ChunkCodecCallback& onDecompressed) {
+  auto compression = McapReader::ParseCompression(chunk.compression);
+  if (!compression.has_value()) {
+    return Status(StatusCode::UnrecognizedCompression,
+                  internal::StrCat("unrecognized compression: ", chunk.compression));
+  }
+  output->clear();
+  if (*compression == Compression::None) {
+    output->insert(output->end(), &chunk.records[0], &chunk.records[chunk.uncompressedSize]);
+    return Status();
+  }
+  const uint64_t startTime = onDecompressed ? internal::SteadyClockNs() : 0;
+  Status status(StatusCode::UnsupportedCompression,
+                internal::StrCat("unhandled compression: ", chunk.compression));
+#ifndef MCAP_COMPRESSION_NO_LZ4
+  if (*compression == Compression::Lz4) {
+    // LZ4Reader keeps a decompression context, which can't be shared between threads
+    thread_local LZ4Reader lz4Reader;
+    status = lz4Reader.decompressAll(chunk.records, chunk.compressedSize, chunk.uncompressedSize,
+                                     output);
+  }
+#endif
+#ifndef MCAP_COMPRESSION_NO_ZSTD
+  if (*compression == Compression::Zstd) {
+    status = ZStdReader::DecompressAll(chunk.records, chunk.compressedSize,
+                                       chunk.uncompressedSize, output);
+  }
+#endif
+  if (status.ok() && onDecompressed) {
+    onDecompressed({*compression, startTime, internal::SteadyClockNs() - startTime,
+                    chunk.compressedSize, chunk.uncompressedSize});
+  }
+  return status;
+}
+
 // IndexedMessageReader ///////////////////////////////////////////////////////////
 IndexedMessageReader::IndexedMessageReader(
   McapReader& reader, const ReadMessageOptions& options,
@@ -1817,11 +2281,13 @@ IndexedMessageReader::IndexedMessageReader(
     return;
   }
   for (const auto& [channelId, channel] : mcapReader_.channels()) {
-    if (!options_.topicFilter || options_.topicFilter(channel->topic)) {
+    if ((!options_.channelFilter || options_.channelFilter(channelId)) &&
+        (!options_.topicFilter || options_.topicFilter(channel->topic))) {
       selectedChannels_.insert(channelId);
     }
   }
   // Initialize the read job queue by finding all of the chunks that need to be read from.
+  std::vector<internal::DecompressChunkJob> decompressChunkJobs;
   for (const auto& chunkIndex : mcapReader_.chunkIndexes()) {
     if (chunkIndex.messageStartTime >= options_.endTime) {
       // chunk starts after requested time range, skip it.
@@ -1839,11 +2305,35 @@ IndexedMessageReader::IndexedMessageReader(
           chunkIndex.chunkStartOffset + chunkIndex.chunkLength + chunkIndex.messageIndexLength;
         job.messageStartTime = chunkIndex.messageStartTime;
         job.messageEndTime = chunkIndex.messageEndTime;
+        decompressChunkJobs.push_back(job);
         queue_.push(std::move(job));
         break;
       }
     }
   }
+
+  if (options_.readAheadChunks > 0) {
+    // Chunks are decompressed in the order the queue pops their jobs
+    const bool reverse = options_.readOrder == ReadMessageOptions::ReadOrder::ReverseLogTimeOrder;
+    std::sort(decompressChunkJobs.begin(), decompressChunkJobs.end(),
+              [reverse](const auto& a, const auto& b) {
+                if (reverse) {
+                  return std::tie(a.messageEndTime, a.messageIndexEndOffset) >
+                         std::tie(b.messageEndTime, b.messageIndexEndOffset);
+                }
+                return std::tie(a.messageStartTime, a.chunkStartOffset) <
+                       std::tie(b.messageStartTime, b.chunkStartOffset);
+              });
+    std::vector<ChunkPrefetcher::Request> requests;
+    requests.reserve(decompressChunkJobs.size());
+    for (const auto& job : decompressChunkJobs) {
+      requests.push_back({job.chunkStartOffset, job.messageIndexEndOffset, true});
+    }
+    prefetcher_ = std::make_unique<ChunkPrefetcher>(*mcapReader_.dataSource(), std::move(requests),
+                                                    options_.readAheadChunks,
+                                                    options_.decompressionThreads,
+                                                    options_.onChunkDecompressed);
+  }
 }
 
 size_t IndexedMessageReader::findFreeChunkSlot() {
@@ -1858,33 +2348,18 @@ size_t IndexedMessageReader::findFreeChunkSlot() {
 
 void IndexedMessageReader::decompressChunk(const Chunk& chunk,
                                            IndexedMessageReader::ChunkSlot& slot) {
-  auto compression = McapReader::ParseCompression(chunk.compression);
-  if (!compression.has_value()) {
-    status_ = Status(StatusCode::UnrecognizedCompression,
-                     internal::StrCat("unrecognized compression: ", chunk.compression));
+  // Uncompressed chunks can be read in place if the data source keeps them in memory
+  if (mcapReader_.dataSource()->stablePointers() &&
+      McapReader::ParseCompression(chunk.compression) == Compression::None &&
+      chunk.uncompressedSize <= chunk.compressedSize) {
+    slot.data = chunk.records;
+    slot.size = chunk.uncompressedSize;
     return;
   }
-  slot.decompressedChunk.clear();
-  if (*compression == Compression::None) {
-    slot.decompressedChunk.insert(slot.decompressedChunk.end(), &chunk.records[0],
-                                  &chunk.records[chunk.uncompressedSize]);
-  }
-#ifndef MCAP_COMPRESSION_NO_LZ4
-  else if (*compression == Compression::Lz4) {
-    status_ = lz4Reader_.decompressAll(chunk.records, chunk.compressedSize, chunk.uncompressedSize,
-                                       &slot.decompressedChunk);
-  }
-#endif
-#ifndef MCAP_COMPRESSION_NO_ZSTD
-  else if (*compression == Compression::Zstd) {
-    status_ = ZStdReader::DecompressAll(chunk.records, chunk.compressedSize, chunk.uncompressedSize,
-                                        &slot.decompressedChunk);
-  }
-#endif
-  else {
-    status_ = Status(StatusCode::UnsupportedCompression,
-                     internal::StrCat("unhandled compression: ", chunk.compression));
-  }
+  status_ = ChunkPrefetcher::DecompressChunk(chunk, &slot.decompressedChunk,
+                                             options_.onChunkDecompressed);
+  slot.data = slot.decompressedChunk.data();
+  slot.size = slot.decompressedChunk.size();
 }
 
 bool IndexedMessageReader::next() {
@@ -1900,13 +2375,36 @@ bool IndexedMessageReader::next() {
       size_t chunkReaderIndex = findFreeChunkSlot();
       auto& chunkSlot = chunkSlots_[chunkReaderIndex];
       chunkSlot.chunkStartOffset = decompressChunkJob.chunkStartOffset;
-      // Point the record reader at the chunk and message indices after it.
-      recordReader_.reset(*mcapReader_.dataSource(), decompressChunkJob.chunkStartOffset,
-                          decompressChunkJob.messageIndexEndOffset);
+      if (chunkSlot.prefetched) {
+        prefetcher_->recycle(std::move(chunkSlot.prefetched));
+      }
+      // Point the record reader at the chunk and message indices after it. With read-ahead,
+      // they have already been read and the chunk is (being) decompressed in the background.
+      std::unique_ptr<PrefetchedChunk> prefetched;
+      BufferReader prefetchedReader;
+      if (prefetcher_) {
+        prefetched = prefetcher_->take({decompressChunkJob.chunkStartOffset,
+                                        decompressChunkJob.messageIndexEndOffset, true});
+        status_ = prefetched->status;
+        if (!status_.ok()) {
+          return false;
+        }
+        prefetchedReader.reset(prefetched->records, prefetched->recordsSize,
+                               prefetched->recordsSize);
+        recordReader_.reset(prefetchedReader, 0, prefetched->recordsSize);
+      } else {
+        recordReader_.reset(*mcapReader_.dataSource(), decompressChunkJob.chunkStartOffset,
+                            decompressChunkJob.messageIndexEndOffset);
+      }
       for (auto record = recordReader_.next(); record != std::nullopt;
            record = recordReader_.next()) {
         switch (record->opcode) {
           case OpCode::Chunk: {
+            if (prefetched) {
+              chunkSlot.data = prefetched->uncompressedRecords;
+              chunkSlot.size = prefetched->uncompressedSize;
+              break;
+            }
             Chunk chunk;
             status_ = McapReader::ParseChunk(*record, &chunk);
             if (!status_.ok()) {
@@ -1944,6 +2442,8 @@ bool IndexedMessageReader::next() {
             return false;
         }
       }
+      // The slot keeps the prefetched chunk alive while its messages are read
+      chunkSlot.prefetched = std::move(prefetched);
     } else if (std::holds_alternative<internal::ReadMessageJob>(nextItem)) {
       // Read the message out of the already-decompressed chunk.
       const auto& readMessageJob = std::get<internal::ReadMessageJob>(nextItem);
@@ -1951,9 +2451,8 @@ bool IndexedMessageReader::next() {
       assert(chunkSlot.unreadMessages > 0);
       chunkSlot.unreadMessages--;
       BufferReader reader;
-      reader.reset(chunkSlot.decompressedChunk.data(), chunkSlot.decompressedChunk.size(),
-                   chunkSlot.decompressedChunk.size());
-      recordReader_.reset(reader, readMessageJob.offset.offset, chunkSlot.decompressedChunk.size());
+      reader.reset(chunkSlot.data, chunkSlot.size, chunkSlot.size);
+      recordReader_.reset(reader, readMessageJob.offset.offset, chunkSlot.size);
       auto record = recordReader_.next();
       status_ = recordReader_.status();
       if (!status_.ok()) {
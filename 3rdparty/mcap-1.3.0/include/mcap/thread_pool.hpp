@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace mcap::internal {
+
+/**
+ * @brief A fixed-size pool of worker threads executing tasks in FIFO order. Used to
+ * compress and decompress chunks off the calling thread.
+ */
+class ThreadPool {
+public:
+  explicit ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    threads_.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+      threads_.emplace_back([this] {
+        workerLoop();
+      });
+    }
+  }
+
+  /**
+   * @brief Runs the tasks still in the queue, then joins the worker threads.
+   */
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queue a task for execution. The returned future holds its result, or
+   * the exception it threw.
+   */
+  template <typename Function>
+  std::future<std::invoke_result_t<Function>> submit(Function&& function) {
+    using Result = std::invoke_result_t<Function>;
+    // std::function must be copyable, std::packaged_task is not
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Function>(function));
+    auto future = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace_back([task] {
+        (*task)();
+      });
+    }
+    condition_.notify_one();
+    return future;
+  }
+
+  size_t size() const {
+    return threads_.size();
+  }
+
+private:
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> tasks_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  bool stopping_ = false;
+
+  void workerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] {
+          return stopping_ || !tasks_.empty();
+        });
+        if (tasks_.empty()) {
+          return;
+        }
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+    }
+  }
+};
+
+}  // namespace mcap::internal
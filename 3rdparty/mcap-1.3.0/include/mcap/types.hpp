@@ -27,6 +27,7 @@ constexpr char SpecVersion = '0';
 constexpr char LibraryVersion[] = MCAP_LIBRARY_VERSION;
 constexpr uint8_t Magic[] = {137, 77, 67, 65, 80, SpecVersion, 13, 10};  // "\x89MCAP0\r\n"
 constexpr uint64_t DefaultChunkSize = 1024 * 768;
+constexpr uint64_t DefaultAttachmentPieceSize = 4 * 1024 * 1024;
 constexpr ByteOffset EndOffset = std::numeric_limits<ByteOffset>::max();
 constexpr Timestamp MaxTime = std::numeric_limits<Timestamp>::max();
 
@@ -52,6 +53,24 @@ enum struct CompressionLevel {
   Slowest,
 };
 
+/**
+ * @brief Time spent compressing or decompressing one Chunk. Times are in nanoseconds, measured
+ * with std::chrono::steady_clock.
+ */
+struct MCAP_PUBLIC ChunkCodecTiming {
+  Compression compression;
+  uint64_t startTime;
+  uint64_t duration;
+  uint64_t compressedSize;
+  uint64_t uncompressedSize;
+};
+
+/**
+ * @brief Receives the ChunkCodecTiming of each Chunk. It may be called from worker threads, and
+ * from several threads at once.
+ */
+using ChunkCodecCallback = std::function<void(const ChunkCodecTiming&)>;
+
 /**
  * @brief MCAP record types.
  */
@@ -1,8 +1,11 @@
 #pragma once
 
+#include "thread_pool.hpp"
 #include "types.hpp"
 #include "visibility.hpp"
 #include <cstdio>
+#include <deque>
+#include <future>
 #include <memory>
 #include <string>
 #include <unordered_set>
@@ -15,6 +18,28 @@ struct ZSTD_CCtx_s;
 
 namespace mcap {
 
+struct IReadable;
+
+/**
+ * @brief How the Chunks of a group of channels are written, see
+ * McapWriter::addChunkGroup().
+ */
+struct MCAP_PUBLIC ChunkGroupOptions {
+  /**
+   * @brief Compression algorithm of the Chunks of the group.
+   */
+  Compression compression = Compression::Zstd;
+  /**
+   * @brief Compression level of the Chunks of the group.
+   */
+  CompressionLevel compressionLevel = CompressionLevel::Default;
+  /**
+   * @brief Target uncompressed Chunk payload size in bytes, see
+   * McapWriterOptions::chunkSize.
+   */
+  uint64_t chunkSize = DefaultChunkSize;
+};
+
 /**
  * @brief Configuration options for McapWriter.
  */
@@ -79,6 +104,28 @@ struct MCAP_PUBLIC McapWriterOptions {
    * Chunks. This option is ignored if `noChunking=true`.
    */
   bool forceCompression = false;
+  /**
+   * @brief Number of threads compressing Chunks in the background. When zero,
+   * each Chunk is compressed by the thread that closes it. Chunks are still
+   * written in the order they were closed, together with their Message Index
+   * records, so the indexes and the Summary section are the same as without
+   * threads. This option is
+   * ignored if `noChunking=true` or `compression=None`.
+   */
+  unsigned compressionThreads = 0;
+  /**
+   * @brief Maximum number of closed Chunks waiting to be compressed or written
+   * when `compressionThreads > 0`. Writing a message blocks once the limit is
+   * reached, so the memory held by in-flight Chunks stays around
+   * `maxPendingChunks * chunkSize` (plus the compressed copies). Zero means
+   * twice `compressionThreads`.
+   */
+  unsigned maxPendingChunks = 0;
+  /**
+   * @brief Called after each Chunk is compressed, with the time it took. With
+   * `compressionThreads > 0`, it is called from the compression threads.
+   */
+  ChunkCodecCallback onChunkCompressed;
   /**
    * @brief The recording profile. See
    * https://mcap.dev/spec/registry#well-known-profiles
@@ -369,6 +416,63 @@ public:
    */
   void addChannel(Channel& channel);
 
+  /**
+   * @brief Add a schema to the MCAP file keeping its existing `schema.id`. This
+   * is used when records are copied verbatim from another MCAP file (see
+   * `copyChunk()`), since the copied data already references the original ids.
+   * Do not mix with `addSchema()` on the same writer.
+   *
+   * @param schema Schema to register. `schema.id` must be non-zero.
+   */
+  void addSchemaWithId(const Schema& schema);
+
+  /**
+   * @brief Add a channel to the MCAP file keeping its existing `channel.id`.
+   * Do not mix with `addChannel()` on the same writer.
+   *
+   * @param channel Channel to register. `channel.id` must be non-zero.
+   */
+  void addChannelWithId(const Channel& channel);
+
+  /**
+   * @brief Copy a Chunk read from another MCAP file to the output stream without
+   * decompressing it, followed by the given Message Index records. Any Chunk in
+   * progress is closed first. Schema and Channel records that have not been
+   * written yet are written to the Data section ahead of the copied Chunk. All
+   * channels referenced by the Chunk must have been registered with
+   * `addChannelWithId()`.
+   *
+   * @param chunk Chunk to copy. Its compression and CRC are kept as they are.
+   * @param messageIndexes The Message Index records of the Chunk. Their offsets
+   *   are relative to the uncompressed Chunk and remain valid.
+   * @return A non-zero error code on failure.
+   */
+  Status copyChunk(const Chunk& chunk, const std::vector<MessageIndex>& messageIndexes);
+
+  /**
+   * @brief Add a group of channels written to Chunks of their own. Each group
+   * has its own open Chunk, closed once it reaches `options.chunkSize`
+   * independently of the other groups, so that reading the channels of one
+   * group does not decompress the messages of the others. Group 0 is created
+   * by `open()` with the compression and Chunk size of McapWriterOptions, and
+   * holds every channel not assigned to another group. The Chunks of the
+   * groups are interleaved in the file, and their time ranges overlap.
+   *
+   * @param options Compression and Chunk size of the group.
+   * @return The id of the group, for `setChunkGroup()`. Always 0 if
+   *   `noChunking=true`.
+   */
+  size_t addChunkGroup(const ChunkGroupOptions& options);
+
+  /**
+   * @brief Write the messages of a channel to the Chunks of a group. Call it
+   * before writing the first message of the channel.
+   *
+   * @param channelId Channel registered with `addChannel()`.
+   * @param group Id returned by `addChunkGroup()`.
+   */
+  void setChunkGroup(ChannelId channelId, size_t group);
+
   /**
    * @brief Write a message to the output stream.
    *
@@ -377,6 +481,19 @@ public:
    */
   Status write(const Message& message);
 
+  /**
+   * @brief Write a message read from another MCAP file, under another channel id.
+   * Equivalent to copying `messageView.message` and setting its `channelId`, without the
+   * copy: the record header is serialized in one piece, and the payload is copied once, from
+   * the buffer it was read in to the output. Statistics and message indexes are updated as by
+   * `write(const Message&)`.
+   *
+   * @param messageView Message to add, e.g. from `McapReader::readMessages()`.
+   * @param channelId Id of its channel in the output, registered with `addChannel()`.
+   * @return A non-zero error code on failure.
+   */
+  Status write(const MessageView& messageView, ChannelId channelId);
+
   /**
    * @brief Write an attachment to the output stream.
    *
@@ -386,6 +503,22 @@ public:
    */
   Status write(Attachment& attachment);
 
+  /**
+   * @brief Write an attachment whose data is copied from `source` in pieces, instead of being
+   * held in memory, e.g. to copy a large attachment from another MCAP file. Memory use is
+   * bounded by `pieceSize` (plus the buffer of `source`).
+   *
+   * @param attachment Attachment to add, whose `attachment.data` is ignored and reset. Its
+   * `attachment.crc` is computed while the data is copied, if configuration options allow CRC
+   * calculation, and set.
+   * @param source Where `attachment.dataSize` bytes of data are read.
+   * @param dataOffset Offset of the data in `source`.
+   * @param pieceSize Bytes read from `source` at a time.
+   * @return A non-zero error code on failure. If `source` is too short, nothing is written.
+   */
+  Status write(Attachment& attachment, IReadable& source, uint64_t dataOffset,
+               uint64_t pieceSize = DefaultAttachmentPieceSize);
+
   /**
    * @brief Write a metadata record to the output stream.
    *
@@ -402,13 +535,26 @@ public:
 
   /**
    * @brief Returns a pointer to the IWritable data destination backing this
-   * writer. Will return nullptr if the writer is not open.
+   * writer. Will return nullptr if the writer is not open. With
+   * `compressionThreads > 0`, Chunks still being compressed are not part of
+   * its size yet.
    */
   IWritable* dataSink();
 
   /**
-   * @brief finishes the current chunk in progress and writes it to the file, if a chunk
-   * is in progress.
+   * @brief Returns an upper bound of the bytes that `close()` would still add
+   * to `dataSink()`: the open and pending Chunks as if uncompressed, their
+   * Message Index records, and the Summary section. Added to the size of
+   * `dataSink()`, it bounds the size of the file, e.g. to start a new file
+   * before a size limit. Takes a time proportional to the number of Chunk
+   * groups and of pending Chunks.
+   */
+  uint64_t pendingBytes() const;
+
+  /**
+   * @brief finishes the chunks in progress and writes them to the file, in the order of
+   * their first message, if chunks are in progress. Also waits for the chunks being
+   * compressed in the background.
    */
   void closeLastChunk();
 
@@ -423,6 +569,7 @@ public:
   static uint64_t write(IWritable& output, const Schema& schema);
   static uint64_t write(IWritable& output, const Channel& channel);
   static uint64_t write(IWritable& output, const Message& message);
+  static uint64_t write(IWritable& output, const Message& message, ChannelId channelId);
   static uint64_t write(IWritable& output, const Attachment& attachment);
   static uint64_t write(IWritable& output, const Metadata& metadata);
   static uint64_t write(IWritable& output, const Chunk& chunk);
@@ -445,35 +592,74 @@ public:
   static void write(IWritable& output, const KeyValueMap& map, uint32_t size = 0);
 
 private:
+  // A closed Chunk, with everything needed to write it once it is compressed
+  struct PendingChunk {
+    std::unique_ptr<IChunkWriter> data;
+    // In the iteration order of ChunkGroup::messageIndex, like a synchronous write
+    std::vector<std::pair<ChannelId, MessageIndex>> messageIndexes;
+    size_t group = 0;
+    Timestamp startTime = MaxTime;
+    Timestamp endTime = 0;
+    uint64_t uncompressedSize = 0;
+    uint64_t messageIndexSize = 0;
+    bool compress = false;
+    std::future<void> compressed;
+  };
+
+  // The open Chunk of a group of channels, see addChunkGroup()
+  struct ChunkGroup {
+    ChunkGroupOptions options;
+    std::unique_ptr<IChunkWriter> chunk;
+    std::unordered_map<ChannelId, MessageIndex> messageIndex;
+    Timestamp startTime = MaxTime;
+    Timestamp endTime = 0;
+    uint64_t uncompressedSize = 0;
+    // Bytes of the Message Index records of the open Chunk
+    uint64_t messageIndexSize = 0;
+    // Schemas that the Chunks of the group can refer to: those written to
+    // them, and those written to the Data section before them
+    std::unordered_set<SchemaId> writtenSchemas;
+    // Pending chunks already written, with a chunk writer of the group
+    std::vector<PendingChunk> recycledChunks;
+  };
+
   McapWriterOptions options_{""};
-  uint64_t chunkSize_ = DefaultChunkSize;
   IWritable* output_ = nullptr;
   std::unique_ptr<FileWriter> fileOutput_;
   std::unique_ptr<StreamWriter> streamOutput_;
-  std::unique_ptr<BufferWriter> uncompressedChunk_;
-#ifndef MCAP_COMPRESSION_NO_LZ4
-  std::unique_ptr<LZ4Writer> lz4Chunk_;
-#endif
-#ifndef MCAP_COMPRESSION_NO_ZSTD
-  std::unique_ptr<ZStdWriter> zstdChunk_;
-#endif
+  // Empty if `noChunking=true`
+  std::vector<ChunkGroup> chunkGroups_;
+  // Group of each channel, indexed by channel id. Channels beyond its end are in group 0
+  std::vector<size_t> channelGroups_;
   std::vector<Schema> schemas_;
   std::vector<Channel> channels_;
   std::vector<AttachmentIndex> attachmentIndex_;
   std::vector<MetadataIndex> metadataIndex_;
   std::vector<ChunkIndex> chunkIndex_;
   Statistics statistics_{};
+  // Summary records known so far, for pendingBytes()
+  uint64_t summarySize_ = 0;
+  // Written anywhere, for the statistics
   std::unordered_set<SchemaId> writtenSchemas_;
-  std::unordered_map<ChannelId, MessageIndex> currentMessageIndex_;
-  Timestamp currentChunkStart_ = MaxTime;
-  Timestamp currentChunkEnd_ = 0;
-  Compression compression_ = Compression::None;
-  uint64_t uncompressedSize_ = 0;
   bool opened_ = false;
-
-  IWritable& getOutput();
-  IChunkWriter* getChunkWriter();
-  void writeChunk(IWritable& output, IChunkWriter& chunkData);
+  std::unique_ptr<internal::ThreadPool> compressionPool_;
+  std::deque<PendingChunk> pendingChunks_;
+  size_t maxPendingChunks_ = 0;
+
+  Status writeMessage(const Message& message, ChannelId channelId);
+  ChunkGroup* chunkGroup(ChannelId channelId);
+  std::unique_ptr<IChunkWriter> makeChunkWriter(const ChunkGroupOptions& options) const;
+  bool shouldCompress(uint64_t uncompressedSize) const;
+  void writeChunk(IWritable& output, size_t group);
+  void queueChunk(IWritable& output, size_t group);
+  void writePendingChunks(IWritable& output, size_t maxPending);
+  template <typename MessageIndexes>
+  void writeChunkRecords(IWritable& output, IChunkWriter& chunkData, bool compressed,
+                         Compression compression, Timestamp startTime, Timestamp endTime,
+                         uint64_t uncompressedSize, MessageIndexes& messageIndexes);
+  // Into the open Chunk of group, or to the Data section if it is null
+  Status writeChannelRecords(IWritable& output, ChannelId channelId, uint64_t& bytesWritten,
+                             ChunkGroup* group);
 };
 
 }  // namespace mcap
@@ -1,6 +1,10 @@
 #include "crc32.hpp"
+#include "reader.hpp"
+#include "thread_pool.hpp"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #ifndef MCAP_COMPRESSION_NO_LZ4
 #  include <lz4frame.h>
@@ -296,31 +300,8 @@ McapWriter::~McapWriter() {
 void McapWriter::open(IWritable& writer, const McapWriterOptions& options) {
   options_ = options;
   opened_ = true;
-  chunkSize_ = options.noChunking ? 0 : options.chunkSize;
-  compression_ = chunkSize_ > 0 ? options.compression : Compression::None;
-  switch (compression_) {
-    case Compression::None:
-    default:
-      uncompressedChunk_ = std::make_unique<BufferWriter>();
-      break;
-#ifndef MCAP_COMPRESSION_NO_LZ4
-    case Compression::Lz4:
-      lz4Chunk_ = std::make_unique<LZ4Writer>(options.compressionLevel, chunkSize_);
-      break;
-#endif
-#ifndef MCAP_COMPRESSION_NO_ZSTD
-    case Compression::Zstd:
-      zstdChunk_ = std::make_unique<ZStdWriter>(options.compressionLevel, chunkSize_);
-      break;
-#endif
-  }
-  auto* chunkWriter = getChunkWriter();
-  if (chunkWriter) {
-    chunkWriter->crcEnabled = !options.noChunkCRC;
-    if (chunkWriter->crcEnabled) {
-      chunkWriter->resetCrc();
-    }
-  }
+  // Group 0, which holds every channel until others are added
+  addChunkGroup({options.compression, options.compressionLevel, options.chunkSize});
   writer.crcEnabled = options.enableDataCRC;
   output_ = &writer;
   writeMagic(writer);
@@ -348,10 +329,23 @@ void McapWriter::closeLastChunk() {
     return;
   }
   auto& fileOutput = *output_;
-  auto* chunkWriter = getChunkWriter();
-  if (chunkWriter && !chunkWriter->empty()) {
-    writeChunk(fileOutput, *chunkWriter);
+  // In the order of their first message, so that the file stays close to log time order.
+  // Writing a chunk leaves its group with an empty one.
+  while (true) {
+    size_t first = chunkGroups_.size();
+    for (size_t i = 0; i < chunkGroups_.size(); ++i) {
+      const auto& group = chunkGroups_[i];
+      if (!group.chunk->empty() &&
+          (first == chunkGroups_.size() || group.startTime < chunkGroups_[first].startTime)) {
+        first = i;
+      }
+    }
+    if (first == chunkGroups_.size()) {
+      break;
+    }
+    writeChunk(fileOutput, first);
   }
+  writePendingChunks(fileOutput, 0);
 }
 
 void McapWriter::close() {
@@ -380,7 +374,10 @@ void McapWriter::close() {
     if (!options_.noRepeatedSchemas) {
       // Write all schema records
       for (const auto& schema : schemas_) {
-        write(fileOutput, schema);
+        // Skip the gaps left by addSchemaWithId()
+        if (schema.id != 0) {
+          write(fileOutput, schema);
+        }
       }
     }
 
@@ -388,7 +385,10 @@ void McapWriter::close() {
     if (!options_.noRepeatedChannels) {
       // Write all channel records
       for (const auto& channel : channels_) {
-        write(fileOutput, channel);
+        // Skip the gaps left by addChannelWithId()
+        if (channel.id != 0) {
+          write(fileOutput, channel);
+        }
       }
     }
 
@@ -465,82 +465,243 @@ void McapWriter::close() {
 }
 
 void McapWriter::terminate() {
+  // The compression threads may still be using the pending chunks
+  for (auto& chunk : pendingChunks_) {
+    if (chunk.compressed.valid()) {
+      chunk.compressed.wait();
+    }
+  }
+  pendingChunks_.clear();
+  compressionPool_.reset();
+
   output_ = nullptr;
   fileOutput_.reset();
   streamOutput_.reset();
-  uncompressedChunk_.reset();
-#ifndef MCAP_COMPRESSION_NO_ZSTD
-  zstdChunk_.reset();
-#endif
+  chunkGroups_.clear();
+  channelGroups_.clear();
 
   channels_.clear();
   attachmentIndex_.clear();
   metadataIndex_.clear();
   chunkIndex_.clear();
   statistics_ = {};
-  currentMessageIndex_.clear();
-  currentChunkStart_ = MaxTime;
-  currentChunkEnd_ = 0;
+  summarySize_ = 0;
 
   opened_ = false;
 }
 
+namespace internal {
+
+// Sizes of the Summary records, opcode and length included
+inline uint64_t SummaryRecordSize(const Schema& schema) {
+  return 9 + 2 + 4 + schema.name.size() + 4 + schema.encoding.size() + 4 + schema.data.size();
+}
+
+inline uint64_t SummaryRecordSize(const Channel& channel) {
+  uint64_t size = 9 + 2 + 2 + 4 + channel.topic.size() + 4 + channel.messageEncoding.size() + 4;
+  for (const auto& [key, value] : channel.metadata) {
+    size += 4 + key.size() + 4 + value.size();
+  }
+  return size;
+}
+
+inline uint64_t SummaryRecordSize(const ChunkIndex& index) {
+  return 9 + 8 + 8 + 8 + 8 + 4 + 10 * index.messageIndexOffsets.size() + 8 + 4 +
+         index.compression.size() + 8 + 8;
+}
+
+inline uint64_t SummaryRecordSize(const Attachment& attachment) {
+  return 9 + 8 + 8 + 8 + 8 + 8 + 4 + attachment.name.size() + 4 + attachment.mediaType.size();
+}
+
+// CRC32 state after the fields of an Attachment record that precede its data, to be updated
+// with the data and finalized
+inline uint32_t AttachmentHeaderCrc(const Attachment& attachment) {
+  uint32_t sizePrefix = 0;
+  uint32_t crc = CRC32_INIT;
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.logTime), 8);
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.createTime), 8);
+  sizePrefix = uint32_t(attachment.name.size());
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(&sizePrefix), 4);
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(attachment.name.data()), sizePrefix);
+  sizePrefix = uint32_t(attachment.mediaType.size());
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(&sizePrefix), 4);
+  crc = crc32Update(crc, reinterpret_cast<const std::byte*>(attachment.mediaType.data()),
+                    sizePrefix);
+  return crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.dataSize), 8);
+}
+
+}  // namespace internal
+
 void McapWriter::addSchema(Schema& schema) {
   schema.id = uint16_t(schemas_.size() + 1);
   schemas_.push_back(schema);
+  summarySize_ += internal::SummaryRecordSize(schema);
 }
 
 void McapWriter::addChannel(Channel& channel) {
   channel.id = uint16_t(channels_.size() + 1);
   channels_.push_back(channel);
+  summarySize_ += internal::SummaryRecordSize(channel);
 }
 
-Status McapWriter::write(const Message& message) {
+void McapWriter::addSchemaWithId(const Schema& schema) {
+  assert(schema.id != 0);
+  if (schemas_.size() < schema.id) {
+    Schema placeholder;
+    placeholder.id = 0;
+    schemas_.resize(schema.id, placeholder);
+  }
+  schemas_[schema.id - 1] = schema;
+  summarySize_ += internal::SummaryRecordSize(schema);
+}
+
+void McapWriter::addChannelWithId(const Channel& channel) {
+  assert(channel.id != 0);
+  if (channels_.size() < channel.id) {
+    Channel placeholder;
+    placeholder.id = 0;
+    channels_.resize(channel.id, placeholder);
+  }
+  channels_[channel.id - 1] = channel;
+  summarySize_ += internal::SummaryRecordSize(channel);
+}
+
+Status McapWriter::copyChunk(const Chunk& chunk, const std::vector<MessageIndex>& messageIndexes) {
   if (!output_) {
     return StatusCode::NotOpen;
   }
-  auto& output = getOutput();
+  auto& fileOutput = *output_;
+
+  // Close the chunk in progress, so that the copied chunk keeps its position in the file
+  closeLastChunk();
+
+  // Write out the Schema and Channel records this chunk depends on, if we have not yet done
+  // so. The copied chunk may contain them too, but only if it is the first chunk of its
+  // channels in the source file.
   auto& channelMessageCounts = statistics_.channelMessageCounts;
+  for (const auto& messageIndex : messageIndexes) {
+    if (channelMessageCounts.find(messageIndex.channelId) == channelMessageCounts.end()) {
+      uint64_t bytesWritten = 0;
+      if (auto status =
+            writeChannelRecords(fileOutput, messageIndex.channelId, bytesWritten, nullptr);
+          !status.ok()) {
+        return status;
+      }
+    }
+  }
 
-  // Write out Channel if we have not yet done so
-  if (channelMessageCounts.find(message.channelId) == channelMessageCounts.end()) {
-    const size_t channelIndex = message.channelId - 1;
-    if (channelIndex >= channels_.size()) {
-      const auto msg = internal::StrCat("invalid channel id ", message.channelId);
-      return Status{StatusCode::InvalidChannelId, msg};
+  // Write the chunk
+  const uint64_t chunkStartOffset = fileOutput.size();
+  write(fileOutput, chunk);
+  const uint64_t chunkLength = fileOutput.size() - chunkStartOffset;
+
+  ChunkIndex chunkIndexRecord{};
+  const uint64_t messageIndexOffset = fileOutput.size();
+  if (!options_.noMessageIndex) {
+    // Write the message index records
+    for (const auto& messageIndex : messageIndexes) {
+      chunkIndexRecord.messageIndexOffsets.emplace(messageIndex.channelId, fileOutput.size());
+      write(fileOutput, messageIndex);
     }
+  }
 
-    const auto& channel = channels_[channelIndex];
+  if (!options_.noChunkIndex) {
+    chunkIndexRecord.messageStartTime = chunk.messageStartTime;
+    chunkIndexRecord.messageEndTime = chunk.messageEndTime;
+    chunkIndexRecord.chunkStartOffset = chunkStartOffset;
+    chunkIndexRecord.chunkLength = chunkLength;
+    chunkIndexRecord.messageIndexLength = fileOutput.size() - messageIndexOffset;
+    chunkIndexRecord.compression = chunk.compression;
+    chunkIndexRecord.compressedSize = chunk.compressedSize;
+    chunkIndexRecord.uncompressedSize = chunk.uncompressedSize;
+    summarySize_ += internal::SummaryRecordSize(chunkIndexRecord);
+    chunkIndex_.push_back(std::move(chunkIndexRecord));
+  }
 
-    // Check if the Schema record needs to be written
-    if ((channel.schemaId != 0) &&
-        (writtenSchemas_.find(channel.schemaId) == writtenSchemas_.end())) {
-      const size_t schemaIndex = channel.schemaId - 1;
-      if (schemaIndex >= schemas_.size()) {
-        const auto msg = internal::StrCat("invalid schema id ", channel.schemaId);
-        return Status{StatusCode::InvalidSchemaId, msg};
+  // Update message statistics from the message indexes, which list every message of the chunk
+  if (!options_.noSummary) {
+    uint64_t messageCount = 0;
+    for (const auto& messageIndex : messageIndexes) {
+      channelMessageCounts[messageIndex.channelId] += messageIndex.records.size();
+      messageCount += messageIndex.records.size();
+    }
+    if (messageCount > 0) {
+      if (statistics_.messageCount == 0) {
+        statistics_.messageStartTime = chunk.messageStartTime;
+        statistics_.messageEndTime = chunk.messageEndTime;
+      } else {
+        statistics_.messageStartTime =
+          std::min(statistics_.messageStartTime, chunk.messageStartTime);
+        statistics_.messageEndTime = std::max(statistics_.messageEndTime, chunk.messageEndTime);
       }
+      statistics_.messageCount += messageCount;
+    }
+  }
+  ++statistics_.chunkCount;
 
-      // Write the Schema record
-      uncompressedSize_ += write(output, schemas_[schemaIndex]);
-      writtenSchemas_.insert(channel.schemaId);
+  return StatusCode::Success;
+}
 
-      // Update schema statistics
-      ++statistics_.schemaCount;
-    }
+size_t McapWriter::addChunkGroup(const ChunkGroupOptions& options) {
+  if (!opened_ || options_.noChunking || options_.chunkSize == 0) {
+    return 0;
+  }
+  auto& group = chunkGroups_.emplace_back();
+  group.options = options;
+  group.chunk = makeChunkWriter(options);
+  if (options_.compressionThreads > 0 && options.compression != Compression::None &&
+      !compressionPool_) {
+    compressionPool_ = std::make_unique<internal::ThreadPool>(options_.compressionThreads);
+    maxPendingChunks_ = options_.maxPendingChunks > 0 ? options_.maxPendingChunks
+                                                      : 2 * size_t(options_.compressionThreads);
+  }
+  return chunkGroups_.size() - 1;
+}
+
+void McapWriter::setChunkGroup(ChannelId channelId, size_t group) {
+  if (group >= chunkGroups_.size()) {
+    return;
+  }
+  if (channelGroups_.size() <= channelId) {
+    channelGroups_.resize(size_t(channelId) + 1, 0);
+  }
+  channelGroups_[channelId] = group;
+}
 
-    // Write the Channel record
-    uncompressedSize_ += write(output, channel);
+Status McapWriter::write(const Message& message) {
+  return writeMessage(message, message.channelId);
+}
 
-    // Update channel statistics
-    channelMessageCounts.emplace(message.channelId, 0);
-    ++statistics_.channelCount;
+Status McapWriter::write(const MessageView& messageView, ChannelId channelId) {
+  return writeMessage(messageView.message, channelId);
+}
+
+Status McapWriter::writeMessage(const Message& message, ChannelId channelId) {
+  if (!output_) {
+    return StatusCode::NotOpen;
+  }
+  // The open chunk of the group of the channel, unless chunking is disabled
+  auto* group = chunkGroup(channelId);
+  auto& output = group ? static_cast<IWritable&>(*group->chunk) : *output_;
+  uint64_t unchunkedSize = 0;
+  uint64_t& uncompressedSize = group ? group->uncompressedSize : unchunkedSize;
+  auto& channelMessageCounts = statistics_.channelMessageCounts;
+
+  // Write out Channel if we have not yet done so
+  auto channelCount = channelMessageCounts.find(channelId);
+  if (channelCount == channelMessageCounts.end()) {
+    if (auto status = writeChannelRecords(output, channelId, uncompressedSize, group);
+        !status.ok()) {
+      return status;
+    }
+    channelCount = channelMessageCounts.find(channelId);
   }
 
-  const uint64_t messageOffset = uncompressedSize_;
+  const uint64_t messageOffset = uncompressedSize;
 
   // Write the message
-  uncompressedSize_ += write(output, message);
+  uncompressedSize += write(output, message, channelId);
 
   // Update message statistics
   if (!options_.noSummary) {
@@ -552,26 +713,30 @@ Status McapWriter::write(const Message& message) {
       statistics_.messageEndTime = std::max(statistics_.messageEndTime, message.logTime);
     }
     ++statistics_.messageCount;
-    channelMessageCounts[message.channelId] += 1;
+    channelCount->second += 1;
   }
 
-  auto* chunkWriter = getChunkWriter();
-  if (chunkWriter) {
+  if (group) {
     if (!options_.noMessageIndex) {
       // Update the message index
-      auto& messageIndex = currentMessageIndex_[message.channelId];
-      messageIndex.channelId = message.channelId;
+      auto& messageIndex = group->messageIndex[channelId];
+      if (messageIndex.records.empty()) {
+        // Opcode, length, channel id and length of the records
+        group->messageIndexSize += 9 + 2 + 4;
+      }
+      group->messageIndexSize += 16;
+      messageIndex.channelId = channelId;
       messageIndex.records.emplace_back(message.logTime, messageOffset);
     }
 
     // Update the chunk index start/end times
-    currentChunkStart_ = std::min(currentChunkStart_, message.logTime);
-    currentChunkEnd_ = std::max(currentChunkEnd_, message.logTime);
+    group->startTime = std::min(group->startTime, message.logTime);
+    group->endTime = std::max(group->endTime, message.logTime);
 
     // Check if the current chunk is ready to close
-    if (uncompressedSize_ >= chunkSize_) {
+    if (uncompressedSize >= group->options.chunkSize) {
       auto& fileOutput = *output_;
-      writeChunk(fileOutput, *chunkWriter);
+      writeChunk(fileOutput, size_t(group - chunkGroups_.data()));
     }
   }
 
@@ -584,27 +749,12 @@ Status McapWriter::write(Attachment& attachment) {
   }
   auto& fileOutput = *output_;
 
-  // Check if we have an open chunk that needs to be closed
-  auto* chunkWriter = getChunkWriter();
-  if (chunkWriter && !chunkWriter->empty()) {
-    writeChunk(fileOutput, *chunkWriter);
-  }
+  // Close the open chunk, if any, and wait for the ones being compressed
+  closeLastChunk();
 
   if (!options_.noAttachmentCRC) {
     // Calculate the CRC32 of the attachment
-    uint32_t sizePrefix = 0;
-    uint32_t crc = internal::CRC32_INIT;
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.logTime), 8);
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.createTime), 8);
-    sizePrefix = uint32_t(attachment.name.size());
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(&sizePrefix), 4);
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(attachment.name.data()),
-                                sizePrefix);
-    sizePrefix = uint32_t(attachment.mediaType.size());
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(&sizePrefix), 4);
-    crc = internal::crc32Update(
-      crc, reinterpret_cast<const std::byte*>(attachment.mediaType.data()), sizePrefix);
-    crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(&attachment.dataSize), 8);
+    uint32_t crc = internal::AttachmentHeaderCrc(attachment);
     crc = internal::crc32Update(crc, reinterpret_cast<const std::byte*>(attachment.data),
                                 attachment.dataSize);
     attachment.crc = internal::crc32Final(crc);
@@ -620,23 +770,75 @@ Status McapWriter::write(Attachment& attachment) {
     ++statistics_.attachmentCount;
     if (!options_.noAttachmentIndex) {
       attachmentIndex_.emplace_back(attachment, fileOffset);
+      summarySize_ += internal::SummaryRecordSize(attachment);
     }
   }
 
   return StatusCode::Success;
 }
 
-Status McapWriter::write(const Metadata& metadata) {
+Status McapWriter::write(Attachment& attachment, IReadable& source, uint64_t dataOffset,
+                         uint64_t pieceSize) {
   if (!output_) {
     return StatusCode::NotOpen;
   }
+  // Checked before anything is written, so that a short source can't leave a truncated record
+  if (dataOffset > source.size() || source.size() - dataOffset < attachment.dataSize) {
+    return Status{StatusCode::ReadFailed, "attachment data is out of the source"};
+  }
   auto& fileOutput = *output_;
 
-  // Check if we have an open chunk that needs to be closed
-  auto* chunkWriter = getChunkWriter();
-  if (chunkWriter && !chunkWriter->empty()) {
-    writeChunk(fileOutput, *chunkWriter);
+  // Close the open chunk, if any, and wait for the ones being compressed
+  closeLastChunk();
+
+  const uint64_t fileOffset = fileOutput.size();
+  const uint64_t recordSize = 4 + attachment.name.size() + 8 + 8 + 4 +
+                              attachment.mediaType.size() + 8 + attachment.dataSize + 4;
+  write(fileOutput, OpCode::Attachment);
+  write(fileOutput, recordSize);
+  write(fileOutput, attachment.logTime);
+  write(fileOutput, attachment.createTime);
+  write(fileOutput, attachment.name);
+  write(fileOutput, attachment.mediaType);
+  write(fileOutput, attachment.dataSize);
+
+  uint32_t crc = options_.noAttachmentCRC ? 0 : internal::AttachmentHeaderCrc(attachment);
+  pieceSize = std::max<uint64_t>(pieceSize, 1);
+  for (uint64_t copied = 0; copied < attachment.dataSize;) {
+    const uint64_t size = std::min(pieceSize, attachment.dataSize - copied);
+    std::byte* data = nullptr;
+    if (source.read(&data, dataOffset + copied, size) != size) {
+      return Status{StatusCode::ReadFailed, "failed to read attachment data"};
+    }
+    if (!options_.noAttachmentCRC) {
+      crc = internal::crc32Update(crc, data, size);
+    }
+    fileOutput.write(data, size);
+    copied += size;
+  }
+  attachment.crc = options_.noAttachmentCRC ? 0 : internal::crc32Final(crc);
+  attachment.data = nullptr;
+  write(fileOutput, attachment.crc);
+
+  if (!options_.noSummary) {
+    ++statistics_.attachmentCount;
+    if (!options_.noAttachmentIndex) {
+      attachmentIndex_.emplace_back(attachment, fileOffset);
+      summarySize_ += internal::SummaryRecordSize(attachment);
+    }
+  }
+
+  return StatusCode::Success;
+}
+
+Status McapWriter::write(const Metadata& metadata) {
+  if (!output_) {
+    return StatusCode::NotOpen;
   }
+  auto& fileOutput = *output_;
+
+  // Close the open chunk, if any, and wait for the ones being compressed
+  closeLastChunk();
 
   const uint64_t fileOffset = fileOutput.size();
 
@@ -648,6 +850,7 @@ Status McapWriter::write(const Metadata& metadata) {
     ++statistics_.metadataCount;
     if (!options_.noMetadataIndex) {
       metadataIndex_.emplace_back(metadata, fileOffset);
+      summarySize_ += 9 + 8 + 8 + 4 + metadata.name.size();
     }
   }
 
@@ -662,67 +865,257 @@ IWritable* McapWriter::dataSink() {
   return output_;
 }
 
-// Private methods /////////////////////////////////////////////////////////////
-
-IWritable& McapWriter::getOutput() {
-  if (chunkSize_ == 0) {
-    return *output_;
+uint64_t McapWriter::pendingBytes() const {
+  if (!opened_ || !output_) {
+    return 0;
   }
-  switch (compression_) {
-    default:
-    case Compression::None:
-      return *uncompressedChunk_;
-#ifndef MCAP_COMPRESSION_NO_ZSTD
-    case Compression::Zstd:
-      return *zstdChunk_;
-#endif
-#ifndef MCAP_COMPRESSION_NO_LZ4
-    case Compression::Lz4:
-      return *lz4Chunk_;
-#endif
+  // Chunk record and Chunk Index record without their variable parts, with
+  // the longest compression name
+  constexpr uint64_t CHUNK_SIZE = 9 + 8 + 8 + 8 + 4 + 4 + 4 + 8;
+  constexpr uint64_t CHUNK_INDEX_SIZE = 9 + 8 + 8 + 8 + 8 + 4 + 8 + 4 + 4 + 8 + 8;
+  // Data End, Statistics without its channel counts, a Summary Offset per
+  // record type, Footer and magic
+  constexpr uint64_t END_SIZE = (9 + 4) + (9 + 8 + 2 + 4 + 4 + 4 + 4 + 8 + 8 + 4) +
+                                6 * (9 + 1 + 8 + 8) + (9 + 8 + 8 + 4) + 8;
+
+  uint64_t size = summarySize_ + END_SIZE + 10 * channels_.size();
+  for (const auto& group : chunkGroups_) {
+    if (!group.chunk->empty()) {
+      size += CHUNK_SIZE + group.uncompressedSize + group.messageIndexSize + CHUNK_INDEX_SIZE +
+              10 * group.messageIndex.size();
+    }
+  }
+  for (const auto& chunk : pendingChunks_) {
+    size += CHUNK_SIZE + chunk.uncompressedSize + chunk.messageIndexSize + CHUNK_INDEX_SIZE +
+            10 * chunk.messageIndexes.size();
   }
+  return size;
 }
 
-IChunkWriter* McapWriter::getChunkWriter() {
-  if (chunkSize_ == 0) {
+// Private methods /////////////////////////////////////////////////////////////
+
+McapWriter::ChunkGroup* McapWriter::chunkGroup(ChannelId channelId) {
+  if (chunkGroups_.empty()) {
     return nullptr;
   }
+  return &chunkGroups_[channelId < channelGroups_.size() ? channelGroups_[channelId] : 0];
+}
+
+Status McapWriter::writeChannelRecords(IWritable& output, ChannelId channelId,
+                                       uint64_t& bytesWritten, ChunkGroup* group) {
+  const size_t channelIndex = channelId - 1;
+  if (channelIndex >= channels_.size() || channels_[channelIndex].id == 0) {
+    const auto msg = internal::StrCat("invalid channel id ", channelId);
+    return Status{StatusCode::InvalidChannelId, msg};
+  }
+
+  const auto& channel = channels_[channelIndex];
+
+  // Check if the Schema record needs to be written. The open chunks of the other groups may be
+  // written after this one, so each group writes the schemas it needs.
+  const auto& writtenSchemas = group ? group->writtenSchemas : writtenSchemas_;
+  if ((channel.schemaId != 0) &&
+      (writtenSchemas.find(channel.schemaId) == writtenSchemas.end())) {
+    const size_t schemaIndex = channel.schemaId - 1;
+    if (schemaIndex >= schemas_.size() || schemas_[schemaIndex].id == 0) {
+      const auto msg = internal::StrCat("invalid schema id ", channel.schemaId);
+      return Status{StatusCode::InvalidSchemaId, msg};
+    }
+
+    // Write the Schema record
+    bytesWritten += write(output, schemas_[schemaIndex]);
+    if (group) {
+      group->writtenSchemas.insert(channel.schemaId);
+    } else {
+      // Written before the chunks to come of every group
+      for (auto& chunkGroup : chunkGroups_) {
+        chunkGroup.writtenSchemas.insert(channel.schemaId);
+      }
+    }
+
+    // Update schema statistics
+    if (writtenSchemas_.insert(channel.schemaId).second) {
+      ++statistics_.schemaCount;
+    }
+  }
 
-  switch (compression_) {
+  // Write the Channel record
+  bytesWritten += write(output, channel);
+
+  // Update channel statistics
+  statistics_.channelMessageCounts.emplace(channelId, 0);
+  ++statistics_.channelCount;
+
+  return StatusCode::Success;
+}
+
+std::unique_ptr<IChunkWriter> McapWriter::makeChunkWriter(const ChunkGroupOptions& options) const {
+  std::unique_ptr<IChunkWriter> chunkWriter;
+  switch (options.compression) {
     case Compression::None:
     default:
-      return uncompressedChunk_.get();
+      chunkWriter = std::make_unique<BufferWriter>();
+      break;
 #ifndef MCAP_COMPRESSION_NO_LZ4
     case Compression::Lz4:
-      return lz4Chunk_.get();
+      chunkWriter = std::make_unique<LZ4Writer>(options.compressionLevel, options.chunkSize);
+      break;
 #endif
 #ifndef MCAP_COMPRESSION_NO_ZSTD
     case Compression::Zstd:
-      return zstdChunk_.get();
+      chunkWriter = std::make_unique<ZStdWriter>(options.compressionLevel, options.chunkSize);
+      break;
 #endif
   }
+  chunkWriter->crcEnabled = !options_.noChunkCRC;
+  return chunkWriter;
 }
 
-void McapWriter::writeChunk(IWritable& output, IChunkWriter& chunkData) {
+bool McapWriter::shouldCompress(uint64_t uncompressedSize) const {
   // Both LZ4 and ZSTD recommend ~1KB as the minimum size for compressed data
   constexpr uint64_t MIN_COMPRESSION_SIZE = 1024;
+  return options_.forceCompression || uncompressedSize >= MIN_COMPRESSION_SIZE;
+}
+
+void McapWriter::writeChunk(IWritable& output, size_t groupIndex) {
+  if (compressionPool_) {
+    queueChunk(output, groupIndex);
+    return;
+  }
+
+  auto& group = chunkGroups_[groupIndex];
+  auto& chunkData = *group.chunk;
+  const Compression compression = group.options.compression;
+  const bool compress = shouldCompress(group.uncompressedSize);
+  if (compress) {
+    // Flush any in-progress compression stream
+    const uint64_t startTime = options_.onChunkCompressed ? internal::SteadyClockNs() : 0;
+    chunkData.end();
+    if (options_.onChunkCompressed) {
+      options_.onChunkCompressed({compression, startTime, internal::SteadyClockNs() - startTime,
+                                  chunkData.compressedSize(), group.uncompressedSize});
+    }
+  }
+  writeChunkRecords(output, chunkData, compress, compression, group.startTime, group.endTime,
+                    group.uncompressedSize, group.messageIndex);
+
+  // Reset uncompressedSize and start/end times for the next chunk
+  group.uncompressedSize = 0;
+  group.messageIndexSize = 0;
+  group.startTime = MaxTime;
+  group.endTime = 0;
+
+  // Update statistics
+  ++statistics_.chunkCount;
+
+  // Reset the chunk writer
+  chunkData.clear();
+}
+
+void McapWriter::queueChunk(IWritable& output, size_t groupIndex) {
+  auto& group = chunkGroups_[groupIndex];
+  PendingChunk chunk;
+  if (!group.recycledChunks.empty()) {
+    chunk = std::move(group.recycledChunks.back());
+    group.recycledChunks.pop_back();
+  } else {
+    chunk.data = makeChunkWriter(group.options);
+  }
+
+  // The closed chunk leaves with its data and message indexes, and an empty chunk
+  // writer takes its place
+  std::swap(chunk.data, group.chunk);
+  size_t indexCount = 0;
+  for (auto& [channelId, messageIndex] : group.messageIndex) {
+    if (messageIndex.records.empty()) {
+      continue;
+    }
+    if (indexCount == chunk.messageIndexes.size()) {
+      chunk.messageIndexes.emplace_back();
+    }
+    auto& [chunkChannelId, chunkMessageIndex] = chunk.messageIndexes[indexCount++];
+    chunkChannelId = channelId;
+    chunkMessageIndex.channelId = channelId;
+    // The records of the previous pending chunk were cleared when it was written
+    chunkMessageIndex.records.swap(messageIndex.records);
+  }
+  chunk.messageIndexes.resize(indexCount);
+  chunk.group = groupIndex;
+  chunk.startTime = group.startTime;
+  chunk.endTime = group.endTime;
+  chunk.uncompressedSize = group.uncompressedSize;
+  chunk.messageIndexSize = group.messageIndexSize;
+  // Groups without compression share the queue, to keep the order of the chunks
+  chunk.compress =
+    group.options.compression != Compression::None && shouldCompress(group.uncompressedSize);
+  if (chunk.compress) {
+    IChunkWriter* chunkData = chunk.data.get();
+    chunk.compressed = compressionPool_->submit(
+      [chunkData, compression = group.options.compression,
+       uncompressedSize = group.uncompressedSize, &onCompressed = options_.onChunkCompressed] {
+        const uint64_t startTime = onCompressed ? internal::SteadyClockNs() : 0;
+        chunkData->end();
+        if (onCompressed) {
+          onCompressed({compression, startTime, internal::SteadyClockNs() - startTime,
+                        chunkData->compressedSize(), uncompressedSize});
+        }
+      });
+  }
+  pendingChunks_.push_back(std::move(chunk));
+
+  // Reset uncompressedSize and start/end times for the next chunk
+  group.uncompressedSize = 0;
+  group.messageIndexSize = 0;
+  group.startTime = MaxTime;
+  group.endTime = 0;
+
+  // Update statistics
+  ++statistics_.chunkCount;
+
+  // Write what is ready, and block if too many chunks are in flight
+  writePendingChunks(output, maxPendingChunks_);
+}
+
+void McapWriter::writePendingChunks(IWritable& output, size_t maxPending) {
+  // Chunks are written in the order they were closed, as if they had been
+  // compressed synchronously
+  while (!pendingChunks_.empty()) {
+    auto& chunk = pendingChunks_.front();
+    if (chunk.compressed.valid()) {
+      if (pendingChunks_.size() <= maxPending &&
+          chunk.compressed.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        break;
+      }
+      chunk.compressed.get();
+    }
+    auto& group = chunkGroups_[chunk.group];
+    writeChunkRecords(output, *chunk.data, chunk.compress, group.options.compression,
+                      chunk.startTime, chunk.endTime, chunk.uncompressedSize,
+                      chunk.messageIndexes);
+    chunk.data->clear();
+    group.recycledChunks.push_back(std::move(chunk));
+    pendingChunks_.pop_front();
+  }
+}
+
+template <typename MessageIndexes>
+void McapWriter::writeChunkRecords(IWritable& output, IChunkWriter& chunkData, bool compressed,
+                                   Compression chunkCompression, Timestamp startTime,
+                                   Timestamp endTime, uint64_t uncompressedSize,
+                                   MessageIndexes& messageIndexes) {
   // Throw away any compression results that save less than 2% of the original size
   constexpr double MIN_COMPRESSION_RATIO = 1.02;
 
   Compression compression = Compression::None;
-  const uint64_t uncompressedSize = uncompressedSize_;
   uint64_t compressedSize = uncompressedSize;
   const std::byte* compressedData = chunkData.data();
 
-  if (options_.forceCompression || uncompressedSize >= MIN_COMPRESSION_SIZE) {
-    // Flush any in-progress compression stream
-    chunkData.end();
-
+  if (compressed) {
     // Only use the compressed data if it is materially smaller than the
     // uncompressed data
     const double compressionRatio = double(uncompressedSize) / double(chunkData.compressedSize());
     if (options_.forceCompression || compressionRatio >= MIN_COMPRESSION_RATIO) {
-      compression = compression_;
+      compression = chunkCompression;
       compressedSize = chunkData.compressedSize();
       compressedData = chunkData.compressedData();
     }
@@ -733,8 +1126,8 @@ void McapWriter::writeChunk(IWritable& output, IChunkWriter& chunkData) {
 
   // Write the chunk
   const uint64_t chunkStartOffset = output.size();
-  write(output, Chunk{currentChunkStart_, currentChunkEnd_, uncompressedSize, uncompressedCrc,
-                      compressionStr, compressedSize, compressedData});
+  write(output, Chunk{startTime, endTime, uncompressedSize, uncompressedCrc, compressionStr,
+                      compressedSize, compressedData});
 
   const uint64_t chunkLength = output.size() - chunkStartOffset;
 
@@ -745,8 +1138,8 @@ void McapWriter::writeChunk(IWritable& output, IChunkWriter& chunkData) {
     const uint64_t messageIndexOffset = output.size();
     if (!options_.noMessageIndex) {
       // Write the message index records
-      for (auto& [channelId, messageIndex] : currentMessageIndex_) {
-        // currentMessageIndex_ contains entries for every channel ever seen, not just in this
+      for (auto& [channelId, messageIndex] : messageIndexes) {
+        // ChunkGroup::messageIndex contains entries for every channel ever seen, not just in this
         // chunk. Only write message index records for channels with messages in this chunk.
         if (messageIndex.records.size() > 0) {
           chunkIndexRecord.messageIndexOffsets.emplace(channelId, output.size());
@@ -762,18 +1155,19 @@ void McapWriter::writeChunk(IWritable& output, IChunkWriter& chunkData) {
 
     // Fill in the newly created chunk index record. This will be written into
     // the summary section when close() is called
-    chunkIndexRecord.messageStartTime = currentChunkStart_;
-    chunkIndexRecord.messageEndTime = currentChunkEnd_;
+    chunkIndexRecord.messageStartTime = startTime;
+    chunkIndexRecord.messageEndTime = endTime;
     chunkIndexRecord.chunkStartOffset = chunkStartOffset;
     chunkIndexRecord.chunkLength = chunkLength;
     chunkIndexRecord.messageIndexLength = messageIndexLength;
     chunkIndexRecord.compression = compressionStr;
     chunkIndexRecord.compressedSize = compressedSize;
     chunkIndexRecord.uncompressedSize = uncompressedSize;
+    summarySize_ += internal::SummaryRecordSize(chunkIndexRecord);
   } else if (!options_.noMessageIndex) {
     // Write the message index records
-    for (auto& [channelId, messageIndex] : currentMessageIndex_) {
-      // currentMessageIndex_ contains entries for every channel ever seen, not just in this
+    for (auto& [channelId, messageIndex] : messageIndexes) {
+      // ChunkGroup::messageIndex contains entries for every channel ever seen, not just in this
       // chunk. Only write message index records for channels with messages in this chunk.
       if (messageIndex.records.size() > 0) {
         write(output, messageIndex);
@@ -784,17 +1178,6 @@ void McapWriter::writeChunk(IWritable& output, IChunkWriter& chunkData) {
       }
     }
   }
-
-  // Reset uncompressedSize and start/end times for the next chunk
-  uncompressedSize_ = 0;
-  currentChunkStart_ = MaxTime;
-  currentChunkEnd_ = 0;
-
-  // Update statistics
-  ++statistics_.chunkCount;
-
-  // Reset the chunk writer
-  chunkData.clear();
 }
 
 void McapWriter::writeMagic(IWritable& output) {
@@ -866,14 +1249,26 @@ uint64_t McapWriter::write(IWritable& output, const Channel& channel) {
 }
 
 uint64_t McapWriter::write(IWritable& output, const Message& message) {
+  return write(output, message, message.channelId);
+}
+
+uint64_t McapWriter::write(IWritable& output, const Message& message, ChannelId channelId) {
   const uint64_t recordSize = 2 + 4 + 8 + 8 + message.dataSize;
 
-  write(output, OpCode::Message);
-  write(output, recordSize);
-  write(output, message.channelId);
-  write(output, message.sequence);
-  write(output, message.logTime);
-  write(output, message.publishTime);
+  // Opcode, record length and the fixed size fields, in a single write
+  std::byte header[1 + 8 + 2 + 4 + 8 + 8];
+  std::byte* field = header;
+  auto put = [&field](const auto& value) {
+    std::memcpy(field, &value, sizeof(value));
+    field += sizeof(value);
+  };
+  put(OpCode::Message);
+  put(recordSize);
+  put(channelId);
+  put(message.sequence);
+  put(message.logTime);
+  put(message.publishTime);
+  output.write(header, sizeof(header));
   write(output, message.data, message.dataSize);
 
   return 9 + recordSize;
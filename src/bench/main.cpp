@@ -0,0 +1,709 @@
+// Benchmarks of the reading and writing paths of the editor, on synthetic files.
+// Results are printed as JSON, to compare versions.
+
+#include "exporter.hpp"
+#include "mmap_reader.hpp"
+#include "synthetic_mcap.hpp"
+#include "topic_stats.hpp"
+
+#include <mcap/crc32.hpp>
+#include <mcap/internal.hpp>
+#include <mcap/reader.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+namespace
+{
+
+using mcap_editor::SyntheticOptions;
+
+struct BenchOptions
+{
+    std::string output_file;
+    std::string directory;
+    std::string filter;
+    unsigned iterations = 5;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool keep_files = false;
+    SyntheticOptions synthetic;
+};
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    std::vector<uint64_t> times_ns;
+    // Benchmark specific, e.g. the compression ratio, or a checksum, printed
+    // exactly
+    std::vector<std::pair<std::string, std::variant<double, uint64_t>>> extra;
+};
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(const BenchOptions& options) : options_(options) {}
+
+    // Runs setup once, untimed, then function once to warm up, then
+    // options.iterations times. It returns the bytes and messages it processed.
+    void run(const std::string& name,
+             const std::function<mcap::Status(BenchResult&)>& function,
+             const std::function<mcap::Status()>& setup = {})
+    {
+        if(!options_.filter.empty() && name.find(options_.filter) == std::string::npos)
+        {
+            return;
+        }
+        std::fprintf(stderr, "%s\n", name.c_str());
+        if(setup)
+        {
+            const auto status = setup();
+            if(!status.ok())
+            {
+                std::fprintf(stderr, "  failed: %s\n", status.message.c_str());
+                failed_ = true;
+                return;
+            }
+        }
+        BenchResult result;
+        result.name = name;
+        for(unsigned i = 0; i <= options_.iterations; i++)
+        {
+            result.bytes = 0;
+            result.messages = 0;
+            result.extra.clear();
+            const uint64_t start = mcap::internal::SteadyClockNs();
+            const auto status = function(result);
+            const uint64_t duration = mcap::internal::SteadyClockNs() - start;
+            if(!status.ok())
+            {
+                std::fprintf(stderr, "  failed: %s\n", status.message.c_str());
+                failed_ = true;
+                return;
+            }
+            if(i > 0)
+            {
+                result.times_ns.push_back(duration);
+            }
+        }
+        results_.push_back(std::move(result));
+    }
+
+    bool failed() const { return failed_; }
+
+    std::string json(const SyntheticOptions& synthetic,
+                      const mcap_editor::SyntheticResult& file) const;
+
+private:
+    const BenchOptions& options_;
+    std::vector<BenchResult> results_;
+    bool failed_ = false;
+};
+
+const char* compressionName(mcap::Compression compression)
+{
+    switch(compression)
+    {
+    case mcap::Compression::None: return "none";
+    case mcap::Compression::Lz4: return "lz4";
+    case mcap::Compression::Zstd: return "zstd";
+    }
+    return "unknown";
+}
+
+const char* levelName(mcap::CompressionLevel level)
+{
+    switch(level)
+    {
+    case mcap::CompressionLevel::Fastest: return "fastest";
+    case mcap::CompressionLevel::Fast: return "fast";
+    case mcap::CompressionLevel::Default: return "default";
+    case mcap::CompressionLevel::Slow: return "slow";
+    case mcap::CompressionLevel::Slowest: return "slowest";
+    }
+    return "unknown";
+}
+
+std::string BenchRunner::json(const SyntheticOptions& synthetic,
+                              const mcap_editor::SyntheticResult& file) const
+{
+    std::ostringstream out;
+    out << "{\n";
+    out << "  \"mcap_version\": \"" << mcap::LibraryVersion << "\",\n";
+    out << "  \"threads\": " << options_.threads << ",\n";
+    out << "  \"iterations\": " << options_.iterations << ",\n";
+    out << "  \"synthetic\": {"
+        << "\"topics\": " << synthetic.topics
+        << ", \"rate_hz\": " << synthetic.rate_hz
+        << ", \"duration_s\": " << synthetic.duration_s
+        << ", \"message_size\": " << synthetic.message_size
+        << ", \"size_distribution\": \""
+        << mcap_editor::sizeDistributionName(synthetic.size_distribution) << "\""
+        << ", \"chunk_size\": " << synthetic.chunk_size
+        << ", \"compression\": \"" << compressionName(synthetic.compression) << "\""
+        << ", \"messages\": " << file.messages
+        << ", \"payload_bytes\": " << file.payload_bytes
+        << ", \"file_size\": " << file.file_size << "},\n";
+    out << "  \"benchmarks\": [";
+
+    for(size_t i = 0; i < results_.size(); i++)
+    {
+        const auto& result = results_[i];
+        auto times = result.times_ns;
+        std::sort(times.begin(), times.end());
+        uint64_t total = 0;
+        for(auto time: times)
+        {
+            total += time;
+        }
+        const uint64_t median = times[times.size() / 2];
+        const double median_s = double(median) * 1e-9;
+
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": \"" << result.name << "\""
+            << ", \"bytes\": " << result.bytes
+            << ", \"messages\": " << result.messages
+            << ", \"min_ns\": " << times.front()
+            << ", \"median_ns\": " << median
+            << ", \"mean_ns\": " << total / times.size()
+            << ", \"max_ns\": " << times.back()
+            << ", \"mb_per_s\": " << (median_s > 0 ? double(result.bytes) * 1e-6 / median_s : 0)
+            << ", \"messages_per_s\": "
+            << (median_s > 0 ? double(result.messages) / median_s : 0);
+        for(const auto& [key, value]: result.extra)
+        {
+            out << ", \"" << key << "\": ";
+            std::visit([&out](auto number) { out << number; }, value);
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+    return out.str();
+}
+
+// Opens through a memory mapping, like the editor
+struct OpenedFile
+{
+    mcap::McapReader reader;
+    mcap_editor::MmapReader mmap_reader;
+
+    mcap::Status open(const std::string& filename)
+    {
+        auto status = mmap_reader.open(filename);
+        return status.ok() ? reader.open(mmap_reader) : reader.open(filename);
+    }
+};
+
+mcap::Status readSummary(const std::string& filename, mcap::ReadSummaryMethod method,
+                         unsigned threads, BenchResult& result)
+{
+    OpenedFile file;
+    auto status = file.open(filename);
+    if(status.ok())
+    {
+        file.reader.setScanThreads(threads);
+        status = file.reader.readSummary(method);
+    }
+    if(status.ok())
+    {
+        result.bytes = file.reader.dataSource()->size();
+        result.messages = file.reader.statistics() ? file.reader.statistics()->messageCount : 0;
+    }
+    return status;
+}
+
+// Only the summary and the message indexes are read
+mcap::Status topicStats(const std::string& filename, unsigned threads, BenchResult& result)
+{
+    OpenedFile file;
+    auto status = file.open(filename);
+    if(status.ok())
+    {
+        status = file.reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+    }
+    mcap_editor::TopicStatsMap stats;
+    if(status.ok())
+    {
+        status = mcap_editor::computeTopicStats(file.reader, stats, threads);
+    }
+    for(const auto& [channel_id, channel_stats]: stats)
+    {
+        result.messages += channel_stats.message_count;
+        result.bytes += channel_stats.bytes;
+    }
+    return status;
+}
+
+mcap::Status readMessages(const std::string& filename, const mcap::ReadMessageOptions& options,
+                          BenchResult& result)
+{
+    OpenedFile file;
+    auto status = file.open(filename);
+    if(!status.ok())
+    {
+        return status;
+    }
+    mcap::Status problem_status;
+    auto problem = [&problem_status](const mcap::Status& problem) { problem_status = problem; };
+    for(const auto& msg: file.reader.readMessages(problem, options))
+    {
+        result.messages++;
+        result.bytes += msg.message.dataSize;
+    }
+    return problem_status;
+}
+
+mcap::Status exportFile(mcap_editor::EditPlan plan, BenchResult& result)
+{
+    mcap_editor::Exporter exporter(std::move(plan));
+    const auto status = exporter.run();
+    const auto& stats = exporter.stats();
+    result.bytes = stats.inputSize();
+    result.messages = stats.totals(mcap_editor::Stage::Write).messages;
+    result.extra = {{"read_amplification", stats.readAmplification()}};
+    return status;
+}
+
+// The uncompressed records of the first chunks of a file, to compress
+mcap::Status loadChunkRecords(const std::string& filename, size_t max_chunks,
+                              std::vector<mcap::ByteArray>& chunks)
+{
+    OpenedFile file;
+    auto status = file.open(filename);
+    if(status.ok())
+    {
+        status = file.reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+    }
+    if(!status.ok())
+    {
+        return status;
+    }
+    std::vector<mcap::ChunkPrefetcher::Request> requests;
+    for(const auto& index: file.reader.chunkIndexes())
+    {
+        if(requests.size() == max_chunks)
+        {
+            break;
+        }
+        requests.push_back({index.chunkStartOffset,
+                            index.chunkStartOffset + index.chunkLength, true});
+    }
+    mcap::ChunkPrefetcher prefetcher(*file.reader.dataSource(), requests, 0);
+    for(const auto& request: requests)
+    {
+        auto chunk = prefetcher.take(request);
+        if(!chunk->status.ok())
+        {
+            return chunk->status;
+        }
+        chunks.emplace_back(chunk->uncompressedRecords,
+                            chunk->uncompressedRecords + chunk->uncompressedSize);
+    }
+    return status;
+}
+
+std::unique_ptr<mcap::IChunkWriter> makeChunkWriter(mcap::Compression compression,
+                                                    mcap::CompressionLevel level,
+                                                    uint64_t chunk_size)
+{
+    if(compression == mcap::Compression::Lz4)
+    {
+        return std::make_unique<mcap::LZ4Writer>(level, chunk_size);
+    }
+    return std::make_unique<mcap::ZStdWriter>(level, chunk_size);
+}
+
+void printUsage(const char* program)
+{
+    std::printf(
+        "Usage: %s [options]\n"
+        "\n"
+        "Generates synthetic MCAP files, and prints the benchmark results as JSON.\n"
+        "\n"
+        "Options:\n"
+        "  -o, --output FILE          write the JSON to FILE instead of stdout\n"
+        "      --dir DIR              where the files are generated (default: temp)\n"
+        "      --keep-files           don't delete the generated files\n"
+        "  -f, --filter TEXT          only run the benchmarks with TEXT in their name\n"
+        "  -n, --iterations N         timed runs of each benchmark (default: 5)\n"
+        "  -j, --threads N            threads of the parallel benchmarks\n"
+        "Synthetic files:\n"
+        "      --topics N             (default: 20)\n"
+        "      --rate HZ              messages per second and topic (default: 100)\n"
+        "      --duration S           seconds of recording (default: 60)\n"
+        "      --message-size BYTES   (default: 1024)\n"
+        "      --size-distribution D  fixed, uniform or lognormal (default: fixed)\n"
+        "      --chunk-size BYTES     (default: %llu)\n"
+        "      --compression NAME     none, lz4 or zstd (default: zstd)\n",
+        program, (unsigned long long)mcap::DefaultChunkSize);
+}
+
+bool parseNumber(const std::string& text, double& value)
+{
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && *end == '\0' && errno == 0 && value >= 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    auto& synthetic = options.synthetic;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        std::string text;
+        double number = 0;
+        auto value = [&]() -> bool
+        {
+            if(i + 1 >= argc)
+            {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                return false;
+            }
+            text = argv[++i];
+            return true;
+        };
+        auto numeric_value = [&]() -> bool
+        {
+            if(!value())
+            {
+                return false;
+            }
+            if(!parseNumber(text, number))
+            {
+                std::fprintf(stderr, "invalid value for %s: %s\n", arg.c_str(), text.c_str());
+                return false;
+            }
+            return true;
+        };
+
+        bool ok = true;
+        if(arg == "-h" || arg == "--help")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if(arg == "-o" || arg == "--output") { ok = value(); options.output_file = text; }
+        else if(arg == "--dir") { ok = value(); options.directory = text; }
+        else if(arg == "--keep-files") { options.keep_files = true; }
+        else if(arg == "-f" || arg == "--filter") { ok = value(); options.filter = text; }
+        else if(arg == "-n" || arg == "--iterations")
+        {
+            ok = numeric_value() && number >= 1;
+            options.iterations = unsigned(number);
+        }
+        else if(arg == "-j" || arg == "--threads")
+        {
+            ok = numeric_value() && number >= 1;
+            options.threads = unsigned(number);
+        }
+        else if(arg == "--topics")
+        {
+            ok = numeric_value() && number >= 1;
+            synthetic.topics = unsigned(number);
+        }
+        else if(arg == "--rate") { ok = numeric_value() && number > 0; synthetic.rate_hz = number; }
+        else if(arg == "--duration") { ok = numeric_value(); synthetic.duration_s = number; }
+        else if(arg == "--message-size")
+        {
+            ok = numeric_value() && number >= 1;
+            synthetic.message_size = uint64_t(number);
+        }
+        else if(arg == "--chunk-size")
+        {
+            ok = numeric_value() && number >= 1;
+            synthetic.chunk_size = uint64_t(number);
+        }
+        else if(arg == "--size-distribution")
+        {
+            ok = value();
+            if(text == "fixed") { synthetic.size_distribution = SyntheticOptions::SizeDistribution::Fixed; }
+            else if(text == "uniform") { synthetic.size_distribution = SyntheticOptions::SizeDistribution::Uniform; }
+            else if(text == "lognormal") { synthetic.size_distribution = SyntheticOptions::SizeDistribution::LogNormal; }
+            else if(ok) { std::fprintf(stderr, "unknown distribution: %s\n", text.c_str()); ok = false; }
+        }
+        else if(arg == "--compression")
+        {
+            ok = value();
+            if(text == "none") { synthetic.compression = mcap::Compression::None; }
+            else if(text == "lz4") { synthetic.compression = mcap::Compression::Lz4; }
+            else if(text == "zstd") { synthetic.compression = mcap::Compression::Zstd; }
+            else if(ok) { std::fprintf(stderr, "unknown compression: %s\n", text.c_str()); ok = false; }
+        }
+        else {
+            std::fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            ok = false;
+        }
+        if(!ok)
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    namespace fs = std::filesystem;
+    std::error_code error;
+    const fs::path directory = options.directory.empty() ?
+        fs::temp_directory_path() / ("mcap_editor_bench_" + std::to_string(std::random_device{}())) :
+        fs::path(options.directory);
+    fs::create_directories(directory, error);
+    if(error)
+    {
+        std::fprintf(stderr, "can't create %s\n", directory.string().c_str());
+        return 1;
+    }
+
+    // The same recording with a summary, without, and with overlapping chunks
+    const std::string indexed_file = (directory / "indexed.mcap").string();
+    const std::string unindexed_file = (directory / "no_summary.mcap").string();
+    const std::string overlapping_file = (directory / "overlapping.mcap").string();
+    const std::string output_file = (directory / "output.mcap").string();
+
+    mcap_editor::SyntheticResult generated;
+    {
+        std::fprintf(stderr, "generating files in %s\n", directory.string().c_str());
+        auto status = mcap_editor::generateSyntheticMcap(synthetic, indexed_file, &generated);
+        auto unindexed = synthetic;
+        unindexed.summary = false;
+        if(status.ok())
+        {
+            status = mcap_editor::generateSyntheticMcap(unindexed, unindexed_file);
+        }
+        auto overlapping = synthetic;
+        overlapping.overlapping_chunks = true;
+        if(status.ok())
+        {
+            status = mcap_editor::generateSyntheticMcap(overlapping, overlapping_file);
+        }
+        if(!status.ok())
+        {
+            std::fprintf(stderr, "can't generate the files: %s\n", status.message.c_str());
+            return 1;
+        }
+    }
+
+    BenchRunner runner(options);
+    const unsigned threads = options.threads;
+
+    // Summary
+    runner.run("read_summary/no_fallback_scan", [&](BenchResult& result) {
+        return readSummary(indexed_file, mcap::ReadSummaryMethod::NoFallbackScan, 0, result);
+    });
+    runner.run("read_summary/fallback_scan", [&](BenchResult& result) {
+        return readSummary(unindexed_file, mcap::ReadSummaryMethod::AllowFallbackScan, 0, result);
+    });
+    runner.run("read_summary/fallback_scan_threads", [&](BenchResult& result) {
+        return readSummary(unindexed_file, mcap::ReadSummaryMethod::AllowFallbackScan, threads,
+                           result);
+    });
+
+    // Topic statistics, from the message indexes
+    runner.run("topic_stats/single_thread", [&](BenchResult& result) {
+        return topicStats(indexed_file, 1, result);
+    });
+    runner.run("topic_stats/threads", [&](BenchResult& result) {
+        return topicStats(indexed_file, threads, result);
+    });
+
+    // Messages
+    using ReadOrder = mcap::ReadMessageOptions::ReadOrder;
+    for(const auto& [file_name, file]: {std::make_pair("indexed", indexed_file),
+                                        std::make_pair("overlapping", overlapping_file)})
+    {
+        const std::string prefix = std::string("read_messages/") + file_name;
+        runner.run(prefix + "/file_order", [&, file = file](BenchResult& result) {
+            mcap::ReadMessageOptions read_options;
+            read_options.readOrder = ReadOrder::FileOrder;
+            return readMessages(file, read_options, result);
+        });
+        runner.run(prefix + "/log_time_order", [&, file = file](BenchResult& result) {
+            mcap::ReadMessageOptions read_options;
+            read_options.readOrder = ReadOrder::LogTimeOrder;
+            return readMessages(file, read_options, result);
+        });
+        runner.run(prefix + "/log_time_order_read_ahead", [&, file = file](BenchResult& result) {
+            mcap::ReadMessageOptions read_options;
+            read_options.readOrder = ReadOrder::LogTimeOrder;
+            read_options.readAheadChunks = 2 * threads;
+            read_options.decompressionThreads = threads;
+            return readMessages(file, read_options, result);
+        });
+    }
+
+    // Export, as done by the GUI and the command line
+    mcap_editor::EditPlan plan;
+    plan.input_file = indexed_file;
+    plan.output_file = output_file;
+    plan.compression = synthetic.compression;
+    plan.chunk_size = synthetic.chunk_size;
+    runner.run("export/copy_chunks", [&](BenchResult& result) {
+        return exportFile(plan, result);
+    });
+    runner.run("export/reencode", [&](BenchResult& result) {
+        auto reencode = plan;
+        reencode.copy_chunks = false;
+        return exportFile(reencode, result);
+    });
+    runner.run("export/reencode_threads", [&](BenchResult& result) {
+        auto reencode = plan;
+        reencode.copy_chunks = false;
+        reencode.log_time_order = true;
+        reencode.read_ahead_chunks = 2 * threads;
+        reencode.decompression_threads = threads;
+        reencode.compression_threads = threads;
+        return exportFile(reencode, result);
+    });
+    runner.run("export/reindex", [&](BenchResult& result) {
+        auto reindex = plan;
+        reindex.input_file = unindexed_file;
+        reindex.keep_chunk_compression = true;
+        reindex.read_ahead_chunks = 2 * threads;
+        reindex.decompression_threads = threads;
+        return exportFile(reindex, result);
+    });
+    runner.run("export/half_topics", [&](BenchResult& result) {
+        auto half = plan;
+        auto& topics = half.topics.emplace();
+        for(unsigned i = 0; i < synthetic.topics; i += 2)
+        {
+            topics.insert("/synthetic/topic_" + std::to_string(i));
+        }
+        return exportFile(half, result);
+    });
+
+    // Chunk records, compressed and decompressed
+    std::vector<mcap::ByteArray> chunks;
+    {
+        auto status = loadChunkRecords(indexed_file, 16, chunks);
+        if(!status.ok() || chunks.empty())
+        {
+            std::fprintf(stderr, "can't read the chunks: %s\n", status.message.c_str());
+            return 1;
+        }
+    }
+
+    runner.run("crc32", [&](BenchResult& result) {
+        uint32_t crc = mcap::internal::CRC32_INIT;
+        for(const auto& chunk: chunks)
+        {
+            crc = mcap::internal::crc32Update(crc, chunk.data(), chunk.size());
+            result.bytes += chunk.size();
+        }
+        result.extra = {{"crc", uint64_t(mcap::internal::crc32Final(crc))}};
+        return mcap::Status();
+    });
+
+    for(auto compression: {mcap::Compression::Lz4, mcap::Compression::Zstd})
+    {
+        for(auto level: {mcap::CompressionLevel::Fastest, mcap::CompressionLevel::Fast,
+                         mcap::CompressionLevel::Default, mcap::CompressionLevel::Slow,
+                         mcap::CompressionLevel::Slowest})
+        {
+            const std::string suffix = std::string(compressionName(compression)) + "/" +
+                                       levelName(level);
+            const auto chunk_writer = makeChunkWriter(compression, level, synthetic.chunk_size);
+            std::vector<mcap::Chunk> compressed_chunks;
+            std::vector<mcap::ByteArray> compressed_data;
+            // Compresses every chunk, returns their compressed size
+            auto compress = [&]() -> uint64_t
+            {
+                uint64_t compressed_size = 0;
+                compressed_chunks.clear();
+                compressed_data.clear();
+                for(const auto& chunk: chunks)
+                {
+                    chunk_writer->clear();
+                    chunk_writer->write(chunk.data(), chunk.size());
+                    chunk_writer->end();
+                    compressed_size += chunk_writer->compressedSize();
+                    compressed_data.emplace_back(chunk_writer->compressedData(),
+                                                 chunk_writer->compressedData() +
+                                                     chunk_writer->compressedSize());
+                }
+                for(size_t i = 0; i < chunks.size(); i++)
+                {
+                    mcap::Chunk compressed;
+                    compressed.compression = compressionName(compression);
+                    compressed.records = compressed_data[i].data();
+                    compressed.compressedSize = compressed_data[i].size();
+                    compressed.uncompressedSize = chunks[i].size();
+                    compressed_chunks.push_back(compressed);
+                }
+                return compressed_size;
+            };
+
+            runner.run("compress/" + suffix, [&](BenchResult& result) {
+                const uint64_t compressed_size = compress();
+                for(const auto& chunk: chunks)
+                {
+                    result.bytes += chunk.size();
+                }
+                result.extra = {{"ratio", double(result.bytes) / double(compressed_size)}};
+                return mcap::Status();
+            });
+
+            // Compressed in its setup, so that it can run without the compress benchmark
+            runner.run("decompress/" + suffix, [&](BenchResult& result) {
+                mcap::ByteArray output;
+                for(const auto& chunk: compressed_chunks)
+                {
+                    auto status = mcap::ChunkPrefetcher::DecompressChunk(chunk, &output);
+                    if(!status.ok())
+                    {
+                        return status;
+                    }
+                    result.bytes += output.size();
+                }
+                return mcap::Status();
+            }, [&]() {
+                compress();
+                return mcap::Status();
+            });
+        }
+    }
+
+    if(!options.keep_files)
+    {
+        for(const auto& file: {indexed_file, unindexed_file, overlapping_file, output_file})
+        {
+            fs::remove(file, error);
+        }
+        if(options.directory.empty())
+        {
+            fs::remove(directory, error);
+        }
+    }
+
+    const std::string json = runner.json(synthetic, generated);
+    if(options.output_file.empty())
+    {
+        std::fputs(json.c_str(), stdout);
+    }
+    else {
+        std::ofstream out(options.output_file);
+        out << json;
+        if(!out)
+        {
+            std::fprintf(stderr, "can't write %s\n", options.output_file.c_str());
+            return 1;
+        }
+    }
+    return runner.failed() ? 1 : 0;
+}
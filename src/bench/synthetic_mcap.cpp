@@ -0,0 +1,141 @@
+#include "synthetic_mcap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+namespace mcap_editor
+{
+
+namespace
+{
+// 2023-11-14, so that the GUI shows dates
+constexpr mcap::Timestamp START_TIME = 1'700'000'000'000'000'000;
+constexpr uint64_t MAX_SIZE_FACTOR = 16;
+}  // namespace
+
+const char* sizeDistributionName(SyntheticOptions::SizeDistribution distribution)
+{
+    switch(distribution)
+    {
+    case SyntheticOptions::SizeDistribution::Fixed: return "fixed";
+    case SyntheticOptions::SizeDistribution::Uniform: return "uniform";
+    case SyntheticOptions::SizeDistribution::LogNormal: return "lognormal";
+    }
+    return "unknown";
+}
+
+mcap::Status generateSyntheticMcap(const SyntheticOptions& options,
+                                   const std::string& filename,
+                                   SyntheticResult* result)
+{
+    if(options.topics == 0 || options.rate_hz <= 0 || options.message_size == 0)
+    {
+        return {mcap::StatusCode::InvalidRecord, "synthetic file without messages"};
+    }
+
+    mcap::McapWriterOptions writer_options("synthetic");
+    writer_options.chunkSize = options.chunk_size;
+    writer_options.compression = options.compression;
+    writer_options.compressionLevel = options.compression_level;
+    writer_options.noSummary = !options.summary;
+
+    mcap::McapWriter writer;
+    auto status = writer.open(filename, writer_options);
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    mcap::Schema schema("synthetic/Payload", "ros2msg", "uint8[] data");
+    writer.addSchema(schema);
+    std::vector<mcap::ChannelId> channel_ids;
+    for(unsigned i = 0; i < options.topics; i++)
+    {
+        mcap::Channel channel("/synthetic/topic_" + std::to_string(i), "cdr", schema.id);
+        writer.addChannel(channel);
+        channel_ids.push_back(channel.id);
+    }
+
+    std::mt19937_64 rng(options.seed);
+
+    // Payloads are windows of a pool of small random values: compressible,
+    // but not trivially
+    const uint64_t max_size = options.message_size * MAX_SIZE_FACTOR;
+    std::vector<std::byte> pool(max_size + 65536);
+    for(auto& byte: pool)
+    {
+        byte = std::byte(rng() % 24);
+    }
+
+    std::uniform_int_distribution<uint64_t> uniform_size(
+        std::min(options.message_size_min, options.message_size), options.message_size);
+    std::lognormal_distribution<double> lognormal_size(
+        std::log(double(options.message_size)), 0.75);
+    auto next_size = [&]() -> uint64_t
+    {
+        switch(options.size_distribution)
+        {
+        case SyntheticOptions::SizeDistribution::Uniform:
+            return uniform_size(rng);
+        case SyntheticOptions::SizeDistribution::LogNormal:
+            return std::clamp<uint64_t>(uint64_t(lognormal_size(rng)), 1, max_size);
+        case SyntheticOptions::SizeDistribution::Fixed:
+        default:
+            return options.message_size;
+        }
+    };
+
+    const uint64_t count_per_topic = uint64_t(options.duration_s * options.rate_hz);
+    const uint64_t period_ns = uint64_t(1e9 / options.rate_hz);
+    // Topics are staggered within each period
+    const uint64_t topic_offset_ns = period_ns / options.topics;
+    // Overlapping chunks: about one chunk of messages of a topic at a time
+    const uint64_t burst = options.overlapping_chunks ?
+                               std::max<uint64_t>(1, options.chunk_size / options.message_size) : 1;
+
+    SyntheticResult totals;
+    std::vector<uint32_t> sequences(options.topics, 0);
+
+    for(uint64_t first = 0; first < count_per_topic && status.ok(); first += burst)
+    {
+        const uint64_t last = std::min(count_per_topic, first + burst);
+        for(unsigned topic = 0; topic < options.topics && status.ok(); topic++)
+        {
+            for(uint64_t i = first; i < last && status.ok(); i++)
+            {
+                const uint64_t size = next_size();
+                const uint64_t offset = rng() % (pool.size() - size);
+
+                mcap::Message message;
+                message.channelId = channel_ids[topic];
+                message.sequence = ++sequences[topic];
+                message.logTime = START_TIME + i * period_ns + topic * topic_offset_ns;
+                message.publishTime = message.logTime;
+                message.data = pool.data() + offset;
+                message.dataSize = size;
+                status = writer.write(message);
+
+                totals.messages++;
+                totals.payload_bytes += size;
+            }
+        }
+    }
+    writer.close();
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    std::error_code error;
+    totals.file_size = std::filesystem::file_size(filename, error);
+    if(result)
+    {
+        *result = totals;
+    }
+    return status;
+}
+
+}  // namespace mcap_editor
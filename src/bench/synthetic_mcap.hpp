@@ -0,0 +1,54 @@
+#pragma once
+
+#include <mcap/writer.hpp>
+#include <string>
+
+namespace mcap_editor
+{
+
+// Shape of a generated recording. Every topic publishes at the same rate.
+struct SyntheticOptions
+{
+    enum class SizeDistribution
+    {
+        Fixed,    // always message_size
+        Uniform,  // between message_size_min and message_size
+        LogNormal // median message_size, long tail up to 16x
+    };
+
+    unsigned topics = 20;
+    double rate_hz = 100.0;
+    double duration_s = 60.0;
+
+    uint64_t message_size = 1024;
+    uint64_t message_size_min = 64;
+    SizeDistribution size_distribution = SizeDistribution::Fixed;
+
+    uint64_t chunk_size = mcap::DefaultChunkSize;
+    mcap::Compression compression = mcap::Compression::Zstd;
+    mcap::CompressionLevel compression_level = mcap::CompressionLevel::Default;
+
+    // Messages are written in bursts per topic, as if several recorders were
+    // merged: consecutive chunks cover the same time span
+    bool overlapping_chunks = false;
+    bool summary = true;
+
+    uint32_t seed = 42;
+};
+
+struct SyntheticResult
+{
+    uint64_t messages = 0;
+    uint64_t payload_bytes = 0;
+    uint64_t file_size = 0;
+};
+
+const char* sizeDistributionName(SyntheticOptions::SizeDistribution distribution);
+
+// Writes a recording to filename. Payloads are pseudo random but compressible,
+// and depend only on the options.
+mcap::Status generateSyntheticMcap(const SyntheticOptions& options,
+                                   const std::string& filename,
+                                   SyntheticResult* result = nullptr);
+
+}  // namespace mcap_editor
@@ -0,0 +1,891 @@
+#include "batch.hpp"
+#include "compression_analysis.hpp"
+#include "edit_config.hpp"
+#include "exporter.hpp"
+#include "file_info.hpp"
+#include "merger.hpp"
+#include "splitter.hpp"
+#include "topic_stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <limits>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+void printUsage(const char* program)
+{
+    std::printf(
+        "Usage: %s [options] <input.mcap> [output.mcap]\n"
+        "       %s --merge [options] <input.mcap>... <output.mcap>\n"
+        "       %s --batch [options] <directory|pattern>... <output-directory>\n"
+        "\n"
+        "Without an output file, prints the topics of the input file. With\n"
+        "--merge, writes the messages of all the inputs to the output, in log\n"
+        "time order. With --batch, edits every MCAP file of the directories, or\n"
+        "matching the patterns (e.g. 'logs/run_*.mcap'), to a file of the same\n"
+        "name in the output directory.\n"
+        "\n"
+        "Options:\n"
+        "  -t, --topic NAME           keep this topic (repeatable, default: all)\n"
+        "  -x, --exclude NAME         drop this topic (repeatable)\n"
+        "      --channel ID           keep this channel, by the id listed with the\n"
+        "                             topics, to pick one of several channels\n"
+        "                             sharing a topic (repeatable, default: all)\n"
+        "      --attachment NAME      keep the attachments of this name (repeatable,\n"
+        "                             default: all)\n"
+        "      --no-attachments       drop every attachment\n"
+        "      --start NS             drop the messages logged before NS\n"
+        "      --end NS               drop the messages logged at or after NS\n"
+        "      --skip TIME            drop the first TIME of the recording, from its\n"
+        "                             first message (nanoseconds, or s, m, h suffix)\n"
+        "      --duration TIME        keep TIME of the recording after that\n"
+        "  -c, --compression NAME     none, lz4 or zstd (default: zstd)\n"
+        "  -l, --level NAME           fastest, fast, default, slow or slowest\n"
+        "      --chunk-size BYTES     uncompressed size of the output chunks\n"
+        "      --group-chunks         write high-bandwidth topics to chunks of their\n"
+        "                             own, and don't compress images and video again\n"
+        "      --chunk-group PATTERN=COMPRESSION\n"
+        "                             write the topics matching PATTERN ('*' and '?'\n"
+        "                             wildcards) to chunks of their own, with their\n"
+        "                             own compression (repeatable, before\n"
+        "                             --group-chunks)\n"
+        "  -j, --threads N            compression, decompression and scan threads\n"
+        "                             (default: number of cores)\n"
+        "      --no-chunk-copy        decode every chunk, even unchanged ones\n"
+        "      --log-time-order       write the messages decoded in log time order,\n"
+        "                             rather than in the order of the input\n"
+        "      --reindex              copy the chunks kept entirely whatever their\n"
+        "                             compression: repairs a file without summary or\n"
+        "                             message indexes without compressing it again\n"
+        "      --async-io             read the chunks ahead and write the output with\n"
+        "                             several requests in flight (io_uring on Linux)\n"
+        "      --write-behind         write the output in large blocks from another\n"
+        "                             thread (implied by the options below)\n"
+        "      --write-block SIZE     size of these blocks (K, M, G suffix, default 8M)\n"
+        "      --direct-io            write the output without the page cache\n"
+        "                             (O_DIRECT)\n"
+        "      --preallocate          allocate the estimated size of the output first\n"
+        "      --fsync WHEN           make the output durable: 'close', or every SIZE\n"
+        "                             bytes written (K, M, G suffix)\n"
+        "      --no-summary-cache     scan files without summary every time, instead\n"
+        "                             of caching their summary\n"
+        "      --topic-stats          with no output file, also print the size, rates,\n"
+        "                             largest gap and jitter of each topic, read from\n"
+        "                             the message indexes\n"
+        "      --analyze-compression  with no output file, compress a sample of the\n"
+        "                             chunks with each codec, level and chunk size, and\n"
+        "                             print their ratio and speed\n"
+        "      --bandwidth MBPS       upload bandwidth in MB/s, for the option that\n"
+        "                             --analyze-compression recommends (default: 10)\n"
+        "      --split-size SIZE      cut the output into files of at most SIZE\n"
+        "                             bytes, or KiB, MiB, GiB with a K, M, G suffix\n"
+        "      --split-duration TIME  cut the output into files covering TIME\n"
+        "                             nanoseconds, or seconds, minutes, hours with\n"
+        "                             an s, m, h suffix. The files are numbered\n"
+        "                             after the output, e.g. output_000.mcap\n"
+        "      --merge                merge the input files into the last one\n"
+        "      --clock-offset NS      add NS (possibly negative) to the times of the\n"
+        "                             messages of the inputs that follow, with --merge\n"
+        "      --batch                edit many files, several at a time, and print a\n"
+        "                             report of each (tab separated)\n"
+        "      --jobs N               files edited at a time with --batch, sharing\n"
+        "                             the threads of -j (default: as many as threads)\n"
+        "      --job-memory SIZE      with --batch, limit the chunks each file has in\n"
+        "                             flight to SIZE bytes (K, M, G suffix)\n"
+        "      --config FILE          load the edit options (topics, time range,\n"
+        "                             compression, chunks) saved with --save-config;\n"
+        "                             the options after it override them\n"
+        "      --save-config FILE     save the edit options given before it to FILE\n"
+        "                             and exit\n"
+        "  -q, --quiet                don't print the progress\n"
+        "      --stats                print the time spent in each stage\n"
+        "      --trace FILE           write the timing of each chunk as a Chrome\n"
+        "                             trace (chrome://tracing, ui.perfetto.dev)\n"
+        "  -h, --help                 show this message\n",
+        program, program, program);
+}
+
+// A number, with an optional unit suffix from units (e.g. "KMG") multiplying it
+// by the matching factor
+bool parseWithUnit(const std::string& text, const std::string& units,
+                   const std::vector<uint64_t>& factors, uint64_t& value)
+{
+    const size_t unit = text.empty() ? std::string::npos : units.find(text.back());
+    uint64_t factor = 1;
+    std::string digits = text;
+    if(unit != std::string::npos)
+    {
+        factor = factors[unit];
+        digits.pop_back();
+    }
+    if(!mcap_editor::parseNumber(digits, value) ||
+       value > std::numeric_limits<uint64_t>::max() / factor)
+    {
+        return false;
+    }
+    value *= factor;
+    return true;
+}
+
+bool parseOffset(const std::string& text, int64_t& value)
+{
+    const bool negative = !text.empty() && text[0] == '-';
+    uint64_t magnitude = 0;
+    if(!mcap_editor::parseNumber(negative ? text.substr(1) : text, magnitude) ||
+       magnitude > uint64_t(std::numeric_limits<int64_t>::max()))
+    {
+        return false;
+    }
+    value = negative ? -int64_t(magnitude) : int64_t(magnitude);
+    return true;
+}
+
+// The write-behind options of plan, enabling it
+mcap_editor::WriteBehindOptions& writeBehind(mcap_editor::EditPlan& plan)
+{
+    if(!plan.write_behind)
+    {
+        plan.write_behind.emplace();
+    }
+    return *plan.write_behind;
+}
+
+// Read-ahead and threads of plan for threads cores
+void setThreads(mcap_editor::EditPlan& plan, unsigned threads)
+{
+    if(threads > 1)
+    {
+        plan.read_ahead_chunks = 2 * threads;
+        plan.decompression_threads = threads;
+        plan.compression_threads = threads - 1;
+    }
+}
+
+// Prints the error, and returns the exit code, if filename can't be read
+int readInfo(const std::string& filename, unsigned threads,
+             const mcap_editor::SummaryCache* cache, mcap_editor::FileInfo& info)
+{
+    mcap::McapReader reader;
+    mcap_editor::MmapReader mmap_reader;
+    auto status = mcap_editor::openFile(reader, mmap_reader, filename,
+                                        mcap_editor::MmapReader::AccessPattern::Random);
+    if(status.ok())
+    {
+        status = mcap_editor::readFileInfo(reader, info, threads, cache, filename);
+    }
+    if(!status.ok())
+    {
+        std::fprintf(stderr, "%s: %s\n", filename.c_str(), status.message.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+int printInfo(const std::string& filename, unsigned threads,
+              const mcap_editor::SummaryCache* cache, bool topic_stats)
+{
+    mcap::McapReader reader;
+    mcap_editor::MmapReader mmap_reader;
+    auto status = mcap_editor::openFile(reader, mmap_reader, filename,
+                                        mcap_editor::MmapReader::AccessPattern::Random);
+    mcap_editor::FileInfo info;
+    if(status.ok())
+    {
+        status = mcap_editor::readFileInfo(reader, info, threads, cache, filename);
+    }
+    if(!status.ok())
+    {
+        std::fprintf(stderr, "%s: %s\n", filename.c_str(), status.message.c_str());
+        return 1;
+    }
+
+    std::printf("profile: %s\n", info.profile.c_str());
+    std::printf("start:   %llu\n", (unsigned long long)info.start_time);
+    std::printf("end:     %llu\n", (unsigned long long)info.end_time);
+    mcap_editor::TopicStatsMap stats;
+    if(topic_stats)
+    {
+        status = mcap_editor::computeTopicStats(reader, stats, threads);
+        if(!status.ok())
+        {
+            std::fprintf(stderr, "%s: no topic statistics: %s\n", filename.c_str(),
+                         status.message.c_str());
+            topic_stats = false;
+        }
+    }
+    std::printf("topics:\n");
+    if(topic_stats)
+    {
+        std::printf("  # id\ttopic\tschema\tencoding\tmessages\tbytes\tcompressed_bytes"
+                    "\trate_hz\tmin_rate_hz\tmax_rate_hz\tmax_gap_s\tjitter_ms\n");
+    }
+    for(const auto& topic: info.topics)
+    {
+        std::printf("  %u\t%s\t%s\t%s\t%llu", unsigned(topic.channel_id), topic.topic.c_str(),
+                    topic.schema_name.c_str(), topic.message_encoding.c_str(),
+                    (unsigned long long)topic.message_count);
+        if(topic_stats)
+        {
+            const auto& channel_stats = stats[topic.channel_id];
+            std::printf("\t%llu\t%llu\t%.3f\t%.3f\t%.3f\t%.6f\t%.3f",
+                        (unsigned long long)channel_stats.bytes,
+                        (unsigned long long)channel_stats.compressed_bytes,
+                        channel_stats.averageRate(), channel_stats.minRate(), channel_stats.maxRate(),
+                        double(channel_stats.max_gap) / 1e9, channel_stats.jitter / 1e6);
+        }
+        std::printf("\n");
+    }
+    if(!info.attachments.empty())
+    {
+        std::printf("attachments:\n");
+        for(const auto& attachment: info.attachments)
+        {
+            std::printf("  %s\t%s\t%llu\t%llu\n", attachment.name.c_str(),
+                        attachment.media_type.c_str(), (unsigned long long)attachment.log_time,
+                        (unsigned long long)attachment.data_size);
+        }
+    }
+    if(info.metadata_count > 0)
+    {
+        std::printf("metadata: %zu\n", info.metadata_count);
+    }
+    return 0;
+}
+
+int analyzeCompression(const std::string& filename, unsigned threads,
+                       const mcap_editor::SummaryCache* cache, double bandwidth)
+{
+    mcap::McapReader reader;
+    mcap_editor::MmapReader mmap_reader;
+    auto status = mcap_editor::openFile(reader, mmap_reader, filename,
+                                        mcap_editor::MmapReader::AccessPattern::Random);
+    mcap_editor::FileInfo info;
+    if(status.ok())
+    {
+        status = mcap_editor::readFileInfo(reader, info, threads, cache, filename);
+    }
+    mcap_editor::CompressionAnalysisSettings settings;
+    settings.threads = threads;
+    std::vector<mcap_editor::CompressionMeasure> measures;
+    if(status.ok())
+    {
+        status = mcap_editor::analyzeCompression(reader, settings, measures);
+    }
+    if(!status.ok())
+    {
+        std::fprintf(stderr, "%s: %s\n", filename.c_str(), status.message.c_str());
+        return 1;
+    }
+
+    constexpr double MB = 1e6;
+    uint64_t uncompressed_bytes = 0;
+    for(const auto& chunk_index: reader.chunkIndexes())
+    {
+        uncompressed_bytes += chunk_index.uncompressedSize;
+    }
+    std::printf("sample: %.1f MB of %.1f MB, uncompressed\n",
+                double(measures.front().uncompressed_bytes) / MB,
+                double(uncompressed_bytes) / MB);
+    std::printf("  # option\tratio\tcompress_mb_s\tdecompress_mb_s\n");
+    for(const auto& measure: measures)
+    {
+        std::printf("  %s\t%.3f\t%.1f\t%.1f\n", measure.option.name().c_str(), measure.ratio(),
+                    measure.compressSpeed() / MB, measure.decompressSpeed() / MB);
+    }
+    const size_t best = mcap_editor::recommendCompression(measures, bandwidth * MB);
+    std::printf("recommended at %.1f MB/s: %s\n", bandwidth, measures[best].option.name().c_str());
+    return 0;
+}
+
+// Runs an Exporter or a Merger, printing its progress
+template <typename Job>
+int runJob(Job& job, const mcap_editor::SummaryCache* cache, bool quiet, bool print_stats,
+           const std::string& trace_file)
+{
+    job.setTracing(!trace_file.empty());
+    if(cache)
+    {
+        job.setSummaryCache(*cache);
+    }
+    int last_percent = -1;
+    if(!quiet)
+    {
+        job.setProgressCallback([&last_percent](uint64_t done, uint64_t total) {
+            const int percent = total > 0 ? int(100 * std::min(done, total) / total) : 0;
+            if(percent != last_percent)
+            {
+                last_percent = percent;
+                std::fprintf(stderr, "\r%3d%%", percent);
+            }
+        });
+    }
+
+    const auto status = job.run();
+    if(!quiet)
+    {
+        std::fprintf(stderr, status.ok() ? "\r100%%\n" : "\n");
+    }
+    if(!status.ok())
+    {
+        std::fprintf(stderr, "%s\n", status.message.c_str());
+        return 1;
+    }
+    if(print_stats)
+    {
+        std::fprintf(stderr, "%s", job.stats().report().c_str());
+    }
+    if(!trace_file.empty() && !job.stats().writeChromeTrace(trace_file))
+    {
+        std::fprintf(stderr, "can't write %s\n", trace_file.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// Edits the MCAP files of patterns to output_dir, printing a line per file
+int runBatch(const std::vector<std::string>& patterns, const std::string& output_dir,
+             const mcap_editor::EditConfig& config, const mcap_editor::BatchSettings& settings,
+             const mcap_editor::SummaryCache* cache, bool quiet)
+{
+    std::vector<std::string> inputs;
+    for(const auto& pattern: patterns)
+    {
+        std::vector<std::string> files;
+        const auto status = mcap_editor::listBatchFiles(pattern, files);
+        if(!status.ok())
+        {
+            std::fprintf(stderr, "%s\n", status.message.c_str());
+            return 1;
+        }
+        inputs.insert(inputs.end(), files.begin(), files.end());
+    }
+    std::error_code error;
+    std::filesystem::create_directories(output_dir, error);
+    if(error)
+    {
+        std::fprintf(stderr, "%s: %s\n", output_dir.c_str(), error.message().c_str());
+        return 1;
+    }
+    std::vector<mcap_editor::BatchJob> jobs;
+    const auto status = mcap_editor::makeBatchJobs(inputs, output_dir, jobs);
+    if(!status.ok())
+    {
+        std::fprintf(stderr, "%s\n", status.message.c_str());
+        return 1;
+    }
+
+    mcap_editor::BatchRunner runner(config, std::move(jobs), settings);
+    if(cache)
+    {
+        runner.setSummaryCache(*cache);
+    }
+    size_t done = 0;
+    if(!quiet)
+    {
+        const size_t total = runner.jobs().size();
+        runner.setResultCallback([&done, total](const mcap_editor::BatchResult& result) {
+            std::fprintf(stderr, "[%zu/%zu] %s: %s\n", ++done, total,
+                         result.job.input_file.c_str(),
+                         result.status.ok() ? "ok" : result.status.message.c_str());
+        });
+    }
+    const auto results = runner.run();
+
+    constexpr double MB = 1e6;
+    bool failed = false;
+    std::printf("# file\tstatus\tinput_bytes\toutput_bytes\tmessages\tseconds\tinput_mb_s\n");
+    for(const auto& result: results)
+    {
+        std::printf("%s\t%s\t%llu\t%llu\t%llu\t%.3f\t%.1f\n", result.job.input_file.c_str(),
+                    result.status.ok() ? "ok" : result.status.message.c_str(),
+                    (unsigned long long)result.input_bytes,
+                    (unsigned long long)result.output_bytes,
+                    (unsigned long long)result.messages, result.seconds,
+                    result.seconds > 0 ? double(result.input_bytes) / MB / result.seconds : 0.0);
+        failed = failed || !result.status.ok();
+    }
+    return failed ? 1 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    // What --save-config saves
+    mcap_editor::EditConfig config;
+    auto& plan = config.plan;
+    std::vector<std::string> files;
+    // Clock offset of each file, with --merge
+    std::vector<int64_t> clock_offsets;
+    int64_t clock_offset = 0;
+    bool merge = false;
+    mcap_editor::SplitLimits split;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool quiet = false;
+    bool print_stats = false;
+    std::string trace_file;
+    bool use_summary_cache = true;
+    bool topic_stats = false;
+    bool analyze_compression = false;
+    double bandwidth = 10;
+    bool batch = false;
+    mcap_editor::BatchSettings batch_settings;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const std::string arg = argv[i];
+        // Options that take a value
+        auto value = [&](std::string& out) -> bool
+        {
+            if(i + 1 >= argc)
+            {
+                std::fprintf(stderr, "%s needs a value\n", arg.c_str());
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+        std::string text;
+        uint64_t number = 0;
+
+        if(arg == "-h" || arg == "--help")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else if(arg == "-t" || arg == "--topic")
+        {
+            if(!value(text)) { return 2; }
+            if(!plan.topics) { plan.topics.emplace(); }
+            plan.topics->insert(text);
+        }
+        else if(arg == "-x" || arg == "--exclude")
+        {
+            if(!value(text)) { return 2; }
+            config.excluded_topics.push_back(text);
+        }
+        else if(arg == "--channel")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseNumber(text, number) ||
+               number > std::numeric_limits<mcap::ChannelId>::max())
+            {
+                std::fprintf(stderr, "invalid channel id: %s\n", text.c_str());
+                return 2;
+            }
+            if(!plan.channels) { plan.channels.emplace(); }
+            plan.channels->insert(mcap::ChannelId(number));
+        }
+        else if(arg == "--attachment")
+        {
+            if(!value(text)) { return 2; }
+            if(!plan.attachments) { plan.attachments.emplace(); }
+            plan.attachments->insert(text);
+        }
+        else if(arg == "--no-attachments")
+        {
+            plan.attachments.emplace();
+        }
+        else if(arg == "--start" || arg == "--end")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseNumber(text, number))
+            {
+                std::fprintf(stderr, "invalid time: %s\n", text.c_str());
+                return 2;
+            }
+            (arg == "--start" ? plan.start_time : plan.end_time) = number;
+        }
+        else if(arg == "--skip" || arg == "--duration")
+        {
+            constexpr uint64_t NS_PER_S = 1000000000;
+            if(!value(text)) { return 2; }
+            if(!parseWithUnit(text, "smh", {NS_PER_S, 60 * NS_PER_S, 3600 * NS_PER_S}, number) ||
+               (arg == "--duration" && number == 0))
+            {
+                std::fprintf(stderr, "invalid time: %s\n", text.c_str());
+                return 2;
+            }
+            (arg == "--skip" ? config.skip : config.duration) = number;
+        }
+        else if(arg == "-c" || arg == "--compression")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseCompression(text, plan.compression))
+            {
+                std::fprintf(stderr, "unknown compression: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "-l" || arg == "--level")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseCompressionLevel(text, plan.compression_level))
+            {
+                std::fprintf(stderr, "unknown compression level: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--chunk-size")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseNumber(text, plan.chunk_size) || plan.chunk_size == 0)
+            {
+                std::fprintf(stderr, "invalid chunk size: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--group-chunks")
+        {
+            plan.chunk_grouping.automatic = true;
+        }
+        else if(arg == "--chunk-group")
+        {
+            if(!value(text)) { return 2; }
+            mcap_editor::ChunkGroupRule rule;
+            if(!mcap_editor::parseChunkGroupRule(text, rule))
+            {
+                std::fprintf(stderr, "invalid chunk group: %s\n", text.c_str());
+                return 2;
+            }
+            plan.chunk_grouping.rules.push_back(std::move(rule));
+        }
+        else if(arg == "-j" || arg == "--threads")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseNumber(text, number))
+            {
+                std::fprintf(stderr, "invalid number of threads: %s\n", text.c_str());
+                return 2;
+            }
+            threads = unsigned(number);
+        }
+        else if(arg == "--no-chunk-copy")
+        {
+            plan.copy_chunks = false;
+        }
+        else if(arg == "--log-time-order")
+        {
+            plan.log_time_order = true;
+        }
+        else if(arg == "--reindex")
+        {
+            plan.keep_chunk_compression = true;
+        }
+        else if(arg == "--async-io")
+        {
+            plan.async_io = true;
+        }
+        else if(arg == "--write-behind")
+        {
+            writeBehind(plan);
+        }
+        else if(arg == "--write-block")
+        {
+            if(!value(text)) { return 2; }
+            if(!parseWithUnit(text, "KMG", {uint64_t(1) << 10, uint64_t(1) << 20, uint64_t(1) << 30},
+                              number) || number == 0)
+            {
+                std::fprintf(stderr, "invalid block size: %s\n", text.c_str());
+                return 2;
+            }
+            writeBehind(plan).block_size = number;
+        }
+        else if(arg == "--direct-io")
+        {
+            writeBehind(plan).direct = true;
+        }
+        else if(arg == "--preallocate")
+        {
+            writeBehind(plan).preallocate = true;
+        }
+        else if(arg == "--fsync")
+        {
+            if(!value(text)) { return 2; }
+            auto& options = writeBehind(plan);
+            if(text == "close")
+            {
+                options.sync = mcap_editor::FileSync::Close;
+            }
+            else if(parseWithUnit(text, "KMG",
+                                  {uint64_t(1) << 10, uint64_t(1) << 20, uint64_t(1) << 30},
+                                  number) && number > 0)
+            {
+                options.sync = mcap_editor::FileSync::Interval;
+                options.sync_interval = number;
+            }
+            else {
+                std::fprintf(stderr, "invalid fsync policy: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--no-summary-cache")
+        {
+            use_summary_cache = false;
+        }
+        else if(arg == "--topic-stats")
+        {
+            topic_stats = true;
+        }
+        else if(arg == "--analyze-compression")
+        {
+            analyze_compression = true;
+        }
+        else if(arg == "--bandwidth")
+        {
+            if(!value(text)) { return 2; }
+            char* end = nullptr;
+            bandwidth = std::strtod(text.c_str(), &end);
+            if(end == text.c_str() || *end != '\0' || !(bandwidth > 0))
+            {
+                std::fprintf(stderr, "invalid bandwidth: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--split-size")
+        {
+            if(!value(text)) { return 2; }
+            if(!parseWithUnit(text, "KMG", {uint64_t(1) << 10, uint64_t(1) << 20, uint64_t(1) << 30},
+                              split.max_bytes) || split.max_bytes == 0)
+            {
+                std::fprintf(stderr, "invalid split size: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--split-duration")
+        {
+            constexpr uint64_t NS_PER_S = 1000000000;
+            if(!value(text)) { return 2; }
+            if(!parseWithUnit(text, "smh", {NS_PER_S, 60 * NS_PER_S, 3600 * NS_PER_S},
+                              split.max_duration) || split.max_duration == 0)
+            {
+                std::fprintf(stderr, "invalid split duration: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--merge")
+        {
+            merge = true;
+        }
+        else if(arg == "--clock-offset")
+        {
+            if(!value(text)) { return 2; }
+            if(!parseOffset(text, clock_offset))
+            {
+                std::fprintf(stderr, "invalid clock offset: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--batch")
+        {
+            batch = true;
+        }
+        else if(arg == "--jobs")
+        {
+            if(!value(text)) { return 2; }
+            if(!mcap_editor::parseNumber(text, number) || number == 0)
+            {
+                std::fprintf(stderr, "invalid number of jobs: %s\n", text.c_str());
+                return 2;
+            }
+            batch_settings.threads = unsigned(number);
+        }
+        else if(arg == "--job-memory")
+        {
+            if(!value(text)) { return 2; }
+            if(!parseWithUnit(text, "KMG", {uint64_t(1) << 10, uint64_t(1) << 20, uint64_t(1) << 30},
+                              batch_settings.job_memory) || batch_settings.job_memory == 0)
+            {
+                std::fprintf(stderr, "invalid job memory: %s\n", text.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--config")
+        {
+            if(!value(text)) { return 2; }
+            const auto status = mcap_editor::loadEditConfig(text, config);
+            if(!status.ok())
+            {
+                std::fprintf(stderr, "%s\n", status.message.c_str());
+                return 2;
+            }
+        }
+        else if(arg == "--save-config")
+        {
+            if(!value(text)) { return 2; }
+            const auto status = mcap_editor::saveEditConfig(text, config);
+            if(!status.ok())
+            {
+                std::fprintf(stderr, "%s\n", status.message.c_str());
+                return 1;
+            }
+            return 0;
+        }
+        else if(arg == "-q" || arg == "--quiet")
+        {
+            quiet = true;
+        }
+        else if(arg == "--stats")
+        {
+            print_stats = true;
+        }
+        else if(arg == "--trace")
+        {
+            if(!value(trace_file)) { return 2; }
+        }
+        else if(arg.size() > 1 && arg[0] == '-')
+        {
+            std::fprintf(stderr, "unknown option: %s\n", arg.c_str());
+            printUsage(argv[0]);
+            return 2;
+        }
+        else {
+            files.push_back(arg);
+            clock_offsets.push_back(clock_offset);
+        }
+    }
+
+    if(merge && (files.size() < 2 || plan.channels || analyze_compression))
+    {
+        // Channel ids are those of a single file
+        std::fprintf(stderr, "--merge needs inputs and an output, and no --channel\n");
+        return 2;
+    }
+    if(merge && split.enabled())
+    {
+        std::fprintf(stderr, "--merge and --split-size or --split-duration can't be combined\n");
+        return 2;
+    }
+    if(merge && (config.skip != 0 || config.duration != 0))
+    {
+        std::fprintf(stderr, "--skip and --duration can't be used with --merge\n");
+        return 2;
+    }
+    if(batch && (files.size() < 2 || merge || split.enabled() || plan.channels ||
+                 analyze_compression))
+    {
+        std::fprintf(stderr, "--batch needs inputs and an output directory, and no --merge,\n"
+                             "--split-size, --split-duration or --channel\n");
+        return 2;
+    }
+    if(!merge && clock_offset != 0)
+    {
+        std::fprintf(stderr, "--clock-offset needs --merge\n");
+        return 2;
+    }
+    if(files.empty() || (files.size() > 2 && !merge && !batch))
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+    const mcap_editor::SummaryCache summary_cache(mcap_editor::SummaryCache::defaultDirectory());
+    const auto* cache = use_summary_cache ? &summary_cache : nullptr;
+    if(files.size() == 1 && analyze_compression)
+    {
+        return analyzeCompression(files[0], threads, cache, bandwidth);
+    }
+    if(files.size() == 1)
+    {
+        return printInfo(files[0], threads, cache, topic_stats);
+    }
+
+    if(plan.start_time >= plan.end_time)
+    {
+        std::fprintf(stderr, "the time range is empty\n");
+        return 2;
+    }
+
+    if(batch)
+    {
+        // The files edited at a time share the threads
+        if(batch_settings.threads == 0)
+        {
+            batch_settings.threads = threads;
+        }
+        setThreads(plan, batch_settings.threads > 0 ? threads / batch_settings.threads : 1);
+        const auto output_dir = files.back();
+        files.pop_back();
+        return runBatch(files, output_dir, config, batch_settings, cache, quiet);
+    }
+
+    plan.output_file = files.back();
+    files.pop_back();
+    plan.input_file = files[0];
+
+    if(merge && !config.excluded_topics.empty())
+    {
+        // Exclusions need the list of topics of the files
+        std::set<std::string> topics;
+        for(const auto& file: files)
+        {
+            mcap_editor::FileInfo info;
+            if(readInfo(file, threads, cache, info) != 0)
+            {
+                return 1;
+            }
+            for(const auto& topic: info.topics)
+            {
+                if(plan.keepsTopic(topic.topic))
+                {
+                    topics.insert(topic.topic);
+                }
+            }
+        }
+        for(const auto& topic: config.excluded_topics)
+        {
+            topics.erase(topic);
+        }
+        plan.topics = std::move(topics);
+    }
+    else if(!merge && (!config.excluded_topics.empty() || config.skip != 0 || config.duration != 0))
+    {
+        // Same, and --skip needs the time of its first message
+        mcap_editor::FileInfo info;
+        if(readInfo(plan.input_file, threads, cache, info) != 0)
+        {
+            return 1;
+        }
+        plan = mcap_editor::resolveEditConfig(config, info);
+    }
+
+    setThreads(plan, threads);
+
+    if(merge)
+    {
+        std::vector<mcap_editor::MergeInput> inputs;
+        for(size_t i = 0; i < files.size(); i++)
+        {
+            inputs.push_back({files[i], clock_offsets[i]});
+        }
+        mcap_editor::Merger merger(std::move(inputs), plan);
+        return runJob(merger, cache, quiet, print_stats, trace_file);
+    }
+    if(split.enabled())
+    {
+        mcap_editor::Splitter splitter(plan, split);
+        const int result = runJob(splitter, cache, quiet, print_stats, trace_file);
+        if(splitter.lateMessages() > 0)
+        {
+            std::fprintf(stderr,
+                         "%llu messages out of log time order, in an input without message "
+                         "indexes, went to a file after their time window\n",
+                         (unsigned long long)splitter.lateMessages());
+        }
+        // For scripts, e.g. to upload them
+        for(const auto& file: splitter.files())
+        {
+            std::printf("%s\n", file.c_str());
+        }
+        return result;
+    }
+    mcap_editor::Exporter exporter(plan);
+    return runJob(exporter, cache, quiet, print_stats, trace_file);
+}
@@ -0,0 +1,277 @@
+#include "compression_dialog.h"
+#include "file_info.hpp"
+
+#include <QCoreApplication>
+#include <QDialogButtonBox>
+#include <QDoubleSpinBox>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QSettings>
+#include <QTableWidget>
+#include <QThread>
+#include <QVBoxLayout>
+#include <cmath>
+
+namespace
+{
+enum Column
+{
+    COLUMN_OPTION = 0,
+    COLUMN_RATIO,
+    COLUMN_COMPRESS,
+    COLUMN_DECOMPRESS,
+    COLUMN_THROUGHPUT,
+    COLUMNS
+};
+
+constexpr double MB = 1e6;
+constexpr double DEFAULT_BANDWIDTH = 10;
+
+// Rounded, so that the table shows a few digits but sorts by value
+QTableWidgetItem* numberItem(double value, int decimals)
+{
+    const double scale = std::pow(10.0, decimals);
+    auto item = new QTableWidgetItem();
+    item->setData(Qt::DisplayRole, std::round(value * scale) / scale);
+    item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+    return item;
+}
+
+// Called on a worker thread, except in the browser
+mcap::Status analyze(const QString& input_file, const QByteArray& input_buffer,
+                     std::vector<mcap_editor::CompressionMeasure>& measures,
+                     const std::atomic_bool& cancel)
+{
+    mcap_editor::CompressionAnalysisSettings settings;
+    mcap::McapReader reader;
+    mcap::BufferReader read_buffer;
+    mcap_editor::MmapReader mmap_reader;
+    mcap_editor::FileInfo info;
+    mcap::Status status;
+    if(!input_buffer.isEmpty())
+    {
+        read_buffer.reset(reinterpret_cast<const std::byte*>(input_buffer.data()),
+                          input_buffer.size(), input_buffer.size());
+        status = reader.open(read_buffer);
+        if(status.ok())
+        {
+            status = mcap_editor::readFileInfo(reader, info);
+        }
+    }
+    else {
+        status = mcap_editor::openFile(reader, mmap_reader, input_file.toStdString(),
+                                       mcap_editor::MmapReader::AccessPattern::Random);
+        // Files without summary were scanned when they were opened
+        const mcap_editor::SummaryCache cache(mcap_editor::SummaryCache::defaultDirectory());
+        if(status.ok())
+        {
+            status = mcap_editor::readFileInfo(reader, info, QThread::idealThreadCount(), &cache,
+                                               input_file.toStdString());
+        }
+    }
+#ifdef USING_WASM
+    // No threads in the browser, and the page is frozen while it runs
+    settings.threads = 1;
+    settings.sample_bytes = 4 * 1024 * 1024;
+#else
+    settings.threads = unsigned(std::max(1, QThread::idealThreadCount()));
+#endif
+    if(status.ok())
+    {
+        status = mcap_editor::analyzeCompression(reader, settings, measures, &cancel);
+    }
+    return status;
+}
+}
+
+CompressionDialog::CompressionDialog(QString input_file, QByteArray input_buffer,
+                                     QWidget *parent) :
+    QDialog(parent),
+    input_file_(std::move(input_file)),
+    input_buffer_(std::move(input_buffer))
+{
+    setWindowTitle("Analyze compression");
+    auto layout = new QVBoxLayout(this);
+
+    label_status_ = new QLabel("Compressing a sample of the file with each option...", this);
+    label_status_->setWordWrap(true);
+    layout->addWidget(label_status_);
+
+    table_ = new QTableWidget(0, COLUMNS, this);
+    table_->setHorizontalHeaderLabels({"Option", "Ratio", "Compression [MB/s]",
+                                       "Decompression [MB/s]", "Compression + upload [MB/s]"});
+    table_->horizontalHeaderItem(COLUMN_COMPRESS)->setToolTip(
+        "Uncompressed bytes per second, on one core");
+    table_->horizontalHeaderItem(COLUMN_THROUGHPUT)->setToolTip(
+        "Uncompressed bytes per second, when one core compresses while the output is "
+        "uploaded at the bandwidth below");
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table_->setSelectionMode(QAbstractItemView::SingleSelection);
+    table_->verticalHeader()->setVisible(false);
+    table_->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    table_->horizontalHeader()->setSectionResizeMode(COLUMN_OPTION, QHeaderView::Stretch);
+    layout->addWidget(table_);
+
+    auto bandwidth_layout = new QHBoxLayout();
+    bandwidth_layout->addWidget(new QLabel("Upload bandwidth:", this));
+    spin_bandwidth_ = new QDoubleSpinBox(this);
+    spin_bandwidth_->setRange(0.1, 100000);
+    spin_bandwidth_->setDecimals(1);
+    spin_bandwidth_->setSuffix(" MB/s");
+    spin_bandwidth_->setValue(bandwidth());
+    spin_bandwidth_->setToolTip("The option selected writes and uploads the file the fastest: "
+                                "a low bandwidth favours small outputs, a high one fast "
+                                "compression");
+    bandwidth_layout->addWidget(spin_bandwidth_);
+    bandwidth_layout->addStretch();
+    layout->addLayout(bandwidth_layout);
+
+    auto buttons = new QDialogButtonBox(QDialogButtonBox::Cancel, this);
+    button_use_ = buttons->addButton("Use selected", QDialogButtonBox::AcceptRole);
+    button_use_->setEnabled(false);
+    layout->addWidget(buttons);
+
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(table_, &QTableWidget::itemSelectionChanged, this, [this]() {
+        button_use_->setEnabled(!table_->selectedItems().isEmpty());
+    });
+    connect(spin_bandwidth_, &QDoubleSpinBox::valueChanged, this, [this](double value) {
+        QSettings().setValue("CompressionDialog.bandwidth", value);
+        selectRecommended();
+    });
+
+    resize(760, 640);
+}
+
+CompressionDialog::~CompressionDialog()
+{
+    cancel_ = true;
+    if(thread_)
+    {
+        thread_->wait();
+    }
+}
+
+double CompressionDialog::bandwidth()
+{
+    return QSettings().value("CompressionDialog.bandwidth", DEFAULT_BANDWIDTH).toDouble();
+}
+
+mcap_editor::CompressionOption CompressionDialog::selectedOption() const
+{
+    const auto selection = table_->selectionModel()->selectedRows(COLUMN_OPTION);
+    if(selection.isEmpty())
+    {
+        return {};
+    }
+    const size_t i = selection.front().data(Qt::UserRole).toULongLong();
+    return i < measures_.size() ? measures_[i].option : mcap_editor::CompressionOption();
+}
+
+void CompressionDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    if(!started_)
+    {
+        started_ = true;
+        start();
+    }
+}
+
+void CompressionDialog::start()
+{
+#ifdef USING_WASM
+    // Shows the dialog before the page freezes
+    QCoreApplication::processEvents();
+    std::vector<mcap_editor::CompressionMeasure> measures;
+    const auto status = analyze(input_file_, input_buffer_, measures, cancel_);
+    showMeasures(std::move(measures),
+                 status.ok() ? QString() : QString::fromStdString(status.message));
+#else
+    thread_ = QThread::create([this]() {
+        std::vector<mcap_editor::CompressionMeasure> measures;
+        const auto status = analyze(input_file_, input_buffer_, measures, cancel_);
+        const QString error = status.ok() ? QString() : QString::fromStdString(status.message);
+        // Dropped if the dialog is closed in the meantime
+        QMetaObject::invokeMethod(this, [this, measures = std::move(measures), error]() mutable {
+            showMeasures(std::move(measures), error);
+        }, Qt::QueuedConnection);
+    });
+    connect(thread_, &QThread::finished, thread_, &QObject::deleteLater);
+    thread_->start();
+#endif
+}
+
+void CompressionDialog::showMeasures(std::vector<mcap_editor::CompressionMeasure> measures,
+                                     QString error)
+{
+    if(!error.isEmpty() || measures.empty())
+    {
+        label_status_->setText(error.isEmpty() ? QString("Nothing to analyze") :
+                                                 QString("Analysis failed: %1").arg(error));
+        return;
+    }
+    measures_ = std::move(measures);
+
+    const QLocale locale;
+    label_status_->setText(
+        QString("A sample of %1 of the file, spread over the recording, was written again "
+                "with each option. The speeds are those of this computer.")
+            .arg(locale.formattedDataSize(qint64(measures_.front().uncompressed_bytes))));
+
+    table_->setSortingEnabled(false);
+    table_->setRowCount(int(measures_.size()));
+    for(size_t i = 0; i < measures_.size(); i++)
+    {
+        const auto& measure = measures_[i];
+        const int row = int(i);
+        auto option_item = new QTableWidgetItem(QString::fromStdString(measure.option.name()));
+        option_item->setData(Qt::UserRole, qulonglong(i));
+        table_->setItem(row, COLUMN_OPTION, option_item);
+        table_->setItem(row, COLUMN_RATIO, numberItem(measure.ratio(), 2));
+        table_->setItem(row, COLUMN_COMPRESS, numberItem(measure.compressSpeed() / MB, 1));
+        table_->setItem(row, COLUMN_DECOMPRESS, numberItem(measure.decompressSpeed() / MB, 1));
+        table_->setItem(row, COLUMN_THROUGHPUT, numberItem(0, 1));
+    }
+    table_->setSortingEnabled(true);
+    selectRecommended();
+}
+
+void CompressionDialog::selectRecommended()
+{
+    if(measures_.empty())
+    {
+        return;
+    }
+    const double bandwidth = spin_bandwidth_->value() * MB;
+
+    // Rows stay in place while they are updated, and are sorted again after
+    table_->setSortingEnabled(false);
+    for(int row = 0; row < table_->rowCount(); row++)
+    {
+        const size_t i = table_->item(row, COLUMN_OPTION)->data(Qt::UserRole).toULongLong();
+        table_->item(row, COLUMN_THROUGHPUT)->setData(
+            Qt::DisplayRole, std::round(measures_[i].throughput(bandwidth) / MB * 10) / 10);
+    }
+    table_->setSortingEnabled(true);
+
+    const size_t best = mcap_editor::recommendCompression(measures_, bandwidth);
+    int best_row = -1;
+    for(int row = 0; row < table_->rowCount(); row++)
+    {
+        if(table_->item(row, COLUMN_OPTION)->data(Qt::UserRole).toULongLong() == best)
+        {
+            best_row = row;
+        }
+    }
+    if(best_row >= 0)
+    {
+        table_->selectRow(best_row);
+        table_->scrollToItem(table_->item(best_row, COLUMN_OPTION));
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef COMPRESSION_DIALOG_H
+#define COMPRESSION_DIALOG_H
+
+#include <QByteArray>
+#include <QDialog>
+#include <QPointer>
+#include <QString>
+#include <atomic>
+#include <vector>
+
+#include "compression_analysis.hpp"
+
+class QDoubleSpinBox;
+class QLabel;
+class QPushButton;
+class QTableWidget;
+class QThread;
+
+// Compresses a sample of a file with each codec, level and chunk size (see
+// mcap_editor::analyzeCompression), shows their ratio and speed, and lets
+// the user pick one. The option that suits the upload bandwidth is selected.
+class CompressionDialog : public QDialog
+{
+  Q_OBJECT
+
+public:
+  // input_buffer replaces input_file when not empty, like ExportSettings
+  CompressionDialog(QString input_file, QByteArray input_buffer, QWidget *parent = nullptr);
+  ~CompressionDialog();
+
+  // Valid once the dialog is accepted
+  mcap_editor::CompressionOption selectedOption() const;
+
+  // Upload bandwidth in MB/s, remembered between runs
+  static double bandwidth();
+
+protected:
+  void showEvent(QShowEvent *event) override;
+
+private:
+  QString input_file_;
+  QByteArray input_buffer_;
+  std::vector<mcap_editor::CompressionMeasure> measures_;
+  std::atomic_bool cancel_ = false;
+  QPointer<QThread> thread_;
+  bool started_ = false;
+
+  QLabel* label_status_ = nullptr;
+  QTableWidget* table_ = nullptr;
+  QDoubleSpinBox* spin_bandwidth_ = nullptr;
+  QPushButton* button_use_ = nullptr;
+
+  void start();
+  void showMeasures(std::vector<mcap_editor::CompressionMeasure> measures, QString error);
+  void selectRecommended();
+};
+
+#endif // COMPRESSION_DIALOG_H
@@ -0,0 +1,657 @@
+#include "async_io.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define ASYNC_IO_SUPPORTED
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(ASYNC_IO_SUPPORTED) && defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define ASYNC_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace mcap_editor
+{
+
+namespace
+{
+enum class Operation
+{
+    Read,
+    Write
+};
+
+// Transfers size bytes at offset synchronously: the bytes transferred (less
+// at the end of the file), or -errno
+int64_t transfer(Operation operation, int fd, std::byte* data, uint64_t size, uint64_t offset)
+{
+#ifdef ASYNC_IO_SUPPORTED
+    uint64_t done = 0;
+    while(done < size)
+    {
+        const ssize_t result =
+            operation == Operation::Read ?
+                ::pread(fd, data + done, size_t(size - done), off_t(offset + done)) :
+                ::pwrite(fd, data + done, size_t(size - done), off_t(offset + done));
+        if(result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if(result < 0)
+        {
+            return -errno;
+        }
+        if(result == 0)
+        {
+            if(operation == Operation::Write)
+            {
+                return -EIO;
+            }
+            break;
+        }
+        done += uint64_t(result);
+    }
+    return int64_t(done);
+#else
+    (void)operation;
+    (void)fd;
+    (void)data;
+    (void)size;
+    (void)offset;
+    return -ENOSYS;
+#endif
+}
+}  // namespace
+
+class IoQueue
+{
+public:
+
+    explicit IoQueue(unsigned depth);
+    ~IoQueue();
+
+    IoQueue(const IoQueue&) = delete;
+    IoQueue& operator=(const IoQueue&) = delete;
+
+    bool asynchronous() const { return ring_fd_ >= 0; }
+
+    // Queues the transfer of size bytes at offset in slot, which must not be
+    // in flight. The data must stay valid until wait(slot) returns.
+    void start(unsigned slot, Operation operation, int fd, std::byte* data, uint64_t size,
+               uint64_t offset);
+
+    // Hands the transfers queued to the kernel
+    void submit();
+
+    // The bytes transferred in slot (less at the end of the file), or -errno
+    int64_t wait(unsigned slot);
+
+private:
+    struct Request
+    {
+        Operation operation = Operation::Read;
+        int fd = -1;
+        std::byte* data = nullptr;
+        uint64_t size = 0;
+        uint64_t offset = 0;
+        // Short transfers are resumed from there
+        uint64_t done = 0;
+        bool in_flight = false;
+        int64_t result = 0;
+    };
+
+    std::vector<Request> requests_;
+    int ring_fd_ = -1;
+
+#ifdef ASYNC_IO_URING
+    void* sq_ring_ = nullptr;
+    size_t sq_ring_size_ = 0;
+    void* cq_ring_ = nullptr;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned unsubmitted_ = 0;
+
+    bool setup(unsigned entries);
+    void unmap();
+    // Queues what is left of the transfer of slot
+    void push(unsigned slot);
+    // Handles the completions received, false if there were none
+    bool reap();
+#endif
+};
+
+IoQueue::IoQueue(unsigned depth) :
+    requests_(std::max(1u, depth))
+{
+#ifdef ASYNC_IO_URING
+    // Each slot has at most one entry in the ring
+    if(!setup(unsigned(requests_.size())))
+    {
+        unmap();
+    }
+#endif
+}
+
+IoQueue::~IoQueue()
+{
+    // The kernel may still write to the buffers of the transfers in flight
+    for(unsigned slot = 0; slot < requests_.size(); slot++)
+    {
+        (void)wait(slot);
+    }
+#ifdef ASYNC_IO_URING
+    unmap();
+#endif
+}
+
+void IoQueue::start(unsigned slot, Operation operation, int fd, std::byte* data, uint64_t size,
+                    uint64_t offset)
+{
+    auto& request = requests_[slot];
+    request = {operation, fd, data, size, offset, 0, true, 0};
+#ifdef ASYNC_IO_URING
+    if(asynchronous())
+    {
+        push(slot);
+        return;
+    }
+#endif
+    request.result = transfer(operation, fd, data, size, offset);
+    request.in_flight = false;
+}
+
+int64_t IoQueue::wait(unsigned slot)
+{
+    auto& request = requests_[slot];
+#ifdef ASYNC_IO_URING
+    while(request.in_flight)
+    {
+        submit();
+        if(reap())
+        {
+            continue;
+        }
+        const long result = ::syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                                      IORING_ENTER_GETEVENTS, nullptr, 0);
+        if(result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            // The ring is unusable: nothing can be waited for any more
+            request.result = -errno;
+            request.in_flight = false;
+        }
+    }
+#endif
+    return request.result;
+}
+
+#ifdef ASYNC_IO_URING
+
+void IoQueue::submit()
+{
+    while(unsubmitted_ > 0)
+    {
+        const long result = ::syscall(__NR_io_uring_enter, ring_fd_, unsubmitted_, 0, 0,
+                                      nullptr, 0);
+        if(result < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY))
+        {
+            // EAGAIN and EBUSY: completions have to be reaped first
+            reap();
+            continue;
+        }
+        if(result <= 0)
+        {
+            break;
+        }
+        unsubmitted_ -= unsigned(result);
+    }
+}
+
+bool IoQueue::setup(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const long fd = ::syscall(__NR_io_uring_setup, entries, &params);
+    if(fd < 0)
+    {
+        // Old kernel, or disabled (e.g. kernel.io_uring_disabled, seccomp)
+        return false;
+    }
+    ring_fd_ = int(fd);
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single_mmap)
+    {
+        sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring_fd_, IORING_OFF_SQ_RING);
+    if(sq_ring_ == MAP_FAILED)
+    {
+        sq_ring_ = nullptr;
+        return false;
+    }
+    if(single_mmap)
+    {
+        cq_ring_ = sq_ring_;
+    }
+    else {
+        cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if(cq_ring_ == MAP_FAILED)
+        {
+            cq_ring_ = nullptr;
+            return false;
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQES);
+    if(sqes == MAP_FAILED)
+    {
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<char*>(sq_ring_);
+    auto* cq = static_cast<char*>(cq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+}
+
+void IoQueue::unmap()
+{
+    if(sqes_)
+    {
+        ::munmap(sqes_, sqes_size_);
+    }
+    if(cq_ring_ && cq_ring_ != sq_ring_)
+    {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if(sq_ring_)
+    {
+        ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if(ring_fd_ >= 0)
+    {
+        ::close(ring_fd_);
+    }
+    sqes_ = nullptr;
+    cq_ring_ = nullptr;
+    sq_ring_ = nullptr;
+    ring_fd_ = -1;
+}
+
+void IoQueue::push(unsigned slot)
+{
+    const auto& request = requests_[slot];
+    // Only this thread writes the tail
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & sq_mask_;
+    auto& sqe = sqes_[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = request.operation == Operation::Read ? IORING_OP_READ : IORING_OP_WRITE;
+    sqe.fd = request.fd;
+    sqe.off = request.offset + request.done;
+    sqe.addr = reinterpret_cast<uint64_t>(request.data + request.done);
+    // Larger transfers complete in several parts
+    sqe.len = unsigned(std::min<uint64_t>(request.size - request.done, 1u << 30));
+    sqe.user_data = slot;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    unsubmitted_++;
+}
+
+bool IoQueue::reap()
+{
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    if(head == tail)
+    {
+        return false;
+    }
+    for(; head != tail; head++)
+    {
+        const auto& cqe = cqes_[head & cq_mask_];
+        auto& request = requests_[size_t(cqe.user_data)];
+        const int result = cqe.res;
+        if(result == -EINTR || result == -EAGAIN)
+        {
+            push(unsigned(cqe.user_data));
+        }
+        else if(result == -EINVAL || result == -EOPNOTSUPP)
+        {
+            // Kernels before 5.6 don't know IORING_OP_READ and IORING_OP_WRITE
+            const auto rest = transfer(request.operation, request.fd, request.data + request.done,
+                                       request.size - request.done,
+                                       request.offset + request.done);
+            request.result = rest < 0 ? rest : int64_t(request.done) + rest;
+            request.in_flight = false;
+        }
+        else if(result < 0)
+        {
+            request.result = result;
+            request.in_flight = false;
+        }
+        else if(result == 0)
+        {
+            // End of the file
+            request.result = request.operation == Operation::Read ? int64_t(request.done) : -EIO;
+            request.in_flight = false;
+        }
+        else {
+            request.done += uint64_t(result);
+            if(request.done < request.size)
+            {
+                push(unsigned(cqe.user_data));
+            }
+            else {
+                request.result = int64_t(request.done);
+                request.in_flight = false;
+            }
+        }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return true;
+}
+
+#else
+
+void IoQueue::submit()
+{
+}
+
+#endif
+
+AsyncFileReader::AsyncFileReader(unsigned depth) :
+    depth_(std::max(1u, depth))
+{
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    close();
+}
+
+mcap::Status AsyncFileReader::open(const std::string& filename)
+{
+    close();
+#ifdef ASYNC_IO_SUPPORTED
+    const int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    struct stat file_stat;
+    if(::fstat(fd, &file_stat) != 0)
+    {
+        ::close(fd);
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    fd_ = fd;
+    size_ = uint64_t(file_stat.st_size);
+    queue_ = std::make_unique<IoQueue>(depth_);
+    slots_.resize(depth_);
+    for(unsigned slot = depth_; slot > 0; slot--)
+    {
+        free_.push_back(slot - 1);
+    }
+    return {};
+#else
+    (void)filename;
+    return {mcap::StatusCode::OpenFailed, "asynchronous reads are not supported"};
+#endif
+}
+
+void AsyncFileReader::close()
+{
+    // Waits for the reads in flight
+    queue_.reset();
+#ifdef ASYNC_IO_SUPPORTED
+    if(fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+#endif
+    fd_ = -1;
+    size_ = 0;
+    slots_.clear();
+    used_.clear();
+    free_.clear();
+    ranges_.clear();
+    next_range_ = 0;
+    buffer_ = {};
+}
+
+bool AsyncFileReader::asynchronous() const
+{
+    return queue_ && queue_->asynchronous();
+}
+
+uint64_t AsyncFileReader::read(std::byte** output, uint64_t offset, uint64_t size)
+{
+    if(fd_ < 0 || offset >= size_)
+    {
+        return 0;
+    }
+    size = std::min(size, size_ - offset);
+
+    for(size_t position = 0; position < used_.size(); position++)
+    {
+        auto& slot = slots_[used_[position]];
+        if(slot.range.start > offset || offset + size > slot.range.end)
+        {
+            continue;
+        }
+        // The ranges before it were read another way, or are done with
+        for(; position > 0; position--)
+        {
+            release();
+        }
+        wait(used_.front());
+        if(!slot.complete)
+        {
+            // Read again below, to return what can be read
+            break;
+        }
+        *output = slot.buffer.data() + (offset - slot.range.start);
+        readAhead();
+        return size;
+    }
+
+    if(buffer_.size() < size)
+    {
+        buffer_.resize(size);
+    }
+    const int64_t result = transfer(Operation::Read, fd_, buffer_.data(), size, offset);
+    if(result <= 0)
+    {
+        return 0;
+    }
+    *output = buffer_.data();
+    return uint64_t(result);
+}
+
+void AsyncFileReader::willRead(const std::vector<mcap::ByteRange>& ranges)
+{
+    if(fd_ < 0)
+    {
+        return;
+    }
+    while(!used_.empty())
+    {
+        release();
+    }
+    ranges_ = ranges;
+    next_range_ = 0;
+    readAhead();
+}
+
+void AsyncFileReader::readAhead()
+{
+    bool started = false;
+    while(!free_.empty() && next_range_ < ranges_.size())
+    {
+        const auto range = ranges_[next_range_++];
+        if(range.start >= range.end || range.end > size_)
+        {
+            // Left to read(), which reports the error
+            continue;
+        }
+        const unsigned index = free_.back();
+        free_.pop_back();
+        auto& slot = slots_[index];
+        slot.range = range;
+        slot.buffer.resize(range.end - range.start);
+        slot.in_flight = true;
+        slot.complete = false;
+        queue_->start(index, Operation::Read, fd_, slot.buffer.data(), slot.buffer.size(),
+                      range.start);
+        used_.push_back(index);
+        started = true;
+    }
+    if(started)
+    {
+        queue_->submit();
+    }
+}
+
+void AsyncFileReader::wait(unsigned index)
+{
+    auto& slot = slots_[index];
+    if(slot.in_flight)
+    {
+        slot.complete = queue_->wait(index) == int64_t(slot.buffer.size());
+        slot.in_flight = false;
+    }
+}
+
+void AsyncFileReader::release()
+{
+    const unsigned index = used_.front();
+    wait(index);
+    used_.pop_front();
+    free_.push_back(index);
+}
+
+AsyncFileWriter::AsyncFileWriter(unsigned depth, uint64_t buffer_size) :
+    depth_(std::max(1u, depth)),
+    buffer_size_(std::max<uint64_t>(1, buffer_size))
+{
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    end();
+}
+
+mcap::Status AsyncFileWriter::open(const std::string& filename)
+{
+    end();
+    offset_ = 0;
+    current_ = 0;
+#ifdef ASYNC_IO_SUPPORTED
+    fd_ = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd_ < 0)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    queue_ = std::make_unique<IoQueue>(depth_);
+    buffers_.resize(depth_);
+    for(auto& buffer: buffers_)
+    {
+        buffer.data.resize(buffer_size_);
+    }
+    startBlocks(filename, buffer_size_);
+    return {};
+#else
+    return {mcap::StatusCode::OpenFailed, "asynchronous writes are not supported"};
+#endif
+}
+
+bool AsyncFileWriter::asynchronous() const
+{
+    return queue_ && queue_->asynchronous();
+}
+
+void AsyncFileWriter::end()
+{
+    if(fd_ < 0)
+    {
+        return;
+    }
+    stopBlocks();
+    for(unsigned buffer = 0; buffer < depth_; buffer++)
+    {
+        wait(buffer);
+    }
+    queue_.reset();
+#ifdef ASYNC_IO_SUPPORTED
+    if(::close(fd_) != 0)
+    {
+        fail("write", errno);
+    }
+#endif
+    fd_ = -1;
+    buffers_.clear();
+}
+
+std::byte* AsyncFileWriter::nextBlock()
+{
+    wait(current_);
+    return buffers_[current_].data.data();
+}
+
+void AsyncFileWriter::writeBlock(uint64_t size)
+{
+    auto& buffer = buffers_[current_];
+    buffer.size = size;
+    queue_->start(current_, Operation::Write, fd_, buffer.data.data(), size, offset_);
+    queue_->submit();
+    buffer.in_flight = true;
+    offset_ += size;
+    current_ = (current_ + 1) % depth_;
+}
+
+void AsyncFileWriter::wait(unsigned index)
+{
+    auto& buffer = buffers_[index];
+    if(buffer.in_flight)
+    {
+        const int64_t result = queue_->wait(index);
+        if(result != int64_t(buffer.size))
+        {
+            fail("write", result < 0 ? int(-result) : EIO);
+        }
+        buffer.in_flight = false;
+    }
+    buffer.size = 0;
+}
+
+}  // namespace mcap_editor
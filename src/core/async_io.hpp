@@ -0,0 +1,120 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block_writer.hpp"
+
+namespace mcap_editor
+{
+
+// Reads and writes of a file descriptor kept in flight, identified by a slot
+// number below the depth of the queue. Uses io_uring on Linux, and pread()
+// and pwrite() elsewhere or when the kernel doesn't allow it.
+class IoQueue;
+
+// IReadable reading ahead the ranges announced by willRead(), e.g. the chunks
+// a mcap::ChunkPrefetcher is going to take, with up to `depth` reads in
+// flight. Other reads are synchronous.
+// read() returns pointers into its buffers, valid until the next read, and
+// must always be called from the same thread.
+class AsyncFileReader: public mcap::IReadable {
+public:
+
+    explicit AsyncFileReader(unsigned depth = 8);
+    ~AsyncFileReader() override;
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    mcap::Status open(const std::string& filename);
+
+    void close();
+
+    // False when reads are synchronous (no io_uring)
+    bool asynchronous() const;
+
+    uint64_t size() const override { return size_; }
+
+    uint64_t read(std::byte** output, uint64_t offset, uint64_t size) override;
+
+    void willRead(const std::vector<mcap::ByteRange>& ranges) override;
+
+private:
+    // A range read ahead
+    struct Slot
+    {
+        mcap::ByteRange range;
+        std::vector<std::byte> buffer;
+        bool in_flight = false;
+        // The whole range was read
+        bool complete = false;
+    };
+
+    unsigned depth_;
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    std::unique_ptr<IoQueue> queue_;
+    std::vector<Slot> slots_;
+    // Slots holding a range, in the order of the ranges
+    std::deque<unsigned> used_;
+    std::vector<unsigned> free_;
+    std::vector<mcap::ByteRange> ranges_;
+    size_t next_range_ = 0;
+    // Synchronous reads
+    std::vector<std::byte> buffer_;
+
+    // Starts reading the next ranges in the free slots
+    void readAhead();
+    void wait(unsigned slot);
+    void release();
+};
+
+// BlockWriter writing each buffer of buffer_size bytes at once, with up to
+// `depth` buffers in flight: a full buffer waits for the oldest write.
+class AsyncFileWriter: public BlockWriter {
+public:
+
+    explicit AsyncFileWriter(unsigned depth = 4, uint64_t buffer_size = 1024 * 1024);
+    ~AsyncFileWriter() override;
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    mcap::Status open(const std::string& filename);
+
+    // False when writes are synchronous (no io_uring)
+    bool asynchronous() const;
+
+    void end() override;
+
+protected:
+    std::byte* nextBlock() override;
+    void writeBlock(uint64_t size) override;
+
+private:
+    struct Buffer
+    {
+        std::vector<std::byte> data;
+        uint64_t size = 0;
+        bool in_flight = false;
+    };
+
+    unsigned depth_;
+    uint64_t buffer_size_;
+    int fd_ = -1;
+    // Where the next buffer goes in the file
+    uint64_t offset_ = 0;
+    std::unique_ptr<IoQueue> queue_;
+    std::vector<Buffer> buffers_;
+    // Buffer being filled, the oldest in flight once the others are
+    unsigned current_ = 0;
+
+    void wait(unsigned buffer);
+};
+
+}  // namespace mcap_editor
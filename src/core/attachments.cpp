@@ -0,0 +1,190 @@
+#include "attachments.hpp"
+
+#include <mcap/internal.hpp>
+
+#include <algorithm>
+
+namespace mcap_editor
+{
+
+namespace
+{
+// Reads the fields of the Attachment record at offset that precede its data,
+// and the offset of the data, which is left in the file
+mcap::Status readAttachmentHeader(mcap::IReadable& source, uint64_t offset,
+                                  mcap::Attachment& attachment, uint64_t& data_offset)
+{
+    const mcap::Status invalid{mcap::StatusCode::InvalidRecord,
+                               "invalid attachment at offset " + std::to_string(offset)};
+    // Opcode, length, log and create times, and the length of the name
+    constexpr uint64_t FIXED_SIZE = 9 + 8 + 8 + 4;
+    const uint64_t file_size = source.size();
+    std::byte* data = nullptr;
+    if(offset > file_size || file_size - offset < FIXED_SIZE ||
+       source.read(&data, offset, FIXED_SIZE) != FIXED_SIZE ||
+       mcap::OpCode(data[0]) != mcap::OpCode::Attachment ||
+       mcap::internal::ParseUint64(data + 1) > file_size - offset - 9)
+    {
+        return invalid;
+    }
+    const uint64_t record_end = offset + 9 + mcap::internal::ParseUint64(data + 1);
+    attachment.logTime = mcap::internal::ParseUint64(data + 9);
+    attachment.createTime = mcap::internal::ParseUint64(data + 17);
+    uint64_t length = mcap::internal::ParseUint32(data + 25);
+    uint64_t position = offset + FIXED_SIZE;
+
+    // The name, and the length of the media type
+    if(record_end - position < length + 4 ||
+       source.read(&data, position, length + 4) != length + 4)
+    {
+        return invalid;
+    }
+    attachment.name.assign(reinterpret_cast<const char*>(data), length);
+    position += length + 4;
+    length = mcap::internal::ParseUint32(data + length);
+
+    // The media type, and the size of the data
+    if(record_end - position < length + 8 ||
+       source.read(&data, position, length + 8) != length + 8)
+    {
+        return invalid;
+    }
+    attachment.mediaType.assign(reinterpret_cast<const char*>(data), length);
+    attachment.dataSize = mcap::internal::ParseUint64(data + length);
+    position += length + 8;
+
+    // Followed by the CRC
+    if(record_end - position < 4 || record_end - position - 4 != attachment.dataSize)
+    {
+        return invalid;
+    }
+    data_offset = position;
+    return {};
+}
+
+mcap::Status copyAttachment(mcap::IReadable& source, uint64_t offset, const EditPlan& plan,
+                            mcap::McapWriter& writer, PipelineStats& stats)
+{
+    mcap::Attachment attachment;
+    uint64_t data_offset = 0;
+    auto status = readAttachmentHeader(source, offset, attachment, data_offset);
+    if(!status.ok() || !plan.keepsAttachment(attachment.name))
+    {
+        return status;
+    }
+    StageTimer timer(stats, Stage::Write, attachment.dataSize, 0);
+    return writer.write(attachment, source, data_offset);
+}
+
+mcap::Status copyMetadata(mcap::IReadable& source, uint64_t offset, mcap::McapWriter& writer,
+                          PipelineStats& stats)
+{
+    mcap::Record record;
+    auto status = mcap::McapReader::ReadRecord(source, offset, &record);
+    if(status.ok() && record.opcode != mcap::OpCode::Metadata)
+    {
+        status = {mcap::StatusCode::InvalidRecord,
+                  "invalid metadata at offset " + std::to_string(offset)};
+    }
+    mcap::Metadata metadata;
+    if(status.ok())
+    {
+        status = mcap::McapReader::ParseMetadata(record, &metadata);
+    }
+    if(!status.ok())
+    {
+        return status;
+    }
+    StageTimer timer(stats, Stage::Write, record.dataSize, 0);
+    return writer.write(metadata);
+}
+}  // namespace
+
+mcap::Status listAttachments(mcap::McapReader& reader, bool has_summary, const EditPlan& plan,
+                             std::vector<AttachmentRecord>& records)
+{
+    records.clear();
+    const auto& attachment_indexes = reader.attachmentIndexes();
+    const auto& metadata_indexes = reader.metadataIndexes();
+    const auto& statistics = reader.statistics();
+    // Writers can leave the indexes out of the summary, but not the counts
+    if(has_summary &&
+       (!statistics || (statistics->attachmentCount <= attachment_indexes.size() &&
+                        statistics->metadataCount <= metadata_indexes.size())))
+    {
+        for(const auto& [name, index]: attachment_indexes)
+        {
+            if(plan.keepsAttachment(name))
+            {
+                records.push_back({index.offset, mcap::OpCode::Attachment});
+            }
+        }
+        for(const auto& [name, index]: metadata_indexes)
+        {
+            records.push_back({index.offset, mcap::OpCode::Metadata});
+        }
+        std::sort(records.begin(), records.end(),
+                  [](const AttachmentRecord& a, const AttachmentRecord& b)
+                  { return a.offset < b.offset; });
+        return {};
+    }
+
+    auto& source = *reader.dataSource();
+    const uint64_t file_size = source.size();
+    auto record_header = [&](uint64_t offset, mcap::OpCode& opcode, uint64_t& length) -> bool
+    {
+        std::byte* data = nullptr;
+        if(offset > file_size || file_size - offset < 9 || source.read(&data, offset, 9) != 9)
+        {
+            return false;
+        }
+        opcode = mcap::OpCode(data[0]);
+        length = mcap::internal::ParseUint64(data + 1);
+        return length <= file_size - offset - 9;
+    };
+    mcap::OpCode opcode;
+    uint64_t length = 0;
+    if(!record_header(sizeof(mcap::Magic), opcode, length) || opcode != mcap::OpCode::Header)
+    {
+        return {mcap::StatusCode::InvalidFile, "missing header record"};
+    }
+    const uint64_t data_end = reader.dataEnd();
+    for(uint64_t offset = sizeof(mcap::Magic) + 9 + length;
+        offset < data_end && record_header(offset, opcode, length) &&
+        opcode != mcap::OpCode::DataEnd && opcode != mcap::OpCode::Footer;
+        offset += 9 + length)
+    {
+        if(opcode == mcap::OpCode::Attachment)
+        {
+            mcap::Attachment attachment;
+            uint64_t data_offset = 0;
+            auto status = readAttachmentHeader(source, offset, attachment, data_offset);
+            if(!status.ok())
+            {
+                return status;
+            }
+            if(plan.keepsAttachment(attachment.name))
+            {
+                records.push_back({offset, opcode});
+            }
+        }
+        else if(opcode == mcap::OpCode::Metadata)
+        {
+            records.push_back({offset, opcode});
+        }
+    }
+    return {};
+}
+
+mcap::Status copyAttachmentRecord(mcap::IReadable& source, const AttachmentRecord& record,
+                                  const EditPlan& plan, mcap::McapWriter& writer,
+                                  PipelineStats& stats)
+{
+    if(record.opcode == mcap::OpCode::Attachment)
+    {
+        return copyAttachment(source, record.offset, plan, writer, stats);
+    }
+    return copyMetadata(source, record.offset, writer, stats);
+}
+
+}  // namespace mcap_editor
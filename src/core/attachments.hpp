@@ -0,0 +1,36 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+#include <vector>
+
+#include "edit_plan.hpp"
+#include "pipeline_stats.hpp"
+
+namespace mcap_editor
+{
+
+// An Attachment or Metadata record of an input file
+struct AttachmentRecord
+{
+    uint64_t offset = 0;
+    mcap::OpCode opcode = mcap::OpCode::Attachment;
+};
+
+// The attachments that plan keeps and the metadata records of the file that
+// reader opened, in the order of the file. They are taken from the indexes of
+// the summary when has_summary tells it was read (or loaded from a
+// SummaryCache) and it indexes them all. Otherwise the data section is walked
+// from record header to record header, without reading the chunks, up to the
+// first incomplete record like the scan of mcap::McapReader.
+mcap::Status listAttachments(mcap::McapReader& reader, bool has_summary, const EditPlan& plan,
+                             std::vector<AttachmentRecord>& records);
+
+// Copies the record to writer, unless it is an attachment that plan drops.
+// Attachment data is streamed from source to the output, never held in
+// memory as a whole, and its CRC computed again on the way.
+mcap::Status copyAttachmentRecord(mcap::IReadable& source, const AttachmentRecord& record,
+                                  const EditPlan& plan, mcap::McapWriter& writer,
+                                  PipelineStats& stats);
+
+}  // namespace mcap_editor
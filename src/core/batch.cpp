@@ -0,0 +1,289 @@
+#include "batch.hpp"
+#include "chunk_groups.hpp"
+#include "exporter.hpp"
+#include "file_info.hpp"
+#include "mmap_reader.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <system_error>
+#include <thread>
+
+namespace mcap_editor
+{
+
+namespace fs = std::filesystem;
+
+namespace
+{
+// Jobs of a worker, by index. Its owner takes them from the front, other
+// workers from the back.
+struct JobQueue
+{
+    std::mutex mutex;
+    std::deque<size_t> jobs;
+};
+
+bool hasMcapExtension(const fs::path& path)
+{
+    return path.extension() == ".mcap";
+}
+}  // namespace
+
+mcap::Status listBatchFiles(const std::string& pattern, std::vector<std::string>& files)
+{
+    files.clear();
+    std::error_code error;
+    const fs::path path(pattern);
+    if(fs::is_directory(path, error))
+    {
+        for(const auto& entry: fs::directory_iterator(path, error))
+        {
+            if(entry.is_regular_file(error) && hasMcapExtension(entry.path()))
+            {
+                files.push_back(entry.path().string());
+            }
+        }
+    }
+    else if(pattern.find_first_of("*?") == std::string::npos)
+    {
+        if(fs::is_regular_file(path, error))
+        {
+            files.push_back(pattern);
+        }
+    }
+    else {
+        // Only the name of the file can have wildcards
+        const auto name = path.filename().string();
+        const auto directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+        for(const auto& entry: fs::directory_iterator(directory, error))
+        {
+            if(entry.is_regular_file(error) &&
+               matchTopicPattern(name, entry.path().filename().string()))
+            {
+                files.push_back((path.has_parent_path() ? entry.path() :
+                                                          entry.path().filename()).string());
+            }
+        }
+    }
+    if(error)
+    {
+        return {mcap::StatusCode::OpenFailed, pattern + ": " + error.message()};
+    }
+    if(files.empty())
+    {
+        return {mcap::StatusCode::OpenFailed, "no MCAP file in \"" + pattern + "\""};
+    }
+    std::sort(files.begin(), files.end());
+    return {};
+}
+
+mcap::Status makeBatchJobs(const std::vector<std::string>& input_files,
+                           const std::string& output_dir, std::vector<BatchJob>& jobs)
+{
+    jobs.clear();
+    std::set<std::string> outputs;
+    std::error_code error;
+    for(const auto& input: input_files)
+    {
+        BatchJob job;
+        job.input_file = input;
+        job.output_file = (fs::path(output_dir) / fs::path(input).filename()).string();
+        if(!outputs.insert(job.output_file).second)
+        {
+            return {mcap::StatusCode::OpenFailed,
+                    "several inputs are written to \"" + job.output_file + "\""};
+        }
+        if(fs::equivalent(job.input_file, job.output_file, error))
+        {
+            return {mcap::StatusCode::OpenFailed,
+                    "\"" + input + "\" would be replaced by its output"};
+        }
+        jobs.push_back(std::move(job));
+    }
+    return {};
+}
+
+BatchRunner::BatchRunner(EditConfig config, std::vector<BatchJob> jobs, BatchSettings settings) :
+    config_(std::move(config)),
+    jobs_(std::move(jobs)),
+    settings_(settings)
+{
+}
+
+void BatchRunner::setResultCallback(ResultCallback callback)
+{
+    result_callback_ = std::move(callback);
+}
+
+void BatchRunner::cancel()
+{
+    cancel_requested_ = true;
+}
+
+bool BatchRunner::canceled() const
+{
+    return cancel_requested_;
+}
+
+std::vector<BatchResult> BatchRunner::run()
+{
+    std::vector<BatchResult> results(jobs_.size());
+    if(jobs_.empty())
+    {
+        return results;
+    }
+
+    // Largest first, dealt in turn to the workers: each queue starts with a
+    // large job and ends with small ones, the ones worth stealing
+    std::vector<std::pair<uint64_t, size_t>> sizes;
+    for(size_t i = 0; i < jobs_.size(); i++)
+    {
+        std::error_code error;
+        const auto size = fs::file_size(jobs_[i].input_file, error);
+        sizes.emplace_back(error ? 0 : size, i);
+    }
+    std::stable_sort(sizes.begin(), sizes.end(),
+                     [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    unsigned threads = settings_.threads > 0 ? settings_.threads :
+                                               std::max(1u, std::thread::hardware_concurrency());
+    threads = unsigned(std::min<size_t>(threads, jobs_.size()));
+    std::vector<JobQueue> queues(threads);
+    for(size_t i = 0; i < sizes.size(); i++)
+    {
+        queues[i % threads].jobs.push_back(sizes[i].second);
+    }
+
+    auto next_job = [&queues, threads](unsigned worker, size_t& job) -> bool
+    {
+        {
+            auto& own = queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if(!own.jobs.empty())
+            {
+                job = own.jobs.front();
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+        for(unsigned i = 1; i < threads; i++)
+        {
+            auto& other = queues[(worker + i) % threads];
+            std::lock_guard<std::mutex> lock(other.mutex);
+            if(!other.jobs.empty())
+            {
+                job = other.jobs.back();
+                other.jobs.pop_back();
+                return true;
+            }
+        }
+        return false;
+    };
+    auto work = [&](unsigned worker)
+    {
+        size_t job = 0;
+        while(!cancel_requested_ && next_job(worker, job))
+        {
+            results[job] = runJob(jobs_[job]);
+            if(result_callback_)
+            {
+                std::lock_guard<std::mutex> lock(callback_mutex_);
+                result_callback_(results[job]);
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for(unsigned i = 1; i < threads; i++)
+    {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for(auto& worker: workers)
+    {
+        worker.join();
+    }
+
+    // Jobs never started
+    for(size_t i = 0; i < jobs_.size(); i++)
+    {
+        if(results[i].job.input_file.empty())
+        {
+            results[i].job = jobs_[i];
+            results[i].status = {mcap::StatusCode::OpenFailed, "canceled"};
+        }
+    }
+    return results;
+}
+
+BatchResult BatchRunner::runJob(const BatchJob& job)
+{
+    BatchResult result;
+    result.job = job;
+    const auto start = std::chrono::steady_clock::now();
+
+    EditPlan plan;
+    {
+        mcap::McapReader reader;
+        MmapReader mmap_reader;
+        FileInfo info;
+        const SummaryCache* cache = summary_cache_ ? &*summary_cache_ : nullptr;
+        result.status = openFile(reader, mmap_reader, job.input_file,
+                                 MmapReader::AccessPattern::Random);
+        if(result.status.ok())
+        {
+            // The other workers already use the other cores
+            result.status = readFileInfo(reader, info, 1, cache, job.input_file);
+        }
+        if(!result.status.ok())
+        {
+            return result;
+        }
+        result.input_bytes = reader.dataSource()->size();
+        plan = resolveEditConfig(config_, info);
+
+        if(settings_.job_memory > 0)
+        {
+            // A chunk in flight holds its compressed and decompressed data
+            uint64_t chunk_size = plan.chunk_size;
+            for(const auto& index: reader.chunkIndexes())
+            {
+                chunk_size = std::max(chunk_size, index.uncompressedSize);
+            }
+            const uint64_t chunks = settings_.job_memory / std::max<uint64_t>(1, 2 * chunk_size);
+            plan.read_ahead_chunks = size_t(std::min<uint64_t>(plan.read_ahead_chunks, chunks / 2));
+            plan.compression_threads =
+                unsigned(std::min<uint64_t>(plan.compression_threads, chunks / 4));
+        }
+    }
+    plan.input_file = job.input_file;
+    plan.output_file = job.output_file;
+
+    Exporter exporter(std::move(plan));
+    exporter.setSummaryCache(summary_cache_);
+    exporter.setProgressCallback([this, &exporter](uint64_t, uint64_t)
+    {
+        if(cancel_requested_ && !exporter.canceled())
+        {
+            exporter.cancel();
+        }
+    });
+    result.status = exporter.run();
+    if(result.status.ok() && exporter.canceled())
+    {
+        result.status = {mcap::StatusCode::OpenFailed, "canceled"};
+    }
+    std::error_code error;
+    const auto output_size = fs::file_size(job.output_file, error);
+    result.output_bytes = error ? 0 : output_size;
+    result.messages = exporter.stats().totals(Stage::Write).messages;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <mcap/reader.hpp>
+
+#include "edit_config.hpp"
+#include "summary_cache.hpp"
+
+namespace mcap_editor
+{
+
+struct BatchJob
+{
+    std::string input_file;
+    std::string output_file;
+};
+
+// Outcome of a BatchJob
+struct BatchResult
+{
+    BatchJob job;
+    mcap::Status status;
+    uint64_t input_bytes = 0;
+    uint64_t output_bytes = 0;
+    uint64_t messages = 0;
+    double seconds = 0;
+};
+
+struct BatchSettings
+{
+    // Files processed at the same time (0 = one per core)
+    unsigned threads = 0;
+    // Memory of the chunks each file has in flight (0 = no limit): read-ahead
+    // and compression threads of the config are reduced to fit in it
+    uint64_t job_memory = 0;
+};
+
+// The MCAP files of pattern, sorted: every "*.mcap" file of a directory, or
+// the files matching a name with '*' and '?' (e.g. "logs/run_*.mcap")
+mcap::Status listBatchFiles(const std::string& pattern, std::vector<std::string>& files);
+
+// One job per input, writing the file of the same name to output_dir. Fails
+// if two inputs have the same name, or an output would replace its input.
+mcap::Status makeBatchJobs(const std::vector<std::string>& input_files,
+                           const std::string& output_dir, std::vector<BatchJob>& jobs);
+
+// Applies the same EditConfig to many files, several at a time. Each worker
+// thread has a queue of jobs, largest first; a worker whose queue is empty
+// takes the smallest job left in the queue of another, so that the workers
+// finish together even when a few recordings are much larger than the rest.
+class BatchRunner
+{
+public:
+    // Called once per job, as soon as it is done, from the worker that ran
+    // it. Calls are serialized.
+    using ResultCallback = std::function<void(const BatchResult& result)>;
+
+    BatchRunner(EditConfig config, std::vector<BatchJob> jobs, BatchSettings settings);
+
+    const std::vector<BatchJob>& jobs() const { return jobs_; }
+
+    void setResultCallback(ResultCallback callback);
+
+    // Thread safe: the exports running stop (their outputs are closed and
+    // valid, but incomplete) and the others are not started
+    void cancel();
+
+    bool canceled() const;
+
+    // Where the summary of input files without one is looked up, and saved
+    void setSummaryCache(std::optional<SummaryCache> cache) { summary_cache_ = std::move(cache); }
+
+    // Runs every job, and returns their results in the order of jobs()
+    std::vector<BatchResult> run();
+
+private:
+    EditConfig config_;
+    std::vector<BatchJob> jobs_;
+    BatchSettings settings_;
+    ResultCallback result_callback_;
+    std::mutex callback_mutex_;
+    std::atomic_bool cancel_requested_ = false;
+    std::optional<SummaryCache> summary_cache_;
+
+    BatchResult runJob(const BatchJob& job);
+};
+
+}  // namespace mcap_editor
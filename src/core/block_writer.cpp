@@ -0,0 +1,76 @@
+#include "block_writer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mcap_editor
+{
+
+mcap::Status BlockWriter::status() const
+{
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    return status_;
+}
+
+void BlockWriter::startBlocks(const std::string& filename, uint64_t block_size)
+{
+    filename_ = filename;
+    block_size_ = block_size;
+    started_ = true;
+    block_ = nullptr;
+    block_filled_ = 0;
+    size_ = 0;
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    status_ = {};
+}
+
+void BlockWriter::stopBlocks()
+{
+    if(block_ && block_filled_ > 0)
+    {
+        writeBlock(block_filled_);
+    }
+    block_ = nullptr;
+    started_ = false;
+}
+
+void BlockWriter::fail(const std::string& operation, int error)
+{
+    std::lock_guard<std::mutex> lock(status_mutex_);
+    if(status_.ok())
+    {
+        status_ = {mcap::StatusCode::OpenFailed, "failed to " + operation + " \"" + filename_ +
+                                                     "\": " + std::strerror(error)};
+    }
+}
+
+void BlockWriter::handleWrite(const std::byte* data, uint64_t size)
+{
+    // The offsets that mcap::McapWriter writes in the summary follow size(),
+    // so it grows the same when the file could not be opened or written
+    size_ += size;
+    if(!started_)
+    {
+        return;
+    }
+    while(size > 0)
+    {
+        if(!block_)
+        {
+            block_ = nextBlock();
+            block_filled_ = 0;
+        }
+        const uint64_t copied = std::min(size, block_size_ - block_filled_);
+        std::memcpy(block_ + block_filled_, data, size_t(copied));
+        block_filled_ += copied;
+        data += copied;
+        size -= copied;
+        if(block_filled_ == block_size_)
+        {
+            writeBlock(block_filled_);
+            block_ = nullptr;
+        }
+    }
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mcap/writer.hpp>
+#include <mutex>
+#include <string>
+
+namespace mcap_editor
+{
+
+// IWritable gathering the writes of mcap::McapWriter into blocks of a fixed
+// size, handed to the subclass to be written while the next one is filled
+// (AsyncFileWriter, WriteBehindWriter). The subclass writes them on its own
+// time, so an error only shows in status(), complete once end() returned.
+class BlockWriter: public mcap::IWritable {
+public:
+    uint64_t size() const override { return size_; }
+
+    // The first error since the file was opened
+    mcap::Status status() const;
+
+protected:
+    // Called by open(): writes go to filename, in blocks of block_size bytes
+    void startBlocks(const std::string& filename, uint64_t block_size);
+    // Called by end(): hands over the block being filled, if not empty.
+    // Later writes are only counted.
+    void stopBlocks();
+
+    // A block of block_size bytes to fill, once one is free
+    virtual std::byte* nextBlock() = 0;
+    // The block returned by the last nextBlock(), filled with size bytes
+    virtual void writeBlock(uint64_t size) = 0;
+
+    // Records error (errno) as the status, unless there is one already. Can
+    // be called from any thread.
+    void fail(const std::string& operation, int error);
+
+    void handleWrite(const std::byte* data, uint64_t size) override;
+
+private:
+    std::string filename_;
+    uint64_t block_size_ = 0;
+    bool started_ = false;
+    std::byte* block_ = nullptr;
+    uint64_t block_filled_ = 0;
+    uint64_t size_ = 0;
+
+    mutable std::mutex status_mutex_;
+    mcap::Status status_;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,32 @@
+#include "channel_selection.hpp"
+
+#include <limits>
+
+namespace mcap_editor
+{
+
+ChannelSelection::ChannelSelection(const EditPlan& plan) :
+    plan_(plan),
+    states_(size_t(std::numeric_limits<mcap::ChannelId>::max()) + 1, UNKNOWN)
+{
+}
+
+void ChannelSelection::addChannels(mcap::McapReader& reader)
+{
+    for(const auto& [channel_id, channel]: reader.channels())
+    {
+        add(*channel);
+    }
+}
+
+bool ChannelSelection::add(const mcap::Channel& channel)
+{
+    auto& state = states_[channel.id];
+    if(state == UNKNOWN)
+    {
+        state = plan_.keepsChannel(channel) ? KEPT : DROPPED;
+    }
+    return state == KEPT;
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <vector>
+
+#include "edit_plan.hpp"
+
+namespace mcap_editor
+{
+
+// The channels of an input file that an EditPlan keeps, by channel id.
+// Each channel is decided once, from its topic and id, the first time it is
+// seen; after that, filtering a message is an array lookup, with no string
+// hashed or allocated. Channels sharing a topic are decided separately.
+class ChannelSelection
+{
+public:
+    explicit ChannelSelection(const EditPlan& plan);
+
+    // Decides on the channels listed in the summary (already read)
+    void addChannels(mcap::McapReader& reader);
+
+    // Decides on channel, unless it is already known. Returns whether it is kept.
+    bool add(const mcap::Channel& channel);
+
+    bool known(mcap::ChannelId id) const { return states_[id] != UNKNOWN; }
+
+    // False for unknown channels
+    bool keeps(mcap::ChannelId id) const { return states_[id] == KEPT; }
+
+private:
+    enum State : uint8_t
+    {
+        UNKNOWN = 0,
+        DROPPED,
+        KEPT,
+    };
+
+    const EditPlan& plan_;
+    // Indexed by channel id, which is 16 bits
+    std::vector<State> states_;
+};
+
+}  // namespace mcap_editor
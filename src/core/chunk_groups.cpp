@@ -0,0 +1,122 @@
+#include "chunk_groups.hpp"
+
+namespace mcap_editor
+{
+
+namespace
+{
+constexpr double NS_PER_S = 1e9;
+
+// Parts of the schema names of already compressed payloads, from
+// sensor_msgs, foxglove and the usual image transports
+const char* const COMPRESSED_SCHEMAS[] = {
+    "CompressedImage", "CompressedVideo", "CompressedPointCloud", "FFMPEGPacket",
+    "theora_image_transport"};
+}
+
+bool matchTopicPattern(const std::string& pattern, const std::string& topic)
+{
+    // Backtracks to the last '*' only, which is enough for globs
+    size_t p = 0;
+    size_t t = 0;
+    size_t star = std::string::npos;
+    size_t star_topic = 0;
+    while(t < topic.size())
+    {
+        if(p < pattern.size() && pattern[p] == '*')
+        {
+            star = p++;
+            star_topic = t;
+        }
+        else if(p < pattern.size() && (pattern[p] == '?' || pattern[p] == topic[t]))
+        {
+            p++;
+            t++;
+        }
+        else if(star != std::string::npos)
+        {
+            p = star + 1;
+            t = ++star_topic;
+        }
+        else {
+            return false;
+        }
+    }
+    while(p < pattern.size() && pattern[p] == '*')
+    {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+bool hasCompressedPayload(const mcap::Schema& schema)
+{
+    for(const char* name: COMPRESSED_SCHEMAS)
+    {
+        if(schema.name.find(name) != std::string::npos)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+ChunkGroupAssigner::ChunkGroupAssigner(const EditPlan& plan, TopicStatsMap stats) :
+    plan_(plan),
+    stats_(std::move(stats)),
+    rule_groups_(plan.chunk_grouping.rules.size(), 0)
+{
+}
+
+size_t ChunkGroupAssigner::addGroup(mcap::McapWriter& writer,
+                                    mcap::Compression compression) const
+{
+    return writer.addChunkGroup({compression, plan_.compression_level, plan_.chunk_size});
+}
+
+void ChunkGroupAssigner::assign(mcap::McapWriter& writer, const mcap::Channel& channel,
+                                const mcap::Schema* schema, mcap::ChannelId output_id)
+{
+    const auto& grouping = plan_.chunk_grouping;
+    for(size_t i = 0; i < grouping.rules.size(); i++)
+    {
+        const auto& rule = grouping.rules[i];
+        if(matchTopicPattern(rule.topic_pattern, channel.topic))
+        {
+            if(rule_groups_[i] == 0)
+            {
+                rule_groups_[i] = addGroup(writer, rule.compression);
+            }
+            writer.setChunkGroup(output_id, rule_groups_[i]);
+            return;
+        }
+    }
+    if(!grouping.automatic)
+    {
+        return;
+    }
+
+    const bool compressed = schema && hasCompressedPayload(*schema);
+    const auto compression = compressed ? mcap::Compression::None : plan_.compression;
+    auto it = stats_.find(channel.id);
+    if(it != stats_.end() && it->second.last_time > it->second.first_time)
+    {
+        const auto& stats = it->second;
+        const double seconds = double(stats.last_time - stats.first_time) / NS_PER_S;
+        if(double(stats.bytes) / seconds >= grouping.high_bandwidth)
+        {
+            writer.setChunkGroup(output_id, addGroup(writer, compression));
+            return;
+        }
+    }
+    if(compressed)
+    {
+        if(compressed_group_ == 0)
+        {
+            compressed_group_ = addGroup(writer, mcap::Compression::None);
+        }
+        writer.setChunkGroup(output_id, compressed_group_);
+    }
+}
+
+}  // namespace mcap_editor
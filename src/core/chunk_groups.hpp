@@ -0,0 +1,46 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+#include <vector>
+
+#include "edit_plan.hpp"
+#include "topic_stats.hpp"
+
+namespace mcap_editor
+{
+
+// Whether a topic matches a ChunkGroupRule pattern, as a whole
+bool matchTopicPattern(const std::string& pattern, const std::string& topic);
+
+// Whether the messages of a schema are already compressed (JPEG or PNG
+// images, video), so that compressing their chunks again is wasted time
+bool hasCompressedPayload(const mcap::Schema& schema);
+
+// Puts the channels of an export in the chunk groups of the plan's
+// ChunkGrouping, adding the groups to the writer as they are first needed.
+// Channels left out stay in group 0.
+class ChunkGroupAssigner
+{
+public:
+    // stats, by input channel id, give the bandwidth of the channels for
+    // the automatic grouping; without them, only the schemas are looked at
+    ChunkGroupAssigner(const EditPlan& plan, TopicStatsMap stats);
+
+    // Call once the input channel was added to writer as output_id, before
+    // its first message is written
+    void assign(mcap::McapWriter& writer, const mcap::Channel& channel,
+                const mcap::Schema* schema, mcap::ChannelId output_id);
+
+private:
+    const EditPlan& plan_;
+    TopicStatsMap stats_;
+    // Group of each rule, 0 until one of its channels is seen
+    std::vector<size_t> rule_groups_;
+    // Shared by the channels with compressed payloads that are not grouped otherwise
+    size_t compressed_group_ = 0;
+
+    size_t addGroup(mcap::McapWriter& writer, mcap::Compression compression) const;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,318 @@
+#include "compression_analysis.hpp"
+#include "edit_config.hpp"
+
+#include <mcap/internal.hpp>
+#include <mcap/thread_pool.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace mcap_editor
+{
+
+namespace
+{
+constexpr double NS_PER_S = 1e9;
+// Record header: opcode and length
+constexpr uint64_t RECORD_HEADER_SIZE = 9;
+
+std::unique_ptr<mcap::IChunkWriter> makeChunkWriter(const CompressionOption& option)
+{
+    switch(option.compression)
+    {
+    case mcap::Compression::Lz4:
+        return std::make_unique<mcap::LZ4Writer>(option.level, option.chunk_size);
+    case mcap::Compression::Zstd:
+        return std::make_unique<mcap::ZStdWriter>(option.level, option.chunk_size);
+    case mcap::Compression::None:
+        break;
+    }
+    return std::make_unique<mcap::BufferWriter>();
+}
+
+// Ends of the chunks that mcap::McapWriter would write from records with
+// chunk_size: a chunk is closed after the record that makes it reach it
+std::vector<uint64_t> chunkEnds(const mcap::ByteArray& records, uint64_t chunk_size)
+{
+    std::vector<uint64_t> ends;
+    uint64_t chunk_start = 0;
+    uint64_t offset = 0;
+    while(records.size() - offset >= RECORD_HEADER_SIZE)
+    {
+        const uint64_t length = mcap::internal::ParseUint64(records.data() + offset + 1);
+        if(length > records.size() - offset - RECORD_HEADER_SIZE)
+        {
+            break;
+        }
+        offset += RECORD_HEADER_SIZE + length;
+        if(offset - chunk_start >= chunk_size)
+        {
+            ends.push_back(offset);
+            chunk_start = offset;
+        }
+    }
+    if(offset > chunk_start)
+    {
+        ends.push_back(offset);
+    }
+    return ends;
+}
+
+uint64_t elapsedNs(uint64_t start)
+{
+    return mcap::internal::SteadyClockNs() - start;
+}
+
+CompressionMeasure measure(const mcap::ByteArray& sample, const CompressionOption& option,
+                           const std::atomic_bool* cancel)
+{
+    CompressionMeasure result;
+    result.option = option;
+    auto chunk_writer = makeChunkWriter(option);
+    mcap::ByteArray decompressed;
+    mcap::LZ4Reader lz4_reader;
+    uint64_t compress_ns = 0;
+    uint64_t decompress_ns = 0;
+
+    uint64_t chunk_start = 0;
+    for(const uint64_t chunk_end: chunkEnds(sample, option.chunk_size))
+    {
+        if(cancel && *cancel)
+        {
+            break;
+        }
+        const uint64_t size = chunk_end - chunk_start;
+        const std::byte* data = sample.data() + chunk_start;
+        chunk_start = chunk_end;
+
+        uint64_t start = mcap::internal::SteadyClockNs();
+        chunk_writer->clear();
+        chunk_writer->write(data, size);
+        chunk_writer->end();
+        compress_ns += elapsedNs(start);
+        const uint64_t compressed_size = option.compression == mcap::Compression::None ?
+                                             size : chunk_writer->compressedSize();
+
+        start = mcap::internal::SteadyClockNs();
+        switch(option.compression)
+        {
+        case mcap::Compression::Lz4:
+            (void)lz4_reader.decompressAll(chunk_writer->compressedData(), compressed_size, size,
+                                           &decompressed);
+            break;
+        case mcap::Compression::Zstd:
+            (void)mcap::ZStdReader::DecompressAll(chunk_writer->compressedData(),
+                                                  compressed_size, size, &decompressed);
+            break;
+        case mcap::Compression::None:
+            // Still copied out of the chunk by readers
+            decompressed.resize(size);
+            std::memcpy(decompressed.data(), chunk_writer->data(), size);
+            break;
+        }
+        decompress_ns += elapsedNs(start);
+
+        result.chunk_count++;
+        result.uncompressed_bytes += size;
+        result.compressed_bytes += compressed_size;
+    }
+    result.compress_seconds = double(compress_ns) / NS_PER_S;
+    result.decompress_seconds = double(decompress_ns) / NS_PER_S;
+    return result;
+}
+}  // namespace
+
+std::string CompressionOption::name() const
+{
+    std::string text = mcap::internal::CompressionString(compression);
+    if(text.empty())
+    {
+        text = "none";
+    }
+    else {
+        text = text + " " + compressionLevelName(level);
+    }
+    if(chunk_size % (1024 * 1024) == 0)
+    {
+        return text + " " + std::to_string(chunk_size / (1024 * 1024)) + " MiB";
+    }
+    return text + " " + std::to_string(chunk_size / 1024) + " KiB";
+}
+
+double CompressionMeasure::ratio() const
+{
+    return compressed_bytes > 0 ? double(uncompressed_bytes) / double(compressed_bytes) : 0;
+}
+
+double CompressionMeasure::compressSpeed() const
+{
+    return compress_seconds > 0 ? double(uncompressed_bytes) / compress_seconds : 0;
+}
+
+double CompressionMeasure::decompressSpeed() const
+{
+    return decompress_seconds > 0 ? double(uncompressed_bytes) / decompress_seconds : 0;
+}
+
+double CompressionMeasure::throughput(double bandwidth) const
+{
+    return std::min(compressSpeed(), bandwidth * ratio());
+}
+
+std::vector<CompressionOption> CompressionAnalysisSettings::defaultOptions()
+{
+    const mcap::CompressionLevel levels[] = {
+        mcap::CompressionLevel::Fastest, mcap::CompressionLevel::Fast,
+        mcap::CompressionLevel::Default, mcap::CompressionLevel::Slow,
+        mcap::CompressionLevel::Slowest};
+    std::vector<CompressionOption> options;
+    for(const uint64_t chunk_size: {uint64_t(256 * 1024), mcap::DefaultChunkSize,
+                                    uint64_t(4 * 1024 * 1024)})
+    {
+        options.push_back({mcap::Compression::None, mcap::CompressionLevel::Default, chunk_size});
+        for(const auto compression: {mcap::Compression::Lz4, mcap::Compression::Zstd})
+        {
+            for(const auto level: levels)
+            {
+                options.push_back({compression, level, chunk_size});
+            }
+        }
+    }
+    return options;
+}
+
+mcap::Status analyzeCompression(mcap::McapReader& reader,
+                                const CompressionAnalysisSettings& settings,
+                                std::vector<CompressionMeasure>& measures,
+                                const std::atomic_bool* cancel)
+{
+    measures.clear();
+    if(settings.options.empty())
+    {
+        return {};
+    }
+    auto* source = reader.dataSource();
+    if(!source)
+    {
+        return {mcap::StatusCode::NotOpen};
+    }
+
+    // In file order, which is roughly the order of recording
+    std::vector<const mcap::ChunkIndex*> chunks;
+    uint64_t uncompressed_size = 0;
+    for(const auto& chunk_index: reader.chunkIndexes())
+    {
+        chunks.push_back(&chunk_index);
+        uncompressed_size += chunk_index.uncompressedSize;
+    }
+    if(chunks.empty() || uncompressed_size == 0)
+    {
+        return {mcap::StatusCode::MissingStatistics, "the file has no chunk to sample"};
+    }
+    std::sort(chunks.begin(), chunks.end(),
+              [](const mcap::ChunkIndex* a, const mcap::ChunkIndex* b)
+              { return a->chunkStartOffset < b->chunkStartOffset; });
+
+    // Chunks evenly spread over the file, so that every phase of the
+    // recording is represented
+    const uint64_t average_size = std::max<uint64_t>(1, uncompressed_size / chunks.size());
+    const size_t sample_count = size_t(std::clamp<uint64_t>(
+        (settings.sample_bytes + average_size - 1) / average_size, 1, chunks.size()));
+    std::vector<mcap::ChunkPrefetcher::Request> requests;
+    for(size_t i = 0; i < sample_count; i++)
+    {
+        const auto& chunk_index = *chunks[i * chunks.size() / sample_count];
+        requests.push_back({chunk_index.chunkStartOffset,
+                            chunk_index.chunkStartOffset + chunk_index.chunkLength, true});
+    }
+
+    const unsigned threads = settings.threads > 0 ?
+        settings.threads : std::max(1u, std::thread::hardware_concurrency());
+
+    // Records of the sampled chunks, one after the other
+    mcap::ByteArray sample;
+    {
+        // Without read-ahead, the chunks are decompressed on this thread
+        mcap::ChunkPrefetcher prefetcher(*source, requests, threads > 1 ? threads : 0, threads);
+        for(const auto& request: requests)
+        {
+            if(cancel && *cancel)
+            {
+                return {};
+            }
+            auto prefetched = prefetcher.take(request);
+            if(!prefetched->status.ok())
+            {
+                return prefetched->status;
+            }
+            sample.insert(sample.end(), prefetched->uncompressedRecords,
+                          prefetched->uncompressedRecords + prefetched->uncompressedSize);
+            prefetcher.recycle(std::move(prefetched));
+        }
+    }
+
+    // The slowest options first, so that they don't finish last on their own
+    std::vector<size_t> order(settings.options.size());
+    for(size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    {
+        return settings.options[a].level > settings.options[b].level;
+    });
+
+    measures.resize(settings.options.size());
+    if(threads == 1)
+    {
+        for(const size_t i: order)
+        {
+            measures[i] = measure(sample, settings.options[i], cancel);
+        }
+    }
+    else {
+        mcap::internal::ThreadPool pool(std::min<size_t>(threads, order.size()));
+        std::vector<std::future<void>> done;
+        for(const size_t i: order)
+        {
+            done.push_back(pool.submit([&, i]
+            {
+                measures[i] = measure(sample, settings.options[i], cancel);
+            }));
+        }
+        for(auto& future: done)
+        {
+            future.get();
+        }
+    }
+    if(cancel && *cancel)
+    {
+        // Partial measures would mislead
+        measures.erase(std::remove_if(measures.begin(), measures.end(),
+                                      [&](const CompressionMeasure& m)
+                                      { return m.uncompressed_bytes != sample.size(); }),
+                       measures.end());
+    }
+    return {};
+}
+
+size_t recommendCompression(const std::vector<CompressionMeasure>& measures, double bandwidth)
+{
+    size_t best = measures.size();
+    for(size_t i = 0; i < measures.size(); i++)
+    {
+        const double throughput = measures[i].throughput(bandwidth);
+        if(best == measures.size() || throughput > measures[best].throughput(bandwidth) ||
+           (throughput == measures[best].throughput(bandwidth) &&
+            measures[i].ratio() > measures[best].ratio()))
+        {
+            best = i;
+        }
+    }
+    return best;
+}
+
+}  // namespace mcap_editor
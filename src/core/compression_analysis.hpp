@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+#include <string>
+#include <vector>
+
+namespace mcap_editor
+{
+
+// How the output chunks are written, see mcap::McapWriterOptions
+struct CompressionOption
+{
+    mcap::Compression compression = mcap::Compression::Zstd;
+    mcap::CompressionLevel level = mcap::CompressionLevel::Default;
+    uint64_t chunk_size = mcap::DefaultChunkSize;
+
+    // e.g. "zstd slow 768 KiB"
+    std::string name() const;
+};
+
+// Result of compressing the sample with one option
+struct CompressionMeasure
+{
+    CompressionOption option;
+    uint64_t chunk_count = 0;
+    uint64_t uncompressed_bytes = 0;
+    uint64_t compressed_bytes = 0;
+    // On one thread
+    double compress_seconds = 0;
+    double decompress_seconds = 0;
+
+    // Uncompressed size over compressed size
+    double ratio() const;
+    // Uncompressed bytes per second, on one core
+    double compressSpeed() const;
+    double decompressSpeed() const;
+    // Uncompressed bytes per second written and uploaded at bandwidth bytes
+    // per second, while one core compresses the next chunks: the slowest of
+    // the two sets the pace
+    double throughput(double bandwidth) const;
+};
+
+struct CompressionAnalysisSettings
+{
+    std::vector<CompressionOption> options = defaultOptions();
+    // Uncompressed bytes taken from chunks spread over the file
+    uint64_t sample_bytes = 16 * 1024 * 1024;
+    // Options measured at the same time (0 = one per core)
+    unsigned threads = 0;
+
+    // No compression, every level of LZ4 and Zstd, each with chunks of
+    // 256 KiB, 768 KiB (the default) and 4 MiB
+    static std::vector<CompressionOption> defaultOptions();
+};
+
+// Decompresses a sample of the chunks listed in the summary (already read),
+// then writes it again with each option of settings, in chunks cut at record
+// boundaries like mcap::McapWriter does. Options are measured in parallel;
+// their times are those of the thread that measured them. Fails if the file
+// has no chunk. With cancel, returns early once it is set, with the options
+// measured so far.
+mcap::Status analyzeCompression(mcap::McapReader& reader,
+                                const CompressionAnalysisSettings& settings,
+                                std::vector<CompressionMeasure>& measures,
+                                const std::atomic_bool* cancel = nullptr);
+
+// The measure with the highest throughput at bandwidth, the smallest output
+// among equals. A high bandwidth favours fast options, a low one small
+// outputs. Returns measures.size() if it is empty.
+size_t recommendCompression(const std::vector<CompressionMeasure>& measures, double bandwidth);
+
+}  // namespace mcap_editor
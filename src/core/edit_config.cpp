@@ -0,0 +1,277 @@
+#include "edit_config.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <set>
+
+namespace mcap_editor
+{
+
+namespace
+{
+std::string trim(const std::string& text)
+{
+    const size_t start = text.find_first_not_of(" \t\r");
+    if(start == std::string::npos)
+    {
+        return {};
+    }
+    return text.substr(start, text.find_last_not_of(" \t\r") - start + 1);
+}
+
+bool parseBool(const std::string& text, bool& value)
+{
+    if(text == "true") { value = true; }
+    else if(text == "false") { value = false; }
+    else { return false; }
+    return true;
+}
+
+// Sets the option of key, false if key or value is invalid
+bool parseOption(const std::string& key, const std::string& value, EditConfig& config)
+{
+    auto& plan = config.plan;
+    if(key == "topic")
+    {
+        if(!plan.topics) { plan.topics.emplace(); }
+        plan.topics->insert(value);
+        return true;
+    }
+    if(key == "exclude")
+    {
+        config.excluded_topics.push_back(value);
+        return true;
+    }
+    if(key == "attachment")
+    {
+        if(!plan.attachments) { plan.attachments.emplace(); }
+        plan.attachments->insert(value);
+        return true;
+    }
+    if(key == "no_attachments")
+    {
+        bool none = false;
+        if(!parseBool(value, none)) { return false; }
+        if(none) { plan.attachments.emplace(); }
+        return true;
+    }
+    if(key == "start") { return parseNumber(value, plan.start_time); }
+    if(key == "end") { return parseNumber(value, plan.end_time); }
+    if(key == "skip") { return parseNumber(value, config.skip); }
+    if(key == "duration") { return parseNumber(value, config.duration); }
+    if(key == "compression") { return parseCompression(value, plan.compression); }
+    if(key == "level") { return parseCompressionLevel(value, plan.compression_level); }
+    if(key == "chunk_size") { return parseNumber(value, plan.chunk_size) && plan.chunk_size > 0; }
+    if(key == "group_chunks") { return parseBool(value, plan.chunk_grouping.automatic); }
+    if(key == "chunk_group")
+    {
+        ChunkGroupRule rule;
+        if(!parseChunkGroupRule(value, rule)) { return false; }
+        plan.chunk_grouping.rules.push_back(std::move(rule));
+        return true;
+    }
+    if(key == "copy_chunks") { return parseBool(value, plan.copy_chunks); }
+    if(key == "reindex") { return parseBool(value, plan.keep_chunk_compression); }
+    if(key == "log_time_order") { return parseBool(value, plan.log_time_order); }
+    return false;
+}
+}  // namespace
+
+bool parseNumber(const std::string& text, uint64_t& value)
+{
+    if(text.empty() || text.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+    errno = 0;
+    value = std::strtoull(text.c_str(), nullptr, 10);
+    return errno == 0;
+}
+
+bool parseChunkGroupRule(const std::string& text, ChunkGroupRule& rule)
+{
+    const size_t separator = text.rfind('=');
+    if(separator == std::string::npos || separator == 0 ||
+       !parseCompression(text.substr(separator + 1), rule.compression))
+    {
+        return false;
+    }
+    rule.topic_pattern = text.substr(0, separator);
+    return true;
+}
+
+bool parseCompression(const std::string& name, mcap::Compression& compression)
+{
+    if(name == "none") { compression = mcap::Compression::None; }
+    else if(name == "lz4") { compression = mcap::Compression::Lz4; }
+    else if(name == "zstd") { compression = mcap::Compression::Zstd; }
+    else { return false; }
+    return true;
+}
+
+bool parseCompressionLevel(const std::string& name, mcap::CompressionLevel& level)
+{
+    if(name == "fastest") { level = mcap::CompressionLevel::Fastest; }
+    else if(name == "fast") { level = mcap::CompressionLevel::Fast; }
+    else if(name == "default") { level = mcap::CompressionLevel::Default; }
+    else if(name == "slow") { level = mcap::CompressionLevel::Slow; }
+    else if(name == "slowest") { level = mcap::CompressionLevel::Slowest; }
+    else { return false; }
+    return true;
+}
+
+std::string compressionName(mcap::Compression compression)
+{
+    switch(compression)
+    {
+    case mcap::Compression::Lz4: return "lz4";
+    case mcap::Compression::Zstd: return "zstd";
+    case mcap::Compression::None: break;
+    }
+    return "none";
+}
+
+std::string compressionLevelName(mcap::CompressionLevel level)
+{
+    switch(level)
+    {
+    case mcap::CompressionLevel::Fastest: return "fastest";
+    case mcap::CompressionLevel::Fast: return "fast";
+    case mcap::CompressionLevel::Default: break;
+    case mcap::CompressionLevel::Slow: return "slow";
+    case mcap::CompressionLevel::Slowest: return "slowest";
+    }
+    return "default";
+}
+
+mcap::Status loadEditConfig(const std::string& filename, EditConfig& config)
+{
+    std::ifstream file(filename);
+    if(!file)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    config = {};
+    std::string line;
+    for(int line_number = 1; std::getline(file, line); line_number++)
+    {
+        line = trim(line);
+        if(line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        const size_t separator = line.find('=');
+        if(separator == std::string::npos ||
+           !parseOption(trim(line.substr(0, separator)), trim(line.substr(separator + 1)),
+                        config))
+        {
+            return {mcap::StatusCode::InvalidFile,
+                    filename + ":" + std::to_string(line_number) + ": invalid line: " + line};
+        }
+    }
+    return {};
+}
+
+mcap::Status saveEditConfig(const std::string& filename, const EditConfig& config)
+{
+    std::ofstream file(filename);
+    if(!file)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    const auto& plan = config.plan;
+    file << "# mcap_editor edit configuration\n";
+    if(plan.topics)
+    {
+        for(const auto& topic: *plan.topics)
+        {
+            file << "topic = " << topic << "\n";
+        }
+    }
+    for(const auto& topic: config.excluded_topics)
+    {
+        file << "exclude = " << topic << "\n";
+    }
+    if(plan.attachments && plan.attachments->empty())
+    {
+        file << "no_attachments = true\n";
+    }
+    else if(plan.attachments)
+    {
+        for(const auto& name: *plan.attachments)
+        {
+            file << "attachment = " << name << "\n";
+        }
+    }
+    if(plan.start_time != 0)
+    {
+        file << "start = " << plan.start_time << "\n";
+    }
+    if(plan.end_time != mcap::MaxTime)
+    {
+        file << "end = " << plan.end_time << "\n";
+    }
+    if(config.skip != 0)
+    {
+        file << "skip = " << config.skip << "\n";
+    }
+    if(config.duration != 0)
+    {
+        file << "duration = " << config.duration << "\n";
+    }
+    file << "compression = " << compressionName(plan.compression) << "\n";
+    file << "level = " << compressionLevelName(plan.compression_level) << "\n";
+    file << "chunk_size = " << plan.chunk_size << "\n";
+    file << "group_chunks = " << (plan.chunk_grouping.automatic ? "true" : "false") << "\n";
+    for(const auto& rule: plan.chunk_grouping.rules)
+    {
+        file << "chunk_group = " << rule.topic_pattern << "=" << compressionName(rule.compression)
+             << "\n";
+    }
+    file << "copy_chunks = " << (plan.copy_chunks ? "true" : "false") << "\n";
+    file << "reindex = " << (plan.keep_chunk_compression ? "true" : "false") << "\n";
+    file << "log_time_order = " << (plan.log_time_order ? "true" : "false") << "\n";
+    file.close();
+    if(!file)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to write \"" + filename + "\""};
+    }
+    return {};
+}
+
+EditPlan resolveEditConfig(const EditConfig& config, const FileInfo& info)
+{
+    EditPlan plan = config.plan;
+    if(!config.excluded_topics.empty())
+    {
+        std::set<std::string> topics;
+        for(const auto& topic: info.topics)
+        {
+            if(plan.keepsTopic(topic.topic))
+            {
+                topics.insert(topic.topic);
+            }
+        }
+        for(const auto& topic: config.excluded_topics)
+        {
+            topics.erase(topic);
+        }
+        plan.topics = std::move(topics);
+    }
+    if(config.skip != 0 || config.duration != 0)
+    {
+        // Without overflow: the range stays empty or open-ended
+        const auto start_time = mcap::MaxTime - info.start_time > config.skip ?
+                                    info.start_time + config.skip : mcap::MaxTime;
+        plan.start_time = std::max(plan.start_time, start_time);
+        if(config.duration != 0 && mcap::MaxTime - start_time > config.duration)
+        {
+            plan.end_time = std::min(plan.end_time, start_time + config.duration);
+        }
+    }
+    return plan;
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <string>
+#include <vector>
+
+#include "edit_plan.hpp"
+#include "file_info.hpp"
+
+namespace mcap_editor
+{
+
+// Edits to apply to any recording, e.g. to a batch of them (see
+// BatchRunner): an EditPlan without its files, whose rules are resolved
+// against each file by resolveEditConfig().
+struct EditConfig
+{
+    // Its files and channel ids, which are those of a single file, are not
+    // saved
+    EditPlan plan;
+    // Topics dropped, from those of plan.topics or of the file
+    std::vector<std::string> excluded_topics;
+    // Log time dropped at the start of each file, from its first message
+    mcap::Timestamp skip = 0;
+    // Log time kept after it (0 = until the end)
+    mcap::Timestamp duration = 0;
+};
+
+// Decimal digits only, as in the configurations and the options of the CLI
+bool parseNumber(const std::string& text, uint64_t& value);
+// PATTERN=COMPRESSION, e.g. "/camera/*=none"
+bool parseChunkGroupRule(const std::string& text, ChunkGroupRule& rule);
+bool parseCompression(const std::string& name, mcap::Compression& compression);
+bool parseCompressionLevel(const std::string& name, mcap::CompressionLevel& level);
+// "none", "lz4", "zstd"
+std::string compressionName(mcap::Compression compression);
+// "fastest" ... "slowest"
+std::string compressionLevelName(mcap::CompressionLevel level);
+
+// Reads a configuration saved by saveEditConfig(): one "key = value" per line,
+// in any order, blank lines and lines starting with '#' ignored. The keys are
+// topic, exclude and attachment (repeatable), no_attachments, start and end
+// (absolute log times), skip and duration (nanoseconds), compression, level,
+// chunk_size, group_chunks, chunk_group (repeatable, PATTERN=COMPRESSION),
+// copy_chunks, reindex and log_time_order. reindex, named after the option
+// of the CLI, sets EditPlan::keep_chunk_compression.
+// Missing keys keep their default.
+mcap::Status loadEditConfig(const std::string& filename, EditConfig& config);
+
+mcap::Status saveEditConfig(const std::string& filename, const EditConfig& config);
+
+// The plan of config for a file: exclusions become the list of the topics of
+// info kept, and skip and duration a time range from its first message
+EditPlan resolveEditConfig(const EditConfig& config, const FileInfo& info);
+
+}  // namespace mcap_editor
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <mcap/writer.hpp>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "write_behind_writer.hpp"
+
+namespace mcap_editor
+{
+
+// Channels whose topic matches pattern are written to chunks of their own,
+// compressed with compression
+struct ChunkGroupRule
+{
+    // '*' matches any characters, '?' one, e.g. "/camera/*"
+    std::string topic_pattern;
+    mcap::Compression compression = mcap::Compression::Zstd;
+};
+
+// How channels are spread over separate chunk streams (see
+// mcap::McapWriter::addChunkGroup), so that reading a few topics later
+// doesn't decompress the others. The channels left out share the chunks of
+// the plan's compression.
+struct ChunkGrouping
+{
+    // Tried in order: the channels matching the same rule share a group
+    std::vector<ChunkGroupRule> rules;
+    // For the channels no rule matches: those above high_bandwidth bytes per
+    // second get a group each, and the remaining ones with already compressed
+    // payloads (images, video) share a group without compression
+    bool automatic = false;
+    double high_bandwidth = 1e6;
+
+    bool enabled() const { return automatic || !rules.empty(); }
+};
+
+// What to keep from an MCAP file, and how to write it again.
+// Plain data: filled by the GUI or the command line, executed by Exporter.
+struct EditPlan
+{
+    std::string input_file;
+    std::string output_file;
+
+    // Topics to keep. When not set, every topic is kept
+    std::optional<std::set<std::string>> topics;
+    // Channels to keep, by id in the input file, which tells apart channels
+    // sharing a topic. When not set, every channel of the topics is kept.
+    std::optional<std::set<mcap::ChannelId>> channels;
+    // Attachments to keep, by name. When not set, every attachment is kept.
+    // Metadata records are always kept.
+    std::optional<std::set<std::string>> attachments;
+
+    // Messages with start_time <= log time < end_time are kept
+    mcap::Timestamp start_time = 0;
+    mcap::Timestamp end_time = mcap::MaxTime;
+
+    mcap::Compression compression = mcap::Compression::Zstd;
+    mcap::CompressionLevel compression_level = mcap::CompressionLevel::Default;
+    uint64_t chunk_size = mcap::DefaultChunkSize;
+    // Chunks are not copied when channels are grouped, since they mix them
+    ChunkGrouping chunk_grouping;
+
+    // Copy the chunks that don't need to change, instead of decoding them
+    bool copy_chunks = true;
+    // Copy the chunks kept entirely even if they are not compressed with
+    // `compression`, which then only applies to the chunks written anew
+    bool keep_chunk_compression = false;
+    // Write the messages that are decoded, rather than copied with their
+    // chunk, in log time order instead of the order of the file. It needs the
+    // message indexes of every chunk: files missing some keep their order.
+    bool log_time_order = false;
+    // Chunks read and decompressed ahead of time on other threads (0 = none).
+    // Messages decoded in the order of the file are read without it.
+    size_t read_ahead_chunks = 0;
+    // 0 = one per read-ahead chunk, up to the number of cores
+    unsigned decompression_threads = 0;
+    // Threads compressing the output chunks (0 = compress on the export thread)
+    unsigned compression_threads = 0;
+    // Read the chunks ahead and write the output with several requests in
+    // flight (io_uring on Linux), instead of mapping the input and writing
+    // through stdio
+    bool async_io = false;
+    // Write the output in large blocks from a background thread (see
+    // WriteBehindWriter), instead of through stdio or async_io
+    std::optional<WriteBehindOptions> write_behind;
+
+    bool keepsTopic(const std::string& topic) const
+    {
+        return !topics || topics->count(topic) != 0;
+    }
+
+    bool keepsAttachment(const std::string& name) const
+    {
+        return !attachments || attachments->count(name) != 0;
+    }
+
+    // See ChannelSelection, to decide on each channel only once
+    bool keepsChannel(const mcap::Channel& channel) const
+    {
+        return keepsTopic(channel.topic) && (!channels || channels->count(channel.id) != 0);
+    }
+};
+
+}  // namespace mcap_editor
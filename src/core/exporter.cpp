@@ -0,0 +1,680 @@
+#include "exporter.hpp"
+#include "channel_selection.hpp"
+#include "chunk_groups.hpp"
+#include "file_info.hpp"
+#include "measured_io.hpp"
+#include "message_copy.hpp"
+#include "plan_io.hpp"
+#include "topic_stats.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+
+namespace mcap_editor
+{
+
+Exporter::Exporter(EditPlan plan) :
+    plan_(std::move(plan))
+{
+}
+
+void Exporter::setProgressCallback(ProgressCallback callback)
+{
+    progress_callback_ = std::move(callback);
+}
+
+void Exporter::cancel()
+{
+    cancel_requested_ = true;
+}
+
+bool Exporter::canceled() const
+{
+    return cancel_requested_;
+}
+
+void Exporter::reportProgress(uint64_t done, uint64_t total)
+{
+    stats_.sampleMemory();
+    if(progress_callback_)
+    {
+        progress_callback_(done, total);
+    }
+}
+
+mcap::McapWriterOptions Exporter::writerOptions(mcap::McapReader& reader)
+{
+    mcap::McapWriterOptions options(reader.header() ? reader.header()->profile : "");
+    options.compression = plan_.compression;
+    options.compressionLevel = plan_.compression_level;
+    options.chunkSize = plan_.chunk_size;
+    options.compressionThreads = plan_.compression_threads;
+    options.onChunkCompressed = [this](const mcap::ChunkCodecTiming& timing)
+    {
+        stats_.add(Stage::Compress, timing.startTime, timing.duration, timing.uncompressedSize, 0);
+    };
+    return options;
+}
+
+mcap::Status Exporter::run()
+{
+    PlanInput input;
+    auto status = input.open(plan_.input_file, plan_);
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    uint64_t size_hint = 0;
+    if(plan_.write_behind && plan_.write_behind->preallocate)
+    {
+        mcap::McapReader reader;
+        if(reader.open(input.readable()).ok())
+        {
+            (void)reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+            size_hint = estimateOutputSize(reader, plan_);
+        }
+    }
+    PlanOutput output;
+    status = output.open(plan_.output_file, plan_, size_hint);
+    if(!status.ok())
+    {
+        return status;
+    }
+    status = run(input.readable(), output.writable());
+    // Errors of the writes in flight are only known once the file is closed
+    return status.ok() ? output.status() : status;
+}
+
+mcap::Status Exporter::run(mcap::IReadable& input, mcap::IWritable& output)
+{
+    stats_.start(input.size());
+    MeasuredReader measured_input(input, stats_);
+    MeasuredWriter measured_output(output, stats_);
+
+    mcap::McapReader reader;
+    auto status = reader.open(measured_input);
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    mcap::McapWriter writer;
+    writer.open(measured_output, writerOptions(reader));
+    status = exportFile(reader, writer);
+    stats_.finish();
+    return status;
+}
+
+mcap::Status Exporter::exportFile(mcap::McapReader& reader, mcap::McapWriter& writer)
+{
+    // Copying chunks verbatim is planned from the chunk index and the message
+    // indexes of the source file. Without them, the data section is read in
+    // order and the message indexes rebuilt from the decompressed chunks.
+    mcap::ProblemCallback problem = [](const mcap::Status&) {};
+    bool has_summary = reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan, problem).ok();
+    if(!has_summary && summary_cache_ && !plan_.input_file.empty())
+    {
+        // Lists the chunks, so that only those in the time range are read
+        has_summary = summary_cache_->load(plan_.input_file, reader).ok();
+    }
+    const auto& chunk_indexes = reader.chunkIndexes();
+    const bool indexed = has_summary && hasMessageIndexes(reader);
+
+    // Attachments and metadata are written first: the writer closes its chunk
+    // before each of them. Without summary (nor cached one), the data section
+    // is walked to find them, whatever path copies the messages.
+    std::vector<AttachmentRecord> attachments;
+    auto status = listAttachments(reader, has_summary, plan_, attachments);
+    if(status.ok())
+    {
+        status = copyAttachments(reader, attachments, writer);
+    }
+    if(!status.ok() || cancel_requested_)
+    {
+        // The output is still closed
+    }
+    else if(!plan_.copy_chunks || plan_.chunk_grouping.enabled() ||
+            (has_summary && chunk_indexes.empty()))
+    {
+        status = copyMessages(reader, writer);
+    }
+    else if(indexed)
+    {
+        status = copyChunks(reader, writer);
+    }
+    else {
+        status = reindexChunks(reader, writer);
+    }
+    {
+        // Writes the last chunk and the summary
+        StageTimer timer(stats_, Stage::Write, 0, 0);
+        writer.close();
+    }
+    return status;
+}
+
+mcap::Status Exporter::copyMessages(mcap::McapReader& reader, mcap::McapWriter& writer)
+{
+    ChannelSelection selection(plan_);
+    std::optional<ChunkGroupAssigner> groups;
+    if(plan_.chunk_grouping.enabled())
+    {
+        // The bandwidth of the channels comes from the message indexes. Without
+        // them, only their schemas tell the images apart.
+        TopicStatsMap topic_stats;
+        if(plan_.chunk_grouping.automatic)
+        {
+            (void)computeTopicStats(reader, topic_stats);
+        }
+        groups.emplace(plan_, std::move(topic_stats));
+    }
+
+    // Schemas and channels get new ids in the output
+    ChannelMapping channels(writer, groups ? &*groups : nullptr);
+    channels.addChannels(reader, selection);
+
+    mcap::ProblemCallback problem = [](const mcap::Status&) {};
+    const auto options =
+        readMessageOptions(plan_, reader, plan_.log_time_order, selection, stats_);
+    const bool log_time_order = readsInLogTimeOrder(options);
+    const uint64_t file_size = reader.dataSource()->size();
+
+    for (const auto& msg : reader.readMessages(problem, options))
+    {
+        const auto new_channel_id = channels.outputId(*msg.channel, msg.schema);
+
+        // Written from the decompressed chunk, only the channel id changes
+        mcap::Status status;
+        {
+            StageTimer timer(stats_, Stage::Write, msg.message.dataSize, 1, false);
+            status = writer.write(msg, new_channel_id);
+        }
+        if (!status.ok())
+        {
+            return status;
+        }
+        if (cancel_requested_)
+        {
+            break;
+        }
+        reportProgress(fileOffset(msg, log_time_order), file_size);
+    }
+    return {};
+}
+
+mcap::Status Exporter::copyChunks(mcap::McapReader& reader, mcap::McapWriter& writer)
+{
+    // Chunks are copied as they are, so the source schema and channel ids are kept
+    ChannelSelection selection(plan_);
+    for (const auto& [channel_id, channel] : reader.channels())
+    {
+        if(!selection.add(*channel))
+        {
+            continue;
+        }
+        if(auto schema = reader.schema(channel->schemaId))
+        {
+            writer.addSchemaWithId(*schema);
+        }
+        writer.addChannelWithId(*channel);
+    }
+
+    const auto start_time = plan_.start_time;
+    const auto end_time = plan_.end_time;
+    const auto target_compression = plan_.compression;
+    auto& source = *reader.dataSource();
+    mcap::Status status;
+
+    // Chunks that can't be copied are decoded, and their messages written one by one
+    mcap::TypedChunkReader chunk_reader;
+    chunk_reader.onMessage = [&](const mcap::Message& msg, mcap::ByteOffset)
+    {
+        {
+            StageTimer timer(stats_, Stage::Filter, msg.dataSize, 1, false);
+            if(msg.logTime < start_time || msg.logTime >= end_time ||
+               !selection.keeps(msg.channelId) || !status.ok())
+            {
+                return;
+            }
+        }
+        StageTimer timer(stats_, Stage::Write, msg.dataSize, 1, false);
+        status = writer.write(msg);
+    };
+
+    // First decide what to do with each chunk, so that the next ones can be read
+    // and decompressed in the background while the current one is written.
+    struct ChunkTask
+    {
+        const mcap::ChunkIndex* index;
+        bool copy_verbatim;
+    };
+    std::vector<ChunkTask> tasks;
+    std::vector<mcap::ChunkPrefetcher::Request> requests;
+
+    std::optional<StageTimer> filter_timer;
+    filter_timer.emplace(stats_, Stage::Filter, 0, 0);
+    for (const auto& chunk_index : reader.chunkIndexes())
+    {
+        // Chunks outside the time range are skipped without reading them
+        if(chunk_index.messageEndTime < start_time ||
+           chunk_index.messageStartTime >= end_time)
+        {
+            continue;
+        }
+
+        // Without message indexes we can't tell which channels are in the chunk
+        const bool indexed = chunk_index.messageIndexLength > 0;
+        bool any_selected = !indexed;
+        bool all_selected = indexed;
+        for (const auto& [channel_id, offset] : chunk_index.messageIndexOffsets)
+        {
+            const bool selected = selection.keeps(channel_id);
+            any_selected = any_selected || selected;
+            all_selected = all_selected && selected;
+        }
+        if(!any_selected)
+        {
+            continue;
+        }
+
+        const auto compression = mcap::McapReader::ParseCompression(chunk_index.compression);
+        const bool copy_verbatim = all_selected &&
+                                   chunk_index.messageStartTime >= start_time &&
+                                   chunk_index.messageEndTime < end_time &&
+                                   (compression == target_compression ||
+                                    plan_.keep_chunk_compression);
+
+        // Copied chunks need their message indexes, decoded chunks only their records
+        const auto chunk_end = chunk_index.chunkStartOffset + chunk_index.chunkLength;
+        tasks.push_back({&chunk_index, copy_verbatim});
+        requests.push_back({chunk_index.chunkStartOffset,
+                            copy_verbatim ? chunk_end + chunk_index.messageIndexLength : chunk_end,
+                            !copy_verbatim});
+    }
+
+    filter_timer.reset();
+
+    mcap::ChunkPrefetcher prefetcher(source, requests, plan_.read_ahead_chunks,
+                                     plan_.decompression_threads,
+                                     [this](const mcap::ChunkCodecTiming& timing)
+    {
+        stats_.add(Stage::Decompress, timing.startTime, timing.duration,
+                   timing.uncompressedSize, 0);
+    });
+
+    for (size_t i = 0; i < tasks.size(); i++)
+    {
+        if (cancel_requested_)
+        {
+            break;
+        }
+        const auto& chunk_index = *tasks[i].index;
+        reportProgress(chunk_index.chunkStartOffset, source.size());
+
+        auto prefetched = prefetcher.take(requests[i]);
+        status = prefetched->status;
+
+        if(status.ok() && tasks[i].copy_verbatim)
+        {
+            // The message indexes follow the chunk record
+            std::vector<mcap::MessageIndex> message_indexes;
+            mcap::BufferReader records;
+            records.reset(prefetched->records, prefetched->recordsSize,
+                          prefetched->recordsSize);
+            mcap::RecordReader index_reader(records, chunk_index.chunkLength,
+                                            prefetched->recordsSize);
+            for (auto record = index_reader.next(); record && status.ok();
+                 record = index_reader.next())
+            {
+                if(record->opcode == mcap::OpCode::MessageIndex)
+                {
+                    status = mcap::McapReader::ParseMessageIndex(
+                        *record, &message_indexes.emplace_back());
+                }
+            }
+            if(status.ok())
+            {
+                status = index_reader.status();
+            }
+            if(status.ok())
+            {
+                uint64_t messages = 0;
+                for (const auto& message_index : message_indexes)
+                {
+                    messages += message_index.records.size();
+                }
+                StageTimer timer(stats_, Stage::Write, prefetched->chunk.uncompressedSize,
+                                 messages);
+                status = writer.copyChunk(prefetched->chunk, message_indexes);
+            }
+        }
+        else if(status.ok())
+        {
+            // Already decompressed by the prefetcher
+            mcap::Chunk uncompressed = prefetched->chunk;
+            uncompressed.records = prefetched->uncompressedRecords;
+            uncompressed.compressedSize = prefetched->uncompressedSize;
+            uncompressed.uncompressedSize = prefetched->uncompressedSize;
+            chunk_reader.reset(uncompressed, mcap::Compression::None);
+            status = chunk_reader.status();
+            while(status.ok() && !cancel_requested_ && chunk_reader.next())
+            {
+                if(!chunk_reader.status().ok())
+                {
+                    status = chunk_reader.status();
+                }
+            }
+        }
+
+        if(!status.ok())
+        {
+            return status;
+        }
+        prefetcher.recycle(std::move(prefetched));
+    }
+    return {};
+}
+
+mcap::Status Exporter::reindexChunks(mcap::McapReader& reader, mcap::McapWriter& writer)
+{
+    auto& source = *reader.dataSource();
+    const uint64_t file_size = source.size();
+
+    // The data section starts after the magic and the header record. Like the
+    // scan of mcap::McapReader, the walk stops at the first incomplete record,
+    // so truncated files keep everything before it.
+    auto record_header = [&](uint64_t offset, mcap::OpCode& opcode, uint64_t& length) -> bool
+    {
+        if(offset > file_size || file_size - offset < 9)
+        {
+            return false;
+        }
+        std::byte* data = nullptr;
+        if(source.read(&data, offset, 9) != 9)
+        {
+            return false;
+        }
+        opcode = mcap::OpCode(data[0]);
+        length = mcap::internal::ParseUint64(data + 1);
+        return length <= file_size - offset - 9;
+    };
+    mcap::OpCode opcode;
+    uint64_t length = 0;
+    if(!record_header(sizeof(mcap::Magic), opcode, length) || opcode != mcap::OpCode::Header)
+    {
+        return {mcap::StatusCode::InvalidFile, "missing header record"};
+    }
+    const uint64_t data_start = sizeof(mcap::Magic) + 9 + length;
+    const uint64_t data_end = reader.dataEnd();
+
+    // Each chunk is decompressed once, in the background, to find its messages.
+    // When the summary lists the chunks (e.g. from the summary cache), the ones
+    // outside the time range are never read. Otherwise the data section is
+    // walked to find them.
+    const auto start_time = plan_.start_time;
+    const auto end_time = plan_.end_time;
+    const auto& chunk_indexes = reader.chunkIndexes();
+    std::vector<mcap::ChunkPrefetcher::Request> requests;
+    for(const auto& chunk_index: chunk_indexes)
+    {
+        if(chunk_index.messageEndTime >= start_time && chunk_index.messageStartTime < end_time)
+        {
+            requests.push_back({chunk_index.chunkStartOffset,
+                                chunk_index.chunkStartOffset + chunk_index.chunkLength, true});
+        }
+    }
+    if(chunk_indexes.empty())
+    {
+        StageTimer timer(stats_, Stage::Read, 0, 0);
+        for(uint64_t offset = data_start;
+            offset < data_end && record_header(offset, opcode, length) &&
+            opcode != mcap::OpCode::DataEnd && opcode != mcap::OpCode::Footer;
+            offset += 9 + length)
+        {
+            if(opcode == mcap::OpCode::Chunk)
+            {
+                requests.push_back({offset, offset + 9 + length, true});
+            }
+        }
+    }
+    mcap::ChunkPrefetcher prefetcher(source, requests, plan_.read_ahead_chunks,
+                                     plan_.decompression_threads,
+                                     [this](const mcap::ChunkCodecTiming& timing)
+    {
+        stats_.add(Stage::Decompress, timing.startTime, timing.duration,
+                   timing.uncompressedSize, 0);
+    });
+
+    // Chunks are copied as they are, so the source schema and channel ids are
+    // kept. Schemas are only written if a kept channel uses them.
+    std::unordered_map<mcap::SchemaId, mcap::Schema> schemas;
+    ChannelSelection selection(plan_);
+    auto add_record = [&](const mcap::Record& record) -> mcap::Status
+    {
+        if(record.opcode == mcap::OpCode::Schema)
+        {
+            mcap::Schema schema;
+            auto status = mcap::McapReader::ParseSchema(record, &schema);
+            if(status.ok())
+            {
+                schemas.emplace(schema.id, std::move(schema));
+            }
+            return status;
+        }
+        mcap::Channel channel;
+        auto status = mcap::McapReader::ParseChannel(record, &channel);
+        if(!status.ok() || selection.known(channel.id) || !selection.add(channel))
+        {
+            return status;
+        }
+        auto it = schemas.find(channel.schemaId);
+        if(it != schemas.end())
+        {
+            writer.addSchemaWithId(it->second);
+        }
+        writer.addChannelWithId(channel);
+        return {};
+    };
+    // Channels of the summary, which may be defined in chunks that are skipped
+    for(const auto& [channel_id, channel]: reader.channels())
+    {
+        if(!selection.add(*channel))
+        {
+            continue;
+        }
+        if(auto schema = reader.schema(channel->schemaId))
+        {
+            writer.addSchemaWithId(*schema);
+        }
+        writer.addChannelWithId(*channel);
+    }
+
+    mcap::Status status;
+    auto write_message = [&](const mcap::Message& msg)
+    {
+        {
+            StageTimer timer(stats_, Stage::Filter, msg.dataSize, 1, false);
+            if(msg.logTime < start_time || msg.logTime >= end_time ||
+               !selection.keeps(msg.channelId) || !status.ok())
+            {
+                return;
+            }
+        }
+        StageTimer timer(stats_, Stage::Write, msg.dataSize, 1, false);
+        status = writer.write(msg);
+    };
+    mcap::TypedChunkReader chunk_reader;
+    chunk_reader.onMessage = [&](const mcap::Message& msg, mcap::ByteOffset)
+    {
+        write_message(msg);
+    };
+
+    // Rebuilds the message indexes of a chunk from its decompressed records,
+    // and registers the schemas and channels it defines. Returns whether it
+    // only holds messages that are kept.
+    std::vector<mcap::MessageIndex> message_indexes;
+    std::unordered_map<mcap::ChannelId, size_t> index_positions;
+    auto index_chunk = [&](const mcap::PrefetchedChunk& prefetched) -> bool
+    {
+        message_indexes.clear();
+        index_positions.clear();
+        bool all_kept = true;
+        mcap::BufferReader records;
+        records.reset(prefetched.uncompressedRecords, prefetched.uncompressedSize,
+                      prefetched.uncompressedSize);
+        mcap::RecordReader record_reader(records, 0, prefetched.uncompressedSize);
+        for(auto record = record_reader.next(); record && status.ok();
+            record = record_reader.next())
+        {
+            if(record->opcode == mcap::OpCode::Schema || record->opcode == mcap::OpCode::Channel)
+            {
+                status = add_record(*record);
+            }
+            else if(record->opcode == mcap::OpCode::Message)
+            {
+                mcap::Message msg;
+                status = mcap::McapReader::ParseMessage(*record, &msg);
+                if(!status.ok())
+                {
+                    break;
+                }
+                auto [it, inserted] = index_positions.emplace(msg.channelId,
+                                                              message_indexes.size());
+                if(inserted)
+                {
+                    message_indexes.emplace_back().channelId = msg.channelId;
+                }
+                message_indexes[it->second].records.emplace_back(
+                    msg.logTime, record_reader.curRecordOffset());
+                all_kept = all_kept && selection.keeps(msg.channelId);
+            }
+        }
+        if(status.ok())
+        {
+            status = record_reader.status();
+        }
+        return all_kept;
+    };
+
+    auto copy_chunk = [&](const mcap::ChunkPrefetcher::Request& request)
+    {
+        auto prefetched = prefetcher.take(request);
+        status = prefetched->status;
+        const bool all_kept = status.ok() && index_chunk(*prefetched);
+        if(!status.ok() || message_indexes.empty())
+        {
+            prefetcher.recycle(std::move(prefetched));
+            return;
+        }
+
+        const auto& chunk = prefetched->chunk;
+        const auto compression = mcap::McapReader::ParseCompression(chunk.compression);
+        if(all_kept && chunk.messageStartTime >= start_time && chunk.messageEndTime < end_time &&
+           (compression == plan_.compression || plan_.keep_chunk_compression))
+        {
+            uint64_t messages = 0;
+            for(const auto& message_index: message_indexes)
+            {
+                messages += message_index.records.size();
+            }
+            StageTimer timer(stats_, Stage::Write, chunk.uncompressedSize, messages);
+            status = writer.copyChunk(chunk, message_indexes);
+        }
+        else {
+            mcap::Chunk uncompressed = chunk;
+            uncompressed.records = prefetched->uncompressedRecords;
+            uncompressed.compressedSize = prefetched->uncompressedSize;
+            uncompressed.uncompressedSize = prefetched->uncompressedSize;
+            chunk_reader.reset(uncompressed, mcap::Compression::None);
+            if(status.ok())
+            {
+                status = chunk_reader.status();
+            }
+            while(status.ok() && !cancel_requested_ && chunk_reader.next())
+            {
+                if(!chunk_reader.status().ok())
+                {
+                    status = chunk_reader.status();
+                }
+            }
+        }
+        prefetcher.recycle(std::move(prefetched));
+    };
+
+    if(!chunk_indexes.empty())
+    {
+        for(const auto& request: requests)
+        {
+            if(!status.ok() || cancel_requested_)
+            {
+                break;
+            }
+            reportProgress(request.chunkStartOffset, file_size);
+            copy_chunk(request);
+        }
+        return status;
+    }
+
+    size_t next_chunk = 0;
+    for(uint64_t offset = data_start;
+        status.ok() && !cancel_requested_ && offset < data_end &&
+        record_header(offset, opcode, length) &&
+        opcode != mcap::OpCode::DataEnd && opcode != mcap::OpCode::Footer;
+        offset += 9 + length)
+    {
+        reportProgress(offset, file_size);
+        if(opcode == mcap::OpCode::Schema || opcode == mcap::OpCode::Channel ||
+           opcode == mcap::OpCode::Message)
+        {
+            // Top level records, of unchunked files
+            mcap::Record record;
+            status = mcap::McapReader::ReadRecord(source, offset, &record);
+            if(status.ok() && opcode == mcap::OpCode::Message)
+            {
+                mcap::Message msg;
+                status = mcap::McapReader::ParseMessage(record, &msg);
+                if(status.ok())
+                {
+                    write_message(msg);
+                }
+            }
+            else if(status.ok())
+            {
+                status = add_record(record);
+            }
+        }
+        else if(opcode == mcap::OpCode::Chunk)
+        {
+            copy_chunk(requests[next_chunk++]);
+        }
+        // Attachments and metadata were copied first, indexes of the source
+        // are rebuilt
+    }
+    return status;
+}
+
+mcap::Status Exporter::copyAttachments(mcap::McapReader& reader,
+                                       const std::vector<AttachmentRecord>& records,
+                                       mcap::McapWriter& writer)
+{
+    // Read in order, as a part of the sequential pass over the input
+    auto& source = *reader.dataSource();
+    for(const auto& record: records)
+    {
+        if(cancel_requested_)
+        {
+            break;
+        }
+        reportProgress(record.offset, source.size());
+        auto status = copyAttachmentRecord(source, record, plan_, writer, stats_);
+        if(!status.ok())
+        {
+            return status;
+        }
+    }
+    return {};
+}
+
+}  // namespace mcap_editor
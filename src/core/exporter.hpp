@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include "attachments.hpp"
+#include "edit_plan.hpp"
+#include "pipeline_stats.hpp"
+#include "summary_cache.hpp"
+
+namespace mcap_editor
+{
+
+// Executes an EditPlan: reads the input file and writes the messages and
+// attachments that the plan keeps, and the metadata. No GUI involved, run()
+// can be called from any thread.
+class Exporter
+{
+public:
+    // Bytes of the input file processed so far, and its size
+    using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
+
+    explicit Exporter(EditPlan plan);
+
+    const EditPlan& plan() const { return plan_; }
+
+    // Called by run(), on the thread executing it
+    void setProgressCallback(ProgressCallback callback);
+
+    // Thread safe: can be called while run() is executing in another thread.
+    // The output is closed and valid, but incomplete.
+    void cancel();
+
+    bool canceled() const;
+
+    // Counters and timers of the last run(). Read them once run() returned,
+    // or from the progress callback.
+    const PipelineStats& stats() const { return stats_; }
+
+    // Where the summary of an input file without one is looked up, so that
+    // only its chunks in the time range are read
+    void setSummaryCache(std::optional<SummaryCache> cache) { summary_cache_ = std::move(cache); }
+
+    // Keep the timing of every chunk, see PipelineStats::writeChromeTrace
+    void setTracing(bool enabled) { stats_.setTracing(enabled); }
+
+    // Reads plan().input_file and writes plan().output_file
+    mcap::Status run();
+
+    // Same, but input and output replace the files of the plan
+    mcap::Status run(mcap::IReadable& input, mcap::IWritable& output);
+
+private:
+    EditPlan plan_;
+    ProgressCallback progress_callback_;
+    std::atomic_bool cancel_requested_ = false;
+    PipelineStats stats_;
+    std::optional<SummaryCache> summary_cache_;
+
+    mcap::McapWriterOptions writerOptions(mcap::McapReader& reader);
+
+    mcap::Status exportFile(mcap::McapReader& reader, mcap::McapWriter& writer);
+    mcap::Status copyMessages(mcap::McapReader& reader, mcap::McapWriter& writer);
+    mcap::Status copyChunks(mcap::McapReader& reader, mcap::McapWriter& writer);
+    mcap::Status reindexChunks(mcap::McapReader& reader, mcap::McapWriter& writer);
+
+    // Attachments and metadata listed by listAttachments()
+    mcap::Status copyAttachments(mcap::McapReader& reader,
+                                 const std::vector<AttachmentRecord>& records,
+                                 mcap::McapWriter& writer);
+
+    void reportProgress(uint64_t done, uint64_t total);
+};
+
+}  // namespace mcap_editor
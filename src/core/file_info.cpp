@@ -0,0 +1,211 @@
+#include "file_info.hpp"
+#include "channel_selection.hpp"
+
+#include <algorithm>
+
+namespace mcap_editor
+{
+
+mcap::Status openFile(mcap::McapReader& reader, MmapReader& mmap_reader,
+                      const std::string& filename,
+                      MmapReader::AccessPattern pattern)
+{
+    if(mmap_reader.open(filename).ok())
+    {
+        mmap_reader.advise(pattern);
+        return reader.open(mmap_reader);
+    }
+    return reader.open(filename);
+}
+
+mcap::Status readFileInfo(mcap::McapReader& reader, FileInfo& info,
+                          unsigned scan_threads,
+                          const SummaryCache* cache,
+                          const std::string& filename)
+{
+    info = {};
+    if(const auto& header = reader.header())
+    {
+        info.profile = header->profile;
+    }
+
+    // Without summary section, the file is scanned, unless it was already
+    auto status = reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+    const bool use_cache = cache && !filename.empty();
+    if(!status.ok() && use_cache)
+    {
+        status = cache->load(filename, reader);
+    }
+    if(!status.ok())
+    {
+        // The scan reads the whole data section in order (each thread its own
+        // part): the kernel has to read ahead, whatever the caller advised for
+        // reading the file once the summary is known
+        auto* mapping = dynamic_cast<MmapReader*>(reader.dataSource());
+        const auto pattern = mapping ? mapping->accessPattern() : MmapReader::AccessPattern::Normal;
+        if(mapping)
+        {
+            mapping->advise(MmapReader::AccessPattern::Sequential);
+        }
+        reader.setScanThreads(scan_threads);
+        status = reader.readSummary(mcap::ReadSummaryMethod::ForceScan);
+        if(mapping)
+        {
+            mapping->advise(pattern);
+        }
+        if(!status.ok())
+        {
+            return status;
+        }
+        if(use_cache)
+        {
+            // Not worth failing for: the file is scanned again next time
+            (void)cache->save(filename, reader);
+        }
+    }
+
+    const auto& stats_pt = reader.statistics();
+    if (!stats_pt)
+    {
+        return {mcap::StatusCode::MissingStatistics, "Can't read file statistics"};
+    }
+    const auto& statistics = stats_pt.value();
+    info.start_time = statistics.messageStartTime;
+    info.end_time = statistics.messageEndTime;
+
+    for (const auto& [channel_id, channel] : reader.channels())
+    {
+        TopicInfo topic;
+        topic.channel_id = channel_id;
+        topic.topic = channel->topic;
+        topic.message_encoding = channel->messageEncoding;
+        if(const auto schema = reader.schema(channel->schemaId))
+        {
+            topic.schema_name = schema->name;
+            topic.schema_encoding = schema->encoding;
+            topic.schema_text.assign(reinterpret_cast<const char*>(schema->data.data()),
+                                     schema->data.size());
+        }
+        auto it = statistics.channelMessageCounts.find(channel_id);
+        if( it != statistics.channelMessageCounts.end())
+        {
+            topic.message_count = it->second;
+        }
+        info.topics.push_back(std::move(topic));
+    }
+    std::sort(info.topics.begin(), info.topics.end(),
+              [](const TopicInfo& a, const TopicInfo& b) { return a.channel_id < b.channel_id; });
+
+    std::vector<const mcap::AttachmentIndex*> attachment_indexes;
+    for(const auto& [name, index]: reader.attachmentIndexes())
+    {
+        attachment_indexes.push_back(&index);
+    }
+    std::sort(attachment_indexes.begin(), attachment_indexes.end(),
+              [](const mcap::AttachmentIndex* a, const mcap::AttachmentIndex* b)
+              { return a->offset < b->offset; });
+    for(const auto* index: attachment_indexes)
+    {
+        info.attachments.push_back({index->name, index->mediaType, index->logTime,
+                                    index->dataSize});
+    }
+    info.metadata_count = reader.metadataIndexes().size();
+    return status;
+}
+
+uint64_t estimateOutputSize(mcap::McapReader& reader, const EditPlan& plan)
+{
+    // Header, summary offsets and footer
+    constexpr uint64_t FIXED_OVERHEAD = 4096;
+
+    const uint64_t input_size = reader.dataSource() ? reader.dataSource()->size() : 0;
+    const auto& statistics = reader.statistics();
+    const auto& chunk_indexes = reader.chunkIndexes();
+    if(!statistics || chunk_indexes.empty() || statistics->messageCount == 0)
+    {
+        return input_size + FIXED_OVERHEAD;
+    }
+
+    ChannelSelection selection(plan);
+    uint64_t kept_messages = 0;
+    for(const auto& [channel_id, channel]: reader.channels())
+    {
+        if(selection.add(*channel))
+        {
+            auto it = statistics->channelMessageCounts.find(channel_id);
+            if(it != statistics->channelMessageCounts.end())
+            {
+                kept_messages += it->second;
+            }
+        }
+    }
+    const double kept_fraction = double(kept_messages) / double(statistics->messageCount);
+
+    double estimate = 0;
+    for(const auto& index: chunk_indexes)
+    {
+        if(index.messageEndTime < plan.start_time || index.messageStartTime >= plan.end_time)
+        {
+            continue;
+        }
+        bool has_kept = index.messageIndexOffsets.empty();
+        bool has_dropped = index.messageIndexOffsets.empty();
+        for(const auto& [channel_id, offset]: index.messageIndexOffsets)
+        {
+            (selection.keeps(channel_id) ? has_kept : has_dropped) = true;
+        }
+        if(!has_kept)
+        {
+            continue;
+        }
+        // The ratio of another compression is unknown: assume the same one
+        double chunk_size = double(plan.compression == mcap::Compression::None ?
+                                       index.uncompressedSize : index.compressedSize) +
+                            double(index.messageIndexLength);
+        if(has_dropped)
+        {
+            chunk_size *= kept_fraction;
+        }
+        const uint64_t span = index.messageEndTime - index.messageStartTime;
+        if(span > 0 && (index.messageStartTime < plan.start_time ||
+                        index.messageEndTime >= plan.end_time))
+        {
+            const uint64_t first = std::max(index.messageStartTime, plan.start_time);
+            const uint64_t last = std::min(index.messageEndTime, plan.end_time);
+            chunk_size *= double(last - first) / double(span);
+        }
+        estimate += chunk_size;
+    }
+
+    // Attachments and metadata are copied as they are
+    for(const auto& [name, index]: reader.attachmentIndexes())
+    {
+        if(plan.keepsAttachment(name))
+        {
+            estimate += double(index.length);
+        }
+    }
+    for(const auto& [name, index]: reader.metadataIndexes())
+    {
+        estimate += double(index.length);
+    }
+
+    // The summary is at most as large as the one of the input
+    const auto& footer = reader.footer();
+    if(footer && footer->summaryStart != 0 && footer->summaryStart < input_size)
+    {
+        estimate += double(input_size - footer->summaryStart);
+    }
+    return uint64_t(estimate) + FIXED_OVERHEAD;
+}
+
+bool hasMessageIndexes(mcap::McapReader& reader)
+{
+    const auto& chunk_indexes = reader.chunkIndexes();
+    return !chunk_indexes.empty() &&
+           std::all_of(chunk_indexes.begin(), chunk_indexes.end(),
+                       [](const mcap::ChunkIndex& chunk_index)
+                       { return chunk_index.messageIndexLength > 0; });
+}
+
+}  // namespace mcap_editor
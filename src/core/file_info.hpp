@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <string>
+#include <vector>
+
+#include "edit_plan.hpp"
+#include "mmap_reader.hpp"
+#include "summary_cache.hpp"
+
+namespace mcap_editor
+{
+
+struct TopicInfo
+{
+    mcap::ChannelId channel_id = 0;
+    std::string topic;
+    std::string message_encoding;
+    // Empty when the channel has no schema
+    std::string schema_name;
+    std::string schema_encoding;
+    std::string schema_text;
+    uint64_t message_count = 0;
+};
+
+struct AttachmentInfo
+{
+    std::string name;
+    std::string media_type;
+    mcap::Timestamp log_time = 0;
+    uint64_t data_size = 0;
+};
+
+// What the editor shows about a file before it is edited
+struct FileInfo
+{
+    std::string profile;
+    mcap::Timestamp start_time = 0;
+    mcap::Timestamp end_time = 0;
+    // One per channel, ordered by channel id
+    std::vector<TopicInfo> topics;
+    // In the order of the file. Several can have the same name.
+    std::vector<AttachmentInfo> attachments;
+    size_t metadata_count = 0;
+};
+
+// Opens filename through mmap_reader, or with a plain mcap::FileReader where
+// the file can't be mapped.
+mcap::Status openFile(mcap::McapReader& reader, MmapReader& mmap_reader,
+                      const std::string& filename,
+                      MmapReader::AccessPattern pattern);
+
+// Reads the summary section, or scans the whole file when there is none. A
+// scan of a file opened through an MmapReader is made with the Sequential
+// access pattern, and the one advised before restored after it.
+// With scan_threads > 1, the scan is split between that many threads (see
+// mcap::McapReader::setScanThreads). With a cache, the result of the scan of
+// filename (the file that reader opened) is saved, and loaded instead of
+// scanning it again the next time.
+mcap::Status readFileInfo(mcap::McapReader& reader, FileInfo& info,
+                          unsigned scan_threads = 0,
+                          const SummaryCache* cache = nullptr,
+                          const std::string& filename = {});
+
+// Size of the file that plan would write, from the statistics and the chunk
+// indexes of the summary (already read). Used to allocate in-memory outputs
+// up front; it is exact for copied chunks, and approximate for the others.
+// Without summary, it is the size of the input.
+uint64_t estimateOutputSize(mcap::McapReader& reader, const EditPlan& plan);
+
+// Whether the summary (already read) lists chunks and all of them have
+// message indexes. mcap::McapReader reads in log time order only the chunks
+// that have some, and silently skips the others.
+bool hasMessageIndexes(mcap::McapReader& reader);
+
+}  // namespace mcap_editor
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <mcap/internal.hpp>
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include "pipeline_stats.hpp"
+
+namespace mcap_editor
+{
+
+// Reads and writes of record headers are counted, but would flood the trace
+constexpr uint64_t MIN_TRACED_IO_BYTES = 4096;
+
+// Forwards to another IReadable, timing Stage::Read
+class MeasuredReader: public mcap::IReadable {
+public:
+
+    MeasuredReader(mcap::IReadable& source, PipelineStats& stats) :
+        source_(source), stats_(stats) {}
+
+    uint64_t size() const override { return source_.size(); }
+
+    uint64_t read(std::byte** output, uint64_t offset, uint64_t size) override
+    {
+        const uint64_t start_ns = mcap::internal::SteadyClockNs();
+        const uint64_t bytes_read = source_.read(output, offset, size);
+        stats_.add(Stage::Read, start_ns, mcap::internal::SteadyClockNs() - start_ns,
+                   bytes_read, 0, bytes_read >= MIN_TRACED_IO_BYTES);
+        return bytes_read;
+    }
+
+    bool stablePointers() const override { return source_.stablePointers(); }
+
+    void willRead(const std::vector<mcap::ByteRange>& ranges) override
+    {
+        source_.willRead(ranges);
+    }
+
+private:
+    mcap::IReadable& source_;
+    PipelineStats& stats_;
+};
+
+// Forwards to another IWritable, timing Stage::Sink.
+// The CRC, if enabled, is computed here and not by the destination.
+class MeasuredWriter: public mcap::IWritable {
+public:
+
+    MeasuredWriter(mcap::IWritable& destination, PipelineStats& stats) :
+        destination_(destination), stats_(stats) {}
+
+    void end() override
+    {
+        StageTimer timer(stats_, Stage::Sink, 0, 0);
+        destination_.end();
+    }
+
+    uint64_t size() const override { return destination_.size(); }
+
+protected:
+    void handleWrite(const std::byte* data, uint64_t size) override
+    {
+        StageTimer timer(stats_, Stage::Sink, size, 0, size >= MIN_TRACED_IO_BYTES);
+        destination_.write(data, size);
+    }
+
+private:
+    mcap::IWritable& destination_;
+    PipelineStats& stats_;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,305 @@
+#include "merger.hpp"
+#include "attachments.hpp"
+#include "channel_selection.hpp"
+#include "chunk_groups.hpp"
+#include "measured_io.hpp"
+#include "message_copy.hpp"
+#include "plan_io.hpp"
+
+#include <filesystem>
+#include <memory>
+#include <queue>
+
+namespace mcap_editor
+{
+
+namespace
+{
+// time + offset, or time - offset when backwards, without wrapping around
+mcap::Timestamp shift(mcap::Timestamp time, int64_t offset, bool backwards = false)
+{
+    // Also right for the smallest int64_t
+    const uint64_t magnitude = offset < 0 ? 0 - uint64_t(offset) : uint64_t(offset);
+    if((offset < 0) != backwards)
+    {
+        return time > magnitude ? time - magnitude : 0;
+    }
+    return mcap::MaxTime - time > magnitude ? time + magnitude : mcap::MaxTime;
+}
+
+// An input, read as a stream of messages
+struct Source
+{
+    explicit Source(const EditPlan& plan) :
+        selection(plan)
+    {
+    }
+
+    PlanInput input;
+    std::optional<MeasuredReader> measured_reader;
+    mcap::McapReader reader;
+    int64_t clock_offset = 0;
+
+    ChannelSelection selection;
+    // Output channel of each input channel, shared with the other inputs
+    std::optional<ChannelMapping> channels;
+
+    std::optional<mcap::LinearMessageView> messages;
+    std::optional<mcap::LinearMessageView::Iterator> next;
+    // Where the offsets of its messages are, see fileOffset()
+    bool log_time_order = false;
+    // Bytes of the file processed so far
+    uint64_t done = 0;
+};
+
+// The next message of each input, the earliest on top
+struct Next
+{
+    mcap::Timestamp time;
+    size_t source;
+
+    // Inputs are taken in order at equal times
+    bool operator>(const Next& other) const
+    {
+        return time > other.time || (time == other.time && source > other.source);
+    }
+};
+}  // namespace
+
+Merger::Merger(std::vector<MergeInput> inputs, EditPlan plan) :
+    inputs_(std::move(inputs)),
+    plan_(std::move(plan))
+{
+    // Ids of channels of a single input
+    plan_.channels.reset();
+}
+
+void Merger::setProgressCallback(ProgressCallback callback)
+{
+    progress_callback_ = std::move(callback);
+}
+
+void Merger::cancel()
+{
+    cancel_requested_ = true;
+}
+
+bool Merger::canceled() const
+{
+    return cancel_requested_;
+}
+
+void Merger::reportProgress(uint64_t done, uint64_t total)
+{
+    stats_.sampleMemory();
+    if(progress_callback_)
+    {
+        progress_callback_(done, total);
+    }
+}
+
+mcap::Status Merger::run()
+{
+    // Preallocated with write_behind: the inputs together, the output is cut
+    // to its size when closed
+    uint64_t size_hint = 0;
+    if(plan_.write_behind && plan_.write_behind->preallocate)
+    {
+        for(const auto& input: inputs_)
+        {
+            std::error_code error;
+            const auto size = std::filesystem::file_size(input.file, error);
+            size_hint += error ? 0 : uint64_t(size);
+        }
+    }
+    PlanOutput output;
+    auto status = output.open(plan_.output_file, plan_, size_hint);
+    if(!status.ok())
+    {
+        return status;
+    }
+    status = run(output.writable());
+    // Errors of the writes in flight are only known once the file is closed
+    return status.ok() ? output.status() : status;
+}
+
+mcap::Status Merger::run(mcap::IWritable& output)
+{
+    if(inputs_.empty())
+    {
+        return {mcap::StatusCode::OpenFailed, "no file to merge"};
+    }
+
+    std::vector<std::unique_ptr<Source>> sources;
+    uint64_t total_size = 0;
+    for(const auto& input: inputs_)
+    {
+        auto& source = *sources.emplace_back(std::make_unique<Source>(plan_));
+        source.clock_offset = input.clock_offset;
+        // Opened without reading it
+        auto status = source.input.open(input.file, plan_);
+        if(!status.ok())
+        {
+            return status;
+        }
+        total_size += source.input.readable().size();
+    }
+
+    stats_.start(total_size);
+    MeasuredWriter measured_output(output, stats_);
+    std::string profile;
+    for(size_t i = 0; i < sources.size(); i++)
+    {
+        auto& source = *sources[i];
+        auto status = source.reader.open(
+            source.measured_reader.emplace(source.input.readable(), stats_));
+        if(!status.ok())
+        {
+            return {status.code, inputs_[i].file + ": " + status.message};
+        }
+        if(profile.empty() && source.reader.header())
+        {
+            profile = source.reader.header()->profile;
+        }
+    }
+
+    mcap::McapWriterOptions options(profile);
+    options.compression = plan_.compression;
+    options.compressionLevel = plan_.compression_level;
+    options.chunkSize = plan_.chunk_size;
+    options.compressionThreads = plan_.compression_threads;
+    options.onChunkCompressed = [this](const mcap::ChunkCodecTiming& timing)
+    {
+        stats_.add(Stage::Compress, timing.startTime, timing.duration, timing.uncompressedSize, 0);
+    };
+    mcap::McapWriter writer;
+    writer.open(measured_output, options);
+
+    // Without the message indexes of each input, grouping only looks at the schemas
+    std::optional<ChunkGroupAssigner> groups;
+    if(plan_.chunk_grouping.enabled())
+    {
+        groups.emplace(plan_, TopicStatsMap());
+    }
+
+    // Schemas and channels with the same content are written once
+    SharedChannelIds shared_ids;
+    for(auto& source: sources)
+    {
+        source->channels.emplace(writer, groups ? &*groups : nullptr, &shared_ids);
+    }
+
+    mcap::ProblemCallback problem = [](const mcap::Status&) {};
+    std::priority_queue<Next, std::vector<Next>, std::greater<Next>> heap;
+    mcap::Status status;
+    std::vector<AttachmentRecord> attachments;
+    for(size_t i = 0; i < sources.size() && status.ok() && !cancel_requested_; i++)
+    {
+        auto& source = *sources[i];
+        bool has_summary =
+            source.reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan, problem).ok();
+        if(!has_summary && summary_cache_)
+        {
+            has_summary = summary_cache_->load(inputs_[i].file, source.reader).ok();
+        }
+
+        // Attachments and metadata of each input, in the order of the inputs,
+        // before its messages are read. Progress only counts the messages.
+        status = listAttachments(source.reader, has_summary, plan_, attachments);
+        for(size_t j = 0; status.ok() && !cancel_requested_ && j < attachments.size(); j++)
+        {
+            status = copyAttachmentRecord(*source.reader.dataSource(), attachments[j], plan_,
+                                          writer, stats_);
+        }
+        if(!status.ok())
+        {
+            status = {status.code, inputs_[i].file + ": " + status.message};
+            break;
+        }
+
+        // In the order of the inputs
+        source.channels->addChannels(source.reader, source.selection);
+
+        // The time range, in the clock of the input
+        const auto start_time = shift(plan_.start_time, source.clock_offset, true);
+        const auto end_time = plan_.end_time == mcap::MaxTime ?
+                                  mcap::MaxTime :
+                                  shift(plan_.end_time, source.clock_offset, true);
+        if(start_time >= end_time)
+        {
+            continue;
+        }
+        // The heap needs each input in log time order: read so when it has all
+        // of its message indexes, in file order otherwise. The inputs share the
+        // read-ahead.
+        auto read_options = readMessageOptions(plan_, source.reader, has_summary,
+                                               source.selection, stats_, sources.size());
+        read_options.startTime = start_time;
+        read_options.endTime = end_time;
+        source.log_time_order = readsInLogTimeOrder(read_options);
+
+        source.messages.emplace(source.reader.readMessages(problem, read_options));
+        source.next.emplace(source.messages->begin());
+        if(*source.next != source.messages->end())
+        {
+            heap.push({shift((*source.next)->message.logTime, source.clock_offset), i});
+        }
+    }
+
+    uint64_t done = 0;
+    while(!heap.empty() && !cancel_requested_ && status.ok())
+    {
+        const Next next = heap.top();
+        heap.pop();
+        auto& source = *sources[next.source];
+        auto& it = *source.next;
+        {
+            const auto& msg = *it;
+            const auto new_channel_id = source.channels->outputId(*msg.channel, msg.schema);
+            {
+                StageTimer timer(stats_, Stage::Write, msg.message.dataSize, 1, false);
+                if(source.clock_offset == 0)
+                {
+                    status = writer.write(msg, new_channel_id);
+                }
+                else {
+                    // Only the header changes, the payload is not copied
+                    mcap::Message message = msg.message;
+                    message.channelId = new_channel_id;
+                    message.logTime = next.time;
+                    message.publishTime = shift(message.publishTime, source.clock_offset);
+                    status = writer.write(message);
+                }
+            }
+            if(!status.ok())
+            {
+                break;
+            }
+
+            // Chunks are not read in file order, progress only moves forward
+            const uint64_t position = fileOffset(msg, source.log_time_order);
+            if(position > source.done)
+            {
+                done += position - source.done;
+                source.done = position;
+            }
+        }
+        reportProgress(done, total_size);
+
+        ++it;
+        if(it != source.messages->end())
+        {
+            heap.push({shift(it->message.logTime, source.clock_offset), next.source});
+        }
+    }
+
+    {
+        // Writes the last chunks and the summary
+        StageTimer timer(stats_, Stage::Write, 0, 0);
+        writer.close();
+    }
+    stats_.finish();
+    return status;
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include "edit_plan.hpp"
+#include "pipeline_stats.hpp"
+#include "summary_cache.hpp"
+
+namespace mcap_editor
+{
+
+// One of the files merged by Merger
+struct MergeInput
+{
+    std::string file;
+    // Added to the log and publish times of its messages, to correct the
+    // clock of the machine that recorded it (nanoseconds)
+    int64_t clock_offset = 0;
+};
+
+// Merges several MCAP files into one, in log time order: each input is read
+// as a stream, and a heap holding the next message of each gives the one to
+// write. Memory only depends on the number of inputs and the chunks each has
+// in flight, not on their length.
+//
+// Schemas and channels found in several inputs with the same content are
+// written once, and their messages share the channel. The attachments and
+// metadata of every input are copied, in the order of the inputs.
+class Merger
+{
+public:
+    // Bytes of the inputs processed so far, and their total size
+    using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
+
+    // plan gives the output file, its compression, and the topics and time
+    // range kept (in the corrected time). Its input file and channel ids,
+    // which are those of a single file, are ignored.
+    Merger(std::vector<MergeInput> inputs, EditPlan plan);
+
+    const EditPlan& plan() const { return plan_; }
+    const std::vector<MergeInput>& inputs() const { return inputs_; }
+
+    // Called by run(), on the thread executing it
+    void setProgressCallback(ProgressCallback callback);
+
+    // Thread safe: can be called while run() is executing in another thread.
+    // The output is closed and valid, but incomplete.
+    void cancel();
+
+    bool canceled() const;
+
+    // Counters and timers of the last run(), see Exporter::stats
+    const PipelineStats& stats() const { return stats_; }
+
+    // Where the summary of inputs without one is looked up, so that they can
+    // be read in log time order
+    void setSummaryCache(std::optional<SummaryCache> cache) { summary_cache_ = std::move(cache); }
+
+    void setTracing(bool enabled) { stats_.setTracing(enabled); }
+
+    // Reads the inputs and writes plan().output_file
+    mcap::Status run();
+
+    // Same, but output replaces the file of the plan
+    mcap::Status run(mcap::IWritable& output);
+
+private:
+    std::vector<MergeInput> inputs_;
+    EditPlan plan_;
+    ProgressCallback progress_callback_;
+    std::atomic_bool cancel_requested_ = false;
+    PipelineStats stats_;
+    std::optional<SummaryCache> summary_cache_;
+
+    void reportProgress(uint64_t done, uint64_t total);
+};
+
+}  // namespace mcap_editor
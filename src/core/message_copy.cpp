@@ -0,0 +1,154 @@
+#include "message_copy.hpp"
+#include "file_info.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace mcap_editor
+{
+
+namespace
+{
+// Schemas and channels are the same if these are
+std::string schemaKey(const mcap::Schema& schema)
+{
+    std::string key = schema.name;
+    key += '\0';
+    key += schema.encoding;
+    key += '\0';
+    key.append(reinterpret_cast<const char*>(schema.data.data()), schema.data.size());
+    return key;
+}
+
+std::string channelKey(const mcap::Channel& channel, mcap::SchemaId output_schema_id)
+{
+    std::string key = channel.topic;
+    key += '\0';
+    key += channel.messageEncoding;
+    key += '\0';
+    key += std::to_string(output_schema_id);
+    // In the same order whatever the order of the map
+    std::vector<std::pair<std::string, std::string>> metadata(channel.metadata.begin(),
+                                                              channel.metadata.end());
+    std::sort(metadata.begin(), metadata.end());
+    for(const auto& [name, value]: metadata)
+    {
+        key += '\0';
+        key += name;
+        key += '=';
+        key += value;
+    }
+    return key;
+}
+}  // namespace
+
+ChannelMapping::ChannelMapping(mcap::McapWriter& writer, ChunkGroupAssigner* groups,
+                               SharedChannelIds* shared) :
+    writer_(writer),
+    groups_(groups),
+    shared_(shared),
+    schema_ids_(size_t(std::numeric_limits<mcap::SchemaId>::max()) + 1, 0),
+    channel_ids_(size_t(std::numeric_limits<mcap::ChannelId>::max()) + 1, 0)
+{
+}
+
+mcap::ChannelId ChannelMapping::add(const mcap::Channel& channel, const mcap::SchemaPtr& schema)
+{
+    mcap::SchemaId new_schema_id = 0;
+    if(schema)
+    {
+        auto& schema_id = schema_ids_[schema->id];
+        if(schema_id == 0)
+        {
+            // Added by another input, or to add
+            auto& id = shared_ ? shared_->schemas[schemaKey(*schema)] : schema_id;
+            if(id == 0)
+            {
+                mcap::Schema new_schema(schema->name, schema->encoding, schema->data);
+                writer_.addSchema(new_schema);
+                id = new_schema.id;
+            }
+            schema_id = id;
+        }
+        new_schema_id = schema_id;
+    }
+
+    auto& channel_id = channel_ids_[channel.id];
+    auto& id = shared_ ? shared_->channels[channelKey(channel, new_schema_id)] : channel_id;
+    if(id == 0)
+    {
+        mcap::Channel new_channel(channel.topic, channel.messageEncoding, new_schema_id,
+                                  channel.metadata);
+        writer_.addChannel(new_channel);
+        id = new_channel.id;
+        if(groups_)
+        {
+            groups_->assign(writer_, channel, schema.get(), new_channel.id);
+        }
+    }
+    channel_id = id;
+    return channel_id;
+}
+
+void ChannelMapping::addChannels(mcap::McapReader& reader, ChannelSelection& selection)
+{
+    std::vector<mcap::ChannelId> ids;
+    for(const auto& [channel_id, channel]: reader.channels())
+    {
+        ids.push_back(channel_id);
+    }
+    std::sort(ids.begin(), ids.end());
+    for(const auto id: ids)
+    {
+        const auto channel = reader.channel(id);
+        if(selection.add(*channel))
+        {
+            outputId(*channel, reader.schema(channel->schemaId));
+        }
+    }
+}
+
+mcap::ReadMessageOptions readMessageOptions(const EditPlan& plan, mcap::McapReader& reader,
+                                            bool log_time_order, ChannelSelection& selection,
+                                            PipelineStats& stats, size_t readers)
+{
+    mcap::ReadMessageOptions options(plan.start_time, plan.end_time);
+    options.onChunkDecompressed = [&stats](const mcap::ChunkCodecTiming& timing)
+    {
+        stats.add(Stage::Decompress, timing.startTime, timing.duration,
+                  timing.uncompressedSize, 0);
+    };
+
+    if(log_time_order && hasMessageIndexes(reader))
+    {
+        options.readOrder = mcap::ReadMessageOptions::ReadOrder::LogTimeOrder;
+        if(plan.read_ahead_chunks > 0)
+        {
+            options.readAheadChunks = std::max<size_t>(1, plan.read_ahead_chunks / readers);
+            options.decompressionThreads =
+                plan.decompression_threads == 0 ?
+                    0 :
+                    std::max(1u, unsigned(plan.decompression_threads / readers));
+        }
+    }
+
+    if(plan.topics || plan.channels)
+    {
+        // Called once per channel when reading in log time order, per message otherwise
+        options.channelFilter = [&reader, &selection, &stats](mcap::ChannelId id) -> bool
+        {
+            if(selection.known(id))
+            {
+                return selection.keeps(id);
+            }
+            // Defined in the data section. A missing channel is let through,
+            // for the reader to report it.
+            StageTimer timer(stats, Stage::Filter, 0, 0, false);
+            auto channel = reader.channel(id);
+            return !channel || selection.add(*channel);
+        };
+    }
+    return options;
+}
+
+}  // namespace mcap_editor
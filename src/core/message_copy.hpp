@@ -0,0 +1,95 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "channel_selection.hpp"
+#include "chunk_groups.hpp"
+#include "edit_plan.hpp"
+#include "pipeline_stats.hpp"
+
+namespace mcap_editor
+{
+
+// Output ids of the schemas and channels written, by content, for several
+// inputs to share them (see Merger)
+struct SharedChannelIds
+{
+    std::unordered_map<std::string, mcap::SchemaId> schemas;
+    std::unordered_map<std::string, mcap::ChannelId> channels;
+};
+
+// The schemas and channels of an input file added to an output, which gives
+// them new ids, as the messages of the input are written to it. Ids are
+// looked up in arrays indexed by the input id, 0 meaning not added yet.
+class ChannelMapping
+{
+public:
+    // With groups, each channel is assigned to its chunk group when added.
+    // With shared, the schemas and channels with the same content as one
+    // already added by another mapping of writer are written once.
+    explicit ChannelMapping(mcap::McapWriter& writer, ChunkGroupAssigner* groups = nullptr,
+                            SharedChannelIds* shared = nullptr);
+
+    ChannelMapping(const ChannelMapping&) = delete;
+    ChannelMapping& operator=(const ChannelMapping&) = delete;
+
+    // Output id of channel, added with its schema the first time
+    mcap::ChannelId outputId(const mcap::Channel& channel, const mcap::SchemaPtr& schema)
+    {
+        const auto id = channel_ids_[channel.id];
+        return id != 0 ? id : add(channel, schema);
+    }
+
+    bool hasChannel(mcap::ChannelId id) const { return channel_ids_[id] != 0; }
+    bool hasSchema(mcap::SchemaId id) const { return schema_ids_[id] != 0; }
+
+    // Adds the channels listed in the summary of reader (already read) that
+    // selection keeps, in the order of their ids: they are written even if
+    // none of their messages are. Files without a summary only reveal their
+    // channels while they are read.
+    void addChannels(mcap::McapReader& reader, ChannelSelection& selection);
+
+private:
+    mcap::McapWriter& writer_;
+    ChunkGroupAssigner* groups_;
+    SharedChannelIds* shared_;
+    std::vector<mcap::SchemaId> schema_ids_;
+    std::vector<mcap::ChannelId> channel_ids_;
+
+    mcap::ChannelId add(const mcap::Channel& channel, const mcap::SchemaPtr& schema);
+};
+
+// How Exporter, Splitter and Merger read the messages of the file that reader
+// opened: in the time range of plan, and only the channels that selection
+// keeps, each decided once (the channels defined in the data section when
+// first seen). Decompression is timed in stats.
+//
+// With log_time_order, the messages come in log time order, and the next
+// chunks are decompressed ahead on other threads as plan asks. That needs
+// the message indexes of every chunk listed in the summary (already read):
+// the indexed reader skips the chunks without any. Otherwise, the messages
+// come in the order of the file, without read-ahead. readers is the number
+// of inputs read at the same time, which share the read-ahead of plan.
+mcap::ReadMessageOptions readMessageOptions(const EditPlan& plan, mcap::McapReader& reader,
+                                            bool log_time_order, ChannelSelection& selection,
+                                            PipelineStats& stats, size_t readers = 1);
+
+inline bool readsInLogTimeOrder(const mcap::ReadMessageOptions& options)
+{
+    return options.readOrder == mcap::ReadMessageOptions::ReadOrder::LogTimeOrder;
+}
+
+// Where msg was read in the file, for progress. In log time order, offset
+// is within the decompressed chunk and chunkOffset the chunk's; in file
+// order, offset is already in the file.
+inline uint64_t fileOffset(const mcap::MessageView& msg, bool log_time_order)
+{
+    const auto& offset = msg.messageOffset;
+    return log_time_order ? offset.chunkOffset.value_or(offset.offset) : offset.offset;
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,96 @@
+#include "mmap_reader.hpp"
+
+#include <algorithm>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define MMAP_READER_SUPPORTED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mcap_editor
+{
+
+MmapReader::~MmapReader()
+{
+    close();
+}
+
+mcap::Status MmapReader::open(const std::string& filename)
+{
+    close();
+#ifdef MMAP_READER_SUPPORTED
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    struct stat file_stat;
+    if(::fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        return {mcap::StatusCode::OpenFailed, "can't map \"" + filename + "\""};
+    }
+    void* data = ::mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if(data == MAP_FAILED)
+    {
+        return {mcap::StatusCode::OpenFailed, "can't map \"" + filename + "\""};
+    }
+    data_ = static_cast<std::byte*>(data);
+    size_ = uint64_t(file_stat.st_size);
+    return mcap::StatusCode::Success;
+#else
+    (void)filename;
+    return {mcap::StatusCode::OpenFailed, "memory mapped files are not supported"};
+#endif
+}
+
+void MmapReader::close()
+{
+#ifdef MMAP_READER_SUPPORTED
+    if(data_)
+    {
+        ::munmap(data_, size_t(size_));
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    pattern_ = AccessPattern::Normal;
+}
+
+void MmapReader::advise(AccessPattern pattern)
+{
+#ifdef MMAP_READER_SUPPORTED
+    if(!data_)
+    {
+        return;
+    }
+    pattern_ = pattern;
+    int advice = MADV_NORMAL;
+    switch(pattern)
+    {
+    case AccessPattern::Normal: advice = MADV_NORMAL; break;
+    case AccessPattern::Sequential: advice = MADV_SEQUENTIAL; break;
+    case AccessPattern::Random: advice = MADV_RANDOM; break;
+    }
+    ::madvise(data_, size_t(size_), advice);
+#else
+    (void)pattern;
+#endif
+}
+
+uint64_t MmapReader::read(std::byte** output, uint64_t offset, uint64_t size)
+{
+    if(!data_ || offset >= size_)
+    {
+        return 0;
+    }
+    *output = data_ + offset;
+    return std::min(size, size_ - offset);
+}
+
+}  // namespace mcap_editor
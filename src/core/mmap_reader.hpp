@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <string>
+
+namespace mcap_editor
+{
+
+// IReadable backed by a read-only memory mapping of the whole file.
+// read() returns pointers into the mapping: nothing is copied, and the pointers
+// stay valid until the reader is closed, so the mcap readers can use the
+// records in place.
+class MmapReader: public mcap::IReadable {
+public:
+
+    enum class AccessPattern
+    {
+        Normal,
+        Sequential,
+        Random
+    };
+
+    MmapReader() = default;
+    ~MmapReader() override;
+
+    MmapReader(const MmapReader&) = delete;
+    MmapReader& operator=(const MmapReader&) = delete;
+
+    // Fails where mmap is not available, or if the file can't be mapped.
+    // Use mcap::FileReader in that case.
+    mcap::Status open(const std::string& filename);
+
+    void close();
+
+    // Tells the kernel how the mapping is going to be read (madvise)
+    void advise(AccessPattern pattern);
+
+    // The last one advised
+    AccessPattern accessPattern() const { return pattern_; }
+
+    uint64_t size() const override { return size_; }
+
+    uint64_t read(std::byte** output, uint64_t offset, uint64_t size) override;
+
+    bool stablePointers() const override { return true; }
+
+private:
+    std::byte* data_ = nullptr;
+    uint64_t size_ = 0;
+    AccessPattern pattern_ = AccessPattern::Normal;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,268 @@
+#include "pipeline_stats.hpp"
+
+#include <mcap/internal.hpp>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+namespace mcap_editor
+{
+
+namespace
+{
+// Enough for a long export, without letting the trace grow without bound
+constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+constexpr uint64_t MEMORY_SAMPLE_INTERVAL_NS = 10'000'000;
+
+uint32_t traceThreadId()
+{
+    static std::atomic<uint32_t> next_id = 1;
+    thread_local const uint32_t id = next_id++;
+    return id;
+}
+
+// Memory of the process that is not backed by a file: the memory mapped
+// input file doesn't count, the buffers do.
+uint64_t anonymousMemory()
+{
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0, shared = 0;
+    if(statm >> size >> resident >> shared && resident >= shared)
+    {
+        return (resident - shared) * uint64_t(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+double seconds(uint64_t nanoseconds)
+{
+    return double(nanoseconds) * 1e-9;
+}
+
+double megabytes(uint64_t bytes)
+{
+    return double(bytes) * 1e-6;
+}
+}  // namespace
+
+const char* stageName(Stage stage)
+{
+    switch(stage)
+    {
+    case Stage::Read: return "read";
+    case Stage::Decompress: return "decompress";
+    case Stage::Filter: return "filter";
+    case Stage::Write: return "write";
+    case Stage::Compress: return "compress";
+    case Stage::Sink: return "sink";
+    }
+    return "unknown";
+}
+
+void PipelineStats::start(uint64_t input_size)
+{
+    for(auto& counters: counters_)
+    {
+        counters.calls = 0;
+        counters.nanoseconds = 0;
+        counters.bytes = 0;
+        counters.messages = 0;
+    }
+    nested_compress_ns_ = 0;
+    export_thread_ = std::this_thread::get_id();
+    input_size_ = input_size;
+    start_ns_ = mcap::internal::SteadyClockNs();
+    finish_ns_ = 0;
+    base_memory_ = anonymousMemory();
+    peak_memory_ = base_memory_;
+    last_memory_sample_ns_ = start_ns_;
+
+    std::lock_guard<std::mutex> lock(trace_mutex_);
+    trace_.clear();
+    dropped_events_ = 0;
+}
+
+void PipelineStats::finish()
+{
+    sampleMemory();
+    finish_ns_ = mcap::internal::SteadyClockNs();
+}
+
+void PipelineStats::add(Stage stage, uint64_t start_ns, uint64_t duration_ns,
+                        uint64_t bytes, uint64_t messages, bool trace)
+{
+    auto& counters = counters_[size_t(stage)];
+    counters.calls.fetch_add(1, std::memory_order_relaxed);
+    counters.nanoseconds.fetch_add(duration_ns, std::memory_order_relaxed);
+    counters.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    counters.messages.fetch_add(messages, std::memory_order_relaxed);
+    if(stage == Stage::Compress && std::this_thread::get_id() == export_thread_)
+    {
+        nested_compress_ns_.fetch_add(duration_ns, std::memory_order_relaxed);
+    }
+
+    if(tracing_ && trace)
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex_);
+        if(trace_.size() < MAX_TRACE_EVENTS)
+        {
+            trace_.push_back({stage, traceThreadId(), start_ns, duration_ns, bytes, messages});
+        }
+        else {
+            dropped_events_++;
+        }
+    }
+}
+
+void PipelineStats::sampleMemory()
+{
+    const uint64_t now = mcap::internal::SteadyClockNs();
+    uint64_t last = last_memory_sample_ns_;
+    if(now - last < MEMORY_SAMPLE_INTERVAL_NS ||
+       !last_memory_sample_ns_.compare_exchange_strong(last, now))
+    {
+        return;
+    }
+    const uint64_t memory = anonymousMemory();
+    uint64_t peak = peak_memory_;
+    while(memory > peak && !peak_memory_.compare_exchange_weak(peak, memory))
+    {
+    }
+}
+
+PipelineStats::StageTotals PipelineStats::totals(Stage stage) const
+{
+    const auto& counters = counters_[size_t(stage)];
+    StageTotals totals;
+    totals.calls = counters.calls;
+    totals.nanoseconds = counters.nanoseconds;
+    totals.bytes = counters.bytes;
+    totals.messages = counters.messages;
+    return totals;
+}
+
+uint64_t PipelineStats::elapsedNs() const
+{
+    const uint64_t end = finish_ns_ ? finish_ns_ : mcap::internal::SteadyClockNs();
+    return start_ns_ ? end - start_ns_ : 0;
+}
+
+double PipelineStats::readAmplification() const
+{
+    return input_size_ > 0 ? double(totals(Stage::Read).bytes) / double(input_size_) : 0.0;
+}
+
+uint64_t PipelineStats::peakBufferBytes() const
+{
+    const uint64_t peak = peak_memory_;
+    return peak > base_memory_ ? peak - base_memory_ : 0;
+}
+
+std::string PipelineStats::summary() const
+{
+    // The write stage is reported without the work it does in the other stages
+    std::array<uint64_t, STAGE_COUNT> self_ns;
+    for(size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        self_ns[i] = totals(Stage(i)).nanoseconds;
+    }
+    const uint64_t nested = self_ns[size_t(Stage::Sink)] + nested_compress_ns_;
+    auto& write_ns = self_ns[size_t(Stage::Write)];
+    write_ns = write_ns > nested ? write_ns - nested : 0;
+    const auto busiest = std::max_element(self_ns.begin(), self_ns.end()) - self_ns.begin();
+
+    const double elapsed = seconds(elapsedNs());
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "%.1f MB in %.2f s (%.1f MB/s), %" PRIu64 " messages, most time in %s",
+                  megabytes(input_size_), elapsed,
+                  elapsed > 0 ? megabytes(input_size_) / elapsed : 0.0,
+                  totals(Stage::Write).messages, stageName(Stage(busiest)));
+    return line;
+}
+
+std::string PipelineStats::report() const
+{
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-12s %10s %10s %10s %12s\n",
+                  "stage", "calls", "time [s]", "MB/s", "messages/s");
+    text += line;
+
+    const uint64_t nested = totals(Stage::Sink).nanoseconds + nested_compress_ns_;
+    for(size_t i = 0; i < STAGE_COUNT; i++)
+    {
+        const auto stage = Stage(i);
+        auto stage_totals = totals(stage);
+        if(stage == Stage::Write)
+        {
+            stage_totals.nanoseconds =
+                stage_totals.nanoseconds > nested ? stage_totals.nanoseconds - nested : 0;
+        }
+        const double time = seconds(stage_totals.nanoseconds);
+        const double bytes_rate = time > 0 ? megabytes(stage_totals.bytes) / time : 0.0;
+        const double message_rate = time > 0 ? double(stage_totals.messages) / time : 0.0;
+        std::snprintf(line, sizeof(line), "%-12s %10" PRIu64 " %10.3f %10.1f %12.0f\n",
+                      stageName(stage), stage_totals.calls, time, bytes_rate, message_rate);
+        text += line;
+    }
+
+    std::snprintf(line, sizeof(line),
+                  "%s\nread amplification %.2f, peak buffer memory %.1f MB\n",
+                  summary().c_str(), readAmplification(), megabytes(peakBufferBytes()));
+    text += line;
+    return text;
+}
+
+bool PipelineStats::writeChromeTrace(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if(!file)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(trace_mutex_);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char event[256];
+    for(size_t i = 0; i < trace_.size(); i++)
+    {
+        const auto& e = trace_[i];
+        // Complete events, with microsecond timestamps relative to the start of the export
+        const double ts = e.start_ns >= start_ns_ ? double(e.start_ns - start_ns_) * 1e-3 : 0.0;
+        std::snprintf(event, sizeof(event),
+                      "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                      "\"dur\":%.3f,\"args\":{\"bytes\":%" PRIu64 ",\"messages\":%" PRIu64 "}}",
+                      i == 0 ? "" : ",", stageName(e.stage), e.thread, ts,
+                      double(e.duration_ns) * 1e-3, e.bytes, e.messages);
+        file << event;
+    }
+    file << "\n],\"otherData\":{\"droppedEvents\":" << dropped_events_ << "}}\n";
+    return bool(file);
+}
+
+StageTimer::StageTimer(PipelineStats& stats, Stage stage, uint64_t bytes, uint64_t messages,
+                       bool trace) :
+    stats_(stats),
+    stage_(stage),
+    bytes_(bytes),
+    messages_(messages),
+    trace_(trace),
+    start_ns_(mcap::internal::SteadyClockNs())
+{
+}
+
+StageTimer::~StageTimer()
+{
+    stats_.add(stage_, start_ns_, mcap::internal::SteadyClockNs() - start_ns_,
+               bytes_, messages_, trace_);
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mcap_editor
+{
+
+// Steps of the read/filter/write pipeline of an export
+enum class Stage
+{
+    Read,        // IReadable::read of the input
+    Decompress,  // input chunks
+    Filter,      // topic and time selection
+    Write,       // McapWriter calls, including the sink and, without threads, the compression
+    Compress,    // output chunks
+    Sink,        // IWritable of the output
+};
+
+constexpr size_t STAGE_COUNT = 6;
+
+const char* stageName(Stage stage);
+
+// Counters and timers of each Stage. add() is thread safe: stages run on the
+// export thread, and on the compression and decompression threads.
+class PipelineStats
+{
+public:
+    struct StageTotals
+    {
+        uint64_t calls = 0;
+        // Summed over threads, it can be longer than the export
+        uint64_t nanoseconds = 0;
+        uint64_t bytes = 0;
+        uint64_t messages = 0;
+    };
+
+    // Keep every event, to write them with writeChromeTrace()
+    void setTracing(bool enabled) { tracing_ = enabled; }
+
+    // Resets everything. Called by the thread running the export.
+    void start(uint64_t input_size);
+    void finish();
+
+    // start_ns and duration_ns are from the steady clock. Events of the stages that
+    // run once per message should not be traced, only counted.
+    void add(Stage stage, uint64_t start_ns, uint64_t duration_ns,
+             uint64_t bytes, uint64_t messages, bool trace = true);
+
+    // Measures the memory of the process, at most every few milliseconds
+    void sampleMemory();
+
+    StageTotals totals(Stage stage) const;
+
+    uint64_t inputSize() const { return input_size_; }
+    uint64_t elapsedNs() const;
+    // Bytes read from the input, divided by its size
+    double readAmplification() const;
+    // Growth of the heap (anonymous memory) of the process during the export.
+    // Zero where it can't be measured.
+    uint64_t peakBufferBytes() const;
+
+    // One line, for a status bar
+    std::string summary() const;
+    // One line per stage
+    std::string report() const;
+
+    // Chrome trace-event JSON, to open in chrome://tracing or https://ui.perfetto.dev
+    bool writeChromeTrace(const std::string& filename) const;
+
+private:
+    struct Counters
+    {
+        std::atomic<uint64_t> calls = 0;
+        std::atomic<uint64_t> nanoseconds = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> messages = 0;
+    };
+
+    struct TraceEvent
+    {
+        Stage stage;
+        uint32_t thread;
+        uint64_t start_ns;
+        uint64_t duration_ns;
+        uint64_t bytes;
+        uint64_t messages;
+    };
+
+    std::array<Counters, STAGE_COUNT> counters_;
+    // Compression done by the export thread is already counted in Stage::Write
+    std::atomic<uint64_t> nested_compress_ns_ = 0;
+    std::thread::id export_thread_;
+
+    uint64_t input_size_ = 0;
+    uint64_t start_ns_ = 0;
+    uint64_t finish_ns_ = 0;
+
+    std::atomic<uint64_t> last_memory_sample_ns_ = 0;
+    uint64_t base_memory_ = 0;
+    std::atomic<uint64_t> peak_memory_ = 0;
+
+    bool tracing_ = false;
+    mutable std::mutex trace_mutex_;
+    std::vector<TraceEvent> trace_;
+    uint64_t dropped_events_ = 0;
+};
+
+// Adds the time between its construction and destruction to a stage
+class StageTimer
+{
+public:
+    StageTimer(PipelineStats& stats, Stage stage, uint64_t bytes, uint64_t messages,
+               bool trace = true);
+    ~StageTimer();
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    PipelineStats& stats_;
+    Stage stage_;
+    uint64_t bytes_;
+    uint64_t messages_;
+    bool trace_;
+    uint64_t start_ns_;
+};
+
+}  // namespace mcap_editor
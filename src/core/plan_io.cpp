@@ -0,0 +1,65 @@
+#include "plan_io.hpp"
+
+namespace mcap_editor
+{
+
+mcap::Status PlanInput::open(const std::string& filename, const EditPlan& plan)
+{
+    if(plan.async_io && async_reader_.open(filename).ok())
+    {
+        input_ = &async_reader_;
+        return {};
+    }
+    if(mmap_reader_.open(filename).ok())
+    {
+        // The jobs go through the data section from start to end
+        mmap_reader_.advise(MmapReader::AccessPattern::Sequential);
+        input_ = &mmap_reader_;
+        return {};
+    }
+    file_.reset(std::fopen(filename.c_str(), "rb"));
+    if(!file_)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    input_ = &file_reader_.emplace(file_.get());
+    return {};
+}
+
+mcap::Status PlanOutput::open(const std::string& filename, const EditPlan& plan,
+                              uint64_t size_hint)
+{
+    if(plan.write_behind &&
+       behind_writer_.emplace(*plan.write_behind).open(filename, size_hint).ok())
+    {
+        output_ = &*behind_writer_;
+        return {};
+    }
+    behind_writer_.reset();
+    if(plan.async_io && async_writer_.open(filename).ok())
+    {
+        output_ = &async_writer_;
+        return {};
+    }
+    auto status = file_writer_.open(filename);
+    if(status.ok())
+    {
+        output_ = &file_writer_;
+    }
+    return status;
+}
+
+mcap::Status PlanOutput::status() const
+{
+    if(behind_writer_)
+    {
+        return behind_writer_->status();
+    }
+    if(output_ == &async_writer_)
+    {
+        return async_writer_.status();
+    }
+    return {};
+}
+
+}  // namespace mcap_editor
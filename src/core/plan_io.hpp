@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include "async_io.hpp"
+#include "edit_plan.hpp"
+#include "mmap_reader.hpp"
+#include "write_behind_writer.hpp"
+
+namespace mcap_editor
+{
+
+// An input file of Exporter, Splitter or Merger, read from start to end as
+// the plan asks: read ahead with several requests in flight (async_io), or
+// mapped to memory, or with stdio when it can't be mapped (like
+// mcap::McapReader::open(filename)).
+class PlanInput
+{
+public:
+    PlanInput() = default;
+
+    PlanInput(const PlanInput&) = delete;
+    PlanInput& operator=(const PlanInput&) = delete;
+
+    mcap::Status open(const std::string& filename, const EditPlan& plan);
+
+    // Valid once open() succeeded
+    mcap::IReadable& readable() { return *input_; }
+
+private:
+    AsyncFileReader async_reader_;
+    MmapReader mmap_reader_;
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file_{nullptr, &std::fclose};
+    std::optional<mcap::FileReader> file_reader_;
+    mcap::IReadable* input_ = nullptr;
+};
+
+// An output file of Exporter, Splitter or Merger, written as the plan asks:
+// in large blocks from a background thread (write_behind), or with several
+// requests in flight (async_io), or with stdio. Falls back to the next one
+// when a file can't be opened so.
+class PlanOutput
+{
+public:
+    PlanOutput() = default;
+
+    PlanOutput(const PlanOutput&) = delete;
+    PlanOutput& operator=(const PlanOutput&) = delete;
+
+    // size_hint is the expected size of the file, allocated up front with
+    // WriteBehindOptions::preallocate (0 = unknown)
+    mcap::Status open(const std::string& filename, const EditPlan& plan, uint64_t size_hint = 0);
+
+    // Valid once open() succeeded
+    mcap::IWritable& writable() { return *output_; }
+
+    // Once the writable ended: the first error of the writes that were still
+    // in flight
+    mcap::Status status() const;
+
+private:
+    std::optional<WriteBehindWriter> behind_writer_;
+    AsyncFileWriter async_writer_;
+    mcap::FileWriter file_writer_;
+    mcap::IWritable* output_ = nullptr;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,67 @@
+#include "segmented_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mcap_editor
+{
+
+SegmentedBuffer::SegmentedBuffer(uint64_t block_size) :
+    block_size_(std::max<uint64_t>(block_size, 1))
+{
+}
+
+void SegmentedBuffer::reserve(uint64_t size)
+{
+    const uint64_t block_count = (size + block_size_ - 1) / block_size_;
+    blocks_.reserve(block_count);
+    while(blocks_.size() < block_count)
+    {
+        // Not value-initialized: the pages are only touched when written
+        blocks_.emplace_back(new std::byte[block_size_]);
+    }
+}
+
+void SegmentedBuffer::drain(const std::function<void(const std::byte*, uint64_t)>& consumer)
+{
+    uint64_t remaining = size_;
+    for(auto& block: blocks_)
+    {
+        if(remaining == 0)
+        {
+            break;
+        }
+        const uint64_t block_bytes = std::min(remaining, block_size_);
+        consumer(block.get(), block_bytes);
+        remaining -= block_bytes;
+        block.reset();
+    }
+    clear();
+}
+
+void SegmentedBuffer::clear()
+{
+    blocks_.clear();
+    blocks_.shrink_to_fit();
+    size_ = 0;
+}
+
+void SegmentedBuffer::handleWrite(const std::byte* data, uint64_t size)
+{
+    while(size > 0)
+    {
+        const uint64_t block_index = size_ / block_size_;
+        const uint64_t block_offset = size_ % block_size_;
+        if(block_index == blocks_.size())
+        {
+            blocks_.emplace_back(new std::byte[block_size_]);
+        }
+        const uint64_t count = std::min(size, block_size_ - block_offset);
+        std::memcpy(blocks_[block_index].get() + block_offset, data, count);
+        data += count;
+        size -= count;
+        size_ += count;
+    }
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <mcap/writer.hpp>
+
+namespace mcap_editor
+{
+
+// In-memory output made of fixed-size blocks. Unlike a single growing array,
+// it never reallocates nor copies what was written, so the peak memory is the
+// output size plus less than one block.
+class SegmentedBuffer : public mcap::IWritable
+{
+public:
+    static constexpr uint64_t DEFAULT_BLOCK_SIZE = 16 * 1024 * 1024;
+
+    explicit SegmentedBuffer(uint64_t block_size = DEFAULT_BLOCK_SIZE);
+
+    // Allocates the blocks to hold size bytes. Writing more still works,
+    // with new blocks allocated as needed.
+    void reserve(uint64_t size);
+
+    void end() override {}
+
+    uint64_t size() const override { return size_; }
+
+    uint64_t blockSize() const { return block_size_; }
+
+    // Bytes allocated, written or not
+    uint64_t capacity() const { return blocks_.size() * block_size_; }
+
+    // Calls consumer with the written part of each block, in order, and frees
+    // every block once consumed. The buffer is empty afterwards.
+    void drain(const std::function<void(const std::byte* data, uint64_t size)>& consumer);
+
+    void clear();
+
+protected:
+    void handleWrite(const std::byte* data, uint64_t size) override;
+
+private:
+    uint64_t block_size_;
+    uint64_t size_ = 0;
+    std::vector<std::unique_ptr<std::byte[]>> blocks_;
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,338 @@
+#include "splitter.hpp"
+#include "attachments.hpp"
+#include "channel_selection.hpp"
+#include "chunk_groups.hpp"
+#include "file_info.hpp"
+#include "measured_io.hpp"
+#include "message_copy.hpp"
+#include "plan_io.hpp"
+#include "topic_stats.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <memory>
+
+namespace mcap_editor
+{
+
+namespace
+{
+// Sizes of the records, opcode and length included
+uint64_t recordSize(const mcap::Schema& schema)
+{
+    return 9 + 2 + 4 + schema.name.size() + 4 + schema.encoding.size() + 4 + schema.data.size();
+}
+
+uint64_t recordSize(const mcap::Channel& channel)
+{
+    uint64_t size = 9 + 2 + 2 + 4 + channel.topic.size() + 4 + channel.messageEncoding.size() + 4;
+    for(const auto& [key, value]: channel.metadata)
+    {
+        size += 4 + key.size() + 4 + value.size();
+    }
+    return size;
+}
+
+// Message record without its data: channel id, sequence, log and publish times
+constexpr uint64_t MESSAGE_HEADER_SIZE = 9 + 2 + 4 + 8 + 8;
+// Its entry in a Message Index, and the header of the Message Index of a
+// channel new to the chunk
+constexpr uint64_t MESSAGE_INDEX_SIZE = 16 + 9 + 2 + 4;
+
+// One of the files, written by the thread of run() and closed by another
+struct OutputFile
+{
+    PlanOutput file;
+    std::optional<MeasuredWriter> measured_file;
+    mcap::McapWriter writer;
+    // The groups are added to each writer
+    std::optional<ChunkGroupAssigner> groups;
+    // The schemas and channels of this file
+    std::optional<ChannelMapping> channels;
+    // Start of the time window of the file
+    mcap::Timestamp start_time = 0;
+    uint64_t messages = 0;
+};
+}  // namespace
+
+Splitter::Splitter(EditPlan plan, SplitLimits limits) :
+    plan_(std::move(plan)),
+    limits_(limits)
+{
+}
+
+std::string Splitter::fileName(const std::string& output_file, size_t index)
+{
+    // Before the extension, if the name of the file has one
+    const size_t slash = output_file.find_last_of("/\\");
+    const size_t name_start = slash == std::string::npos ? 0 : slash + 1;
+    size_t dot = output_file.rfind('.');
+    if(dot == std::string::npos || dot <= name_start)
+    {
+        dot = output_file.size();
+    }
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%03zu", index);
+    return output_file.substr(0, dot) + number + output_file.substr(dot);
+}
+
+void Splitter::setProgressCallback(ProgressCallback callback)
+{
+    progress_callback_ = std::move(callback);
+}
+
+void Splitter::cancel()
+{
+    cancel_requested_ = true;
+}
+
+bool Splitter::canceled() const
+{
+    return cancel_requested_;
+}
+
+void Splitter::reportProgress(uint64_t done, uint64_t total)
+{
+    stats_.sampleMemory();
+    if(progress_callback_)
+    {
+        progress_callback_(done, total);
+    }
+}
+
+mcap::Status Splitter::run()
+{
+    files_.clear();
+    late_messages_ = 0;
+
+    PlanInput input;
+    auto status = input.open(plan_.input_file, plan_);
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    stats_.start(input.readable().size());
+    MeasuredReader measured_input(input.readable(), stats_);
+    mcap::McapReader reader;
+    status = reader.open(measured_input);
+    if(!status.ok())
+    {
+        return status;
+    }
+    mcap::ProblemCallback problem = [](const mcap::Status&) {};
+    bool has_summary = reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan, problem).ok();
+    if(!has_summary && summary_cache_)
+    {
+        has_summary = summary_cache_->load(plan_.input_file, reader).ok();
+    }
+    if(!has_summary && limits_.max_duration > 0)
+    {
+        // Time windows need the message indexes, which a recording that was
+        // interrupted wrote after its chunks. They are found by a scan, on as
+        // many threads as decompress the chunks.
+        reader.setScanThreads(plan_.decompression_threads);
+        has_summary = reader.readSummary(mcap::ReadSummaryMethod::ForceScan, problem).ok();
+        if(has_summary && summary_cache_)
+        {
+            (void)summary_cache_->save(plan_.input_file, reader);
+        }
+    }
+
+    mcap::McapWriterOptions writer_options(reader.header() ? reader.header()->profile : "");
+    writer_options.compression = plan_.compression;
+    writer_options.compressionLevel = plan_.compression_level;
+    writer_options.chunkSize = plan_.chunk_size;
+    writer_options.compressionThreads = plan_.compression_threads;
+    writer_options.onChunkCompressed = [this](const mcap::ChunkCodecTiming& timing)
+    {
+        stats_.add(Stage::Compress, timing.startTime, timing.duration, timing.uncompressedSize, 0);
+    };
+
+    // Computed once, for the groups of every file
+    TopicStatsMap topic_stats;
+    if(plan_.chunk_grouping.automatic)
+    {
+        (void)computeTopicStats(reader, topic_stats);
+    }
+
+    // Preallocated to each file with write_behind: its size limit, unless the
+    // whole output is expected to be smaller. Unknown for time windows.
+    uint64_t size_hint = 0;
+    if(plan_.write_behind && plan_.write_behind->preallocate && limits_.max_bytes > 0)
+    {
+        size_hint = std::min(limits_.max_bytes, estimateOutputSize(reader, plan_));
+    }
+
+    std::unique_ptr<OutputFile> output;
+    // The previous file, being closed, and the first error of the writes
+    // that were still in flight
+    std::future<mcap::Status> closing;
+    auto open_output = [&](mcap::Timestamp start_time) -> mcap::Status
+    {
+        auto new_output = std::make_unique<OutputFile>();
+        const auto name = fileName(plan_.output_file, files_.size());
+        auto status = new_output->file.open(name, plan_, size_hint);
+        if(!status.ok())
+        {
+            return status;
+        }
+        files_.push_back(name);
+        new_output->writer.open(
+            new_output->measured_file.emplace(new_output->file.writable(), stats_),
+            writer_options);
+        if(plan_.chunk_grouping.enabled())
+        {
+            new_output->groups.emplace(plan_, topic_stats);
+        }
+        new_output->channels.emplace(new_output->writer,
+                                     new_output->groups ? &*new_output->groups : nullptr);
+        new_output->start_time = start_time;
+        output = std::move(new_output);
+        return {};
+    };
+    auto close_output = [&]() -> mcap::Status
+    {
+        // One file is closed at a time, which bounds the memory of the chunks
+        // left to compress
+        mcap::Status status;
+        if(closing.valid())
+        {
+            status = closing.get();
+        }
+        closing = std::async(std::launch::async, [this, closed = std::move(output)]() mutable
+        {
+            StageTimer timer(stats_, Stage::Write, 0, 0);
+            closed->writer.close();
+            return closed->file.status();
+        });
+        return status;
+    };
+    // Time windows need the messages in log time order, when the input has
+    // all of its message indexes
+    ChannelSelection selection(plan_);
+    const auto read_options = readMessageOptions(plan_, reader, has_summary, selection, stats_);
+
+    const uint64_t file_size = reader.dataSource()->size();
+
+    // Attachments and metadata go to the first file, opened before the
+    // messages are read, and its time window starts at the first message
+    std::vector<AttachmentRecord> attachments;
+    status = listAttachments(reader, has_summary, plan_, attachments);
+    if(status.ok())
+    {
+        status = open_output(plan_.start_time);
+    }
+    for(size_t i = 0; status.ok() && !cancel_requested_ && i < attachments.size(); i++)
+    {
+        reportProgress(attachments[i].offset, file_size);
+        status = copyAttachmentRecord(*reader.dataSource(), attachments[i], plan_,
+                                      output->writer, stats_);
+    }
+
+    const bool log_time_order = readsInLogTimeOrder(read_options);
+    std::optional<mcap::Timestamp> first_time;
+    for(const auto& msg: reader.readMessages(problem, read_options))
+    {
+        if(cancel_requested_ || !status.ok())
+        {
+            break;
+        }
+        const auto log_time = msg.message.logTime;
+        if(!first_time)
+        {
+            first_time = log_time;
+            output->start_time = log_time;
+        }
+
+        if(output && limits_.max_duration > 0 && log_time < output->start_time)
+        {
+            // Read in file order, and out of it
+            late_messages_++;
+        }
+        if(output && output->messages > 0)
+        {
+            const bool new_window = limits_.max_duration > 0 &&
+                                    log_time >= output->start_time &&
+                                    log_time - output->start_time >= limits_.max_duration;
+            bool full = false;
+            if(limits_.max_bytes > 0 && !new_window)
+            {
+                uint64_t size = MESSAGE_HEADER_SIZE + msg.message.dataSize + MESSAGE_INDEX_SIZE;
+                if(!output->channels->hasChannel(msg.channel->id))
+                {
+                    // In a chunk, and in the summary
+                    size += 2 * recordSize(*msg.channel);
+                    if(msg.schema && !output->channels->hasSchema(msg.schema->id))
+                    {
+                        size += 2 * recordSize(*msg.schema);
+                    }
+                }
+                size += output->writer.dataSink()->size() + output->writer.pendingBytes();
+                full = size > limits_.max_bytes;
+            }
+            if(new_window || full)
+            {
+                status = close_output();
+                if(!status.ok())
+                {
+                    break;
+                }
+            }
+        }
+        if(!output)
+        {
+            mcap::Timestamp start_time = log_time;
+            if(limits_.max_duration > 0 && log_time > *first_time)
+            {
+                start_time = log_time - (log_time - *first_time) % limits_.max_duration;
+            }
+            status = open_output(start_time);
+            if(!status.ok())
+            {
+                break;
+            }
+        }
+
+        auto& file = *output;
+        const auto new_channel_id = file.channels->outputId(*msg.channel, msg.schema);
+        {
+            StageTimer timer(stats_, Stage::Write, msg.message.dataSize, 1, false);
+            status = file.writer.write(msg, new_channel_id);
+        }
+        if(!status.ok())
+        {
+            break;
+        }
+        file.messages++;
+        reportProgress(fileOffset(msg, log_time_order), file_size);
+    }
+
+    if(status.ok() && !first_time)
+    {
+        // Nothing in the range: the first file has no message, but the
+        // channels of the summary
+        output->channels->addChannels(reader, selection);
+    }
+    if(output)
+    {
+        auto closed = close_output();
+        if(status.ok())
+        {
+            status = closed;
+        }
+    }
+    if(closing.valid())
+    {
+        auto closed = closing.get();
+        if(status.ok())
+        {
+            status = closed;
+        }
+    }
+    stats_.finish();
+    return status;
+}
+
+}  // namespace mcap_editor
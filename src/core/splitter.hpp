@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include "edit_plan.hpp"
+#include "pipeline_stats.hpp"
+#include "summary_cache.hpp"
+
+namespace mcap_editor
+{
+
+// When Splitter starts a new file. 0 = no limit
+struct SplitLimits
+{
+    // Size of each file, summary included. A file holds at least one
+    // message, which can make it larger.
+    uint64_t max_bytes = 0;
+    // Log time covered by each file (nanoseconds). Files start at multiples
+    // of it after the first message, so a gap in the recording leaves no
+    // empty file. The windows are exact when the input can be read in log
+    // time order, which needs the message indexes of all its chunks: listed
+    // in its summary, or found by a scan when it has none. Otherwise it is
+    // read in file order, and a message logged before the window of the file
+    // being written goes to that file (see Splitter::lateMessages()).
+    mcap::Timestamp max_duration = 0;
+
+    bool enabled() const { return max_bytes > 0 || max_duration > 0; }
+};
+
+// Executes an EditPlan, like Exporter, but cuts the output into several
+// files within limits, reading the input once. Each file is a complete
+// MCAP file, with the schema and channel records of its own messages. The
+// attachments and metadata go to the first file. A finished file is closed
+// (last chunks and summary) on another thread while the next one is written.
+class Splitter
+{
+public:
+    // Bytes of the input file processed so far, and its size
+    using ProgressCallback = std::function<void(uint64_t done, uint64_t total)>;
+
+    // The files are named after plan.output_file, see fileName()
+    Splitter(EditPlan plan, SplitLimits limits);
+
+    const EditPlan& plan() const { return plan_; }
+    const SplitLimits& limits() const { return limits_; }
+
+    // e.g. "out_002.mcap" for index 2 of "out.mcap"
+    static std::string fileName(const std::string& output_file, size_t index);
+
+    // Files written by the last run(), in order
+    const std::vector<std::string>& files() const { return files_; }
+
+    // Messages of the last run() written to a file after the one of their
+    // time window, out of log time order in an input read in file order
+    uint64_t lateMessages() const { return late_messages_; }
+
+    // Called by run(), on the thread executing it
+    void setProgressCallback(ProgressCallback callback);
+
+    // Thread safe: can be called while run() is executing in another thread.
+    // The files written are closed and valid, the last one incomplete.
+    void cancel();
+
+    bool canceled() const;
+
+    // Counters and timers of the last run(), see Exporter::stats. Closing
+    // the files is counted in Stage::Write.
+    const PipelineStats& stats() const { return stats_; }
+
+    // Where the summary of an input file without one is looked up, so that
+    // it can be read in log time order. The scan made for time windows is
+    // saved there.
+    void setSummaryCache(std::optional<SummaryCache> cache) { summary_cache_ = std::move(cache); }
+
+    void setTracing(bool enabled) { stats_.setTracing(enabled); }
+
+    // Reads plan().input_file and writes the files
+    mcap::Status run();
+
+private:
+    EditPlan plan_;
+    SplitLimits limits_;
+    ProgressCallback progress_callback_;
+    std::atomic_bool cancel_requested_ = false;
+    PipelineStats stats_;
+    std::optional<SummaryCache> summary_cache_;
+    std::vector<std::string> files_;
+    uint64_t late_messages_ = 0;
+
+    void reportProgress(uint64_t done, uint64_t total);
+};
+
+}  // namespace mcap_editor
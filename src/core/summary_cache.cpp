@@ -0,0 +1,252 @@
+#include "summary_cache.hpp"
+
+#include <mcap/crc32.hpp>
+#include <mcap/writer.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+
+namespace mcap_editor
+{
+
+namespace
+{
+constexpr const char* ENTRY_PROFILE = "mcap_editor.summary_cache";
+// Name of the Metadata record holding the key of the entry
+constexpr const char* KEY_METADATA = "mcap_editor.summary_cache";
+// 2: scans list the message indexes that follow the chunks
+constexpr const char* FORMAT_VERSION = "2";
+// Bytes hashed at the start and at the end of the recording
+constexpr uint64_t HASHED_BYTES = 64 * 1024;
+
+std::string canonicalPath(const std::string& filename)
+{
+    std::error_code error;
+    const auto path = std::filesystem::weakly_canonical(std::filesystem::absolute(filename), error);
+    return error ? filename : path.string();
+}
+
+uint32_t rangeCrc(mcap::IReadable& source, uint64_t offset, uint64_t size)
+{
+    std::byte* data = nullptr;
+    const uint64_t bytes_read = source.read(&data, offset, size);
+    return mcap::internal::crc32Final(
+        mcap::internal::crc32Update(mcap::internal::CRC32_INIT, data, bytes_read));
+}
+
+// What identifies a version of a recording
+mcap::Status fileKey(const std::string& filename, mcap::McapReader& reader,
+                     mcap::KeyValueMap& key)
+{
+    auto* source = reader.dataSource();
+    if(!source)
+    {
+        return {mcap::StatusCode::NotOpen};
+    }
+    std::error_code error;
+    const auto modification_time = std::filesystem::last_write_time(filename, error);
+    if(error)
+    {
+        return {mcap::StatusCode::OpenFailed, "can't read the modification time of " + filename};
+    }
+
+    const uint64_t size = source->size();
+    const uint64_t hashed = std::min(size, HASHED_BYTES);
+    key = {
+        {"version", FORMAT_VERSION},
+        {"path", canonicalPath(filename)},
+        {"size", std::to_string(size)},
+        {"mtime", std::to_string(modification_time.time_since_epoch().count())},
+        {"head_crc", std::to_string(rangeCrc(*source, 0, hashed))},
+        {"tail_crc", std::to_string(rangeCrc(*source, size - hashed, hashed))},
+    };
+    return {};
+}
+
+// FNV-1a, stable across platforms and runs unlike std::hash
+uint64_t pathHash(const std::string& path)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for(const char c: path)
+    {
+        hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+}  // namespace
+
+SummaryCache::SummaryCache(std::string directory) :
+    directory_(std::move(directory))
+{
+}
+
+std::string SummaryCache::defaultDirectory()
+{
+    namespace fs = std::filesystem;
+    fs::path base;
+#if defined(_WIN32)
+    if(const char* local_app_data = std::getenv("LOCALAPPDATA"))
+    {
+        base = local_app_data;
+    }
+#elif defined(__APPLE__)
+    if(const char* home = std::getenv("HOME"))
+    {
+        base = fs::path(home) / "Library" / "Caches";
+    }
+#else
+    if(const char* cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home)
+    {
+        base = cache_home;
+    }
+    else if(const char* home = std::getenv("HOME"))
+    {
+        base = fs::path(home) / ".cache";
+    }
+#endif
+    if(base.empty())
+    {
+        std::error_code error;
+        base = fs::temp_directory_path(error);
+    }
+    return (base / "mcap_editor" / "summaries").string();
+}
+
+std::string SummaryCache::entryPath(const std::string& filename) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.mcap",
+                  (unsigned long long)pathHash(canonicalPath(filename)));
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+mcap::Status SummaryCache::load(const std::string& filename, mcap::McapReader& reader) const
+{
+    const std::string path = entryPath(filename);
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"),
+                                                         &std::fclose);
+    if(!file)
+    {
+        return {mcap::StatusCode::OpenFailed, "no cached summary for " + filename};
+    }
+    mcap::FileReader source(file.get());
+
+    // The key is in the Data section, before the Summary section
+    std::optional<mcap::KeyValueMap> cached_key;
+    mcap::TypedRecordReader records(source, sizeof(mcap::Magic), source.size());
+    records.onMetadata = [&](const mcap::Metadata& metadata, mcap::ByteOffset) {
+        if(metadata.name == KEY_METADATA)
+        {
+            cached_key = metadata.metadata;
+        }
+    };
+    while(!cached_key && records.next() && records.status().ok())
+    {
+    }
+    if(!cached_key)
+    {
+        return {mcap::StatusCode::InvalidFile, "invalid summary cache entry " + path};
+    }
+
+    mcap::KeyValueMap key;
+    auto status = fileKey(filename, reader, key);
+    if(!status.ok())
+    {
+        return status;
+    }
+    for(const auto& [name, value]: key)
+    {
+        auto it = cached_key->find(name);
+        if(it == cached_key->end() || it->second != value)
+        {
+            return {mcap::StatusCode::InvalidFile, "outdated summary cache entry " + path};
+        }
+    }
+    const auto data_end = std::strtoull((*cached_key)["data_end"].c_str(), nullptr, 10);
+    return reader.readSummaryFrom(source, data_end);
+}
+
+mcap::Status SummaryCache::save(const std::string& filename, mcap::McapReader& reader) const
+{
+    const auto& statistics = reader.statistics();
+    if(!statistics)
+    {
+        return {mcap::StatusCode::MissingStatistics, "no summary to cache"};
+    }
+    mcap::KeyValueMap key;
+    auto status = fileKey(filename, reader, key);
+    if(!status.ok())
+    {
+        return status;
+    }
+    key["data_end"] = std::to_string(reader.dataEnd());
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if(error)
+    {
+        return {mcap::StatusCode::OpenFailed, "can't create " + directory_};
+    }
+
+    // Written next to the entry then renamed, so that a reader never sees
+    // half of it
+    const std::string path = entryPath(filename);
+    const std::string temporary_path = path + ".tmp";
+    mcap::FileWriter output;
+    status = output.open(temporary_path);
+    if(!status.ok())
+    {
+        return status;
+    }
+
+    using mcap::McapWriter;
+    McapWriter::writeMagic(output);
+    McapWriter::write(output, mcap::Header{ENTRY_PROFILE, "mcap_editor"});
+    McapWriter::write(output, mcap::Metadata{KEY_METADATA, key});
+    McapWriter::write(output, mcap::DataEnd{0});
+
+    const uint64_t summary_start = output.size();
+    // Ordered by id, so that the same file gives the same entry
+    const auto schemas = reader.schemas();
+    for(const auto& [id, schema]: std::map<mcap::SchemaId, mcap::SchemaPtr>(schemas.begin(),
+                                                                           schemas.end()))
+    {
+        McapWriter::write(output, *schema);
+    }
+    const auto channels = reader.channels();
+    for(const auto& [id, channel]: std::map<mcap::ChannelId, mcap::ChannelPtr>(channels.begin(),
+                                                                              channels.end()))
+    {
+        McapWriter::write(output, *channel);
+    }
+    McapWriter::write(output, *statistics);
+    for(const auto& chunk_index: reader.chunkIndexes())
+    {
+        McapWriter::write(output, chunk_index);
+    }
+    for(const auto& [name, attachment_index]: reader.attachmentIndexes())
+    {
+        McapWriter::write(output, attachment_index);
+    }
+    for(const auto& [name, metadata_index]: reader.metadataIndexes())
+    {
+        McapWriter::write(output, metadata_index);
+    }
+    McapWriter::write(output, mcap::Footer{summary_start, 0}, false);
+    McapWriter::writeMagic(output);
+    output.end();
+
+    std::filesystem::rename(temporary_path, path, error);
+    if(error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        return {mcap::StatusCode::OpenFailed, "can't write " + path};
+    }
+    return {};
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <string>
+
+namespace mcap_editor
+{
+
+// Keeps the summary of the files that have none, so that the scan needed to
+// open them (see mcap::ReadSummaryMethod) happens only once.
+//
+// Each entry is a small MCAP file made of a Summary section, named after the
+// path of the recording. It is only used if the recording has the same size,
+// modification time, and CRC of its first and last bytes as when it was saved.
+class SummaryCache
+{
+public:
+    explicit SummaryCache(std::string directory);
+
+    // $XDG_CACHE_HOME/mcap_editor/summaries, or the equivalent of the platform
+    static std::string defaultDirectory();
+
+    const std::string& directory() const { return directory_; }
+
+    // Loads the cached summary of filename, which reader has opened, instead
+    // of scanning it. Fails if there is no valid entry.
+    mcap::Status load(const std::string& filename, mcap::McapReader& reader) const;
+
+    // Saves the summary of filename, which reader has just scanned
+    mcap::Status save(const std::string& filename, mcap::McapReader& reader) const;
+
+private:
+    std::string directory_;
+
+    std::string entryPath(const std::string& filename) const;
+};
+
+}  // namespace mcap_editor
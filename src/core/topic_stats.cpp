@@ -0,0 +1,336 @@
+#include "topic_stats.hpp"
+
+#include <mcap/internal.hpp>
+#include <mcap/thread_pool.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+namespace mcap_editor
+{
+
+namespace
+{
+constexpr double NS_PER_S = 1e9;
+
+// TopicStats being built, from messages in log time order
+struct Accumulator
+{
+    TopicStats stats;
+    uint64_t gap_count = 0;
+    uint64_t gap_sum = 0;
+    long double gap_square_sum = 0;
+    double compressed_bytes = 0;
+    // Log times read but not added yet, which later chunks may interleave with
+    std::vector<mcap::Timestamp> pending;
+
+    void addGap(mcap::Timestamp gap, mcap::Timestamp start)
+    {
+        if(gap_count == 0 || gap < stats.min_gap)
+        {
+            stats.min_gap = gap;
+        }
+        if(gap_count == 0 || gap > stats.max_gap)
+        {
+            stats.max_gap = gap;
+            stats.max_gap_start = start;
+        }
+        gap_count++;
+        gap_sum += gap;
+        gap_square_sum += (long double)gap * gap;
+    }
+
+    void addMessage(mcap::Timestamp time)
+    {
+        if(stats.message_count == 0)
+        {
+            stats.first_time = stats.last_time = time;
+        }
+        else if(time < stats.last_time)
+        {
+            stats.out_of_order++;
+            stats.first_time = std::min(stats.first_time, time);
+        }
+        else {
+            addGap(time - stats.last_time, stats.last_time);
+            stats.last_time = time;
+        }
+        stats.message_count++;
+    }
+
+    // other holds the messages logged after those of this one
+    void merge(const Accumulator& other)
+    {
+        if(other.stats.message_count == 0)
+        {
+            return;
+        }
+        if(stats.message_count == 0)
+        {
+            *this = other;
+            return;
+        }
+        if(other.stats.first_time >= stats.last_time)
+        {
+            addGap(other.stats.first_time - stats.last_time, stats.last_time);
+        }
+        else {
+            stats.out_of_order++;
+        }
+        if(other.gap_count > 0)
+        {
+            if(gap_count == 0 || other.stats.min_gap < stats.min_gap)
+            {
+                stats.min_gap = other.stats.min_gap;
+            }
+            if(gap_count == 0 || other.stats.max_gap > stats.max_gap)
+            {
+                stats.max_gap = other.stats.max_gap;
+                stats.max_gap_start = other.stats.max_gap_start;
+            }
+        }
+        gap_count += other.gap_count;
+        gap_sum += other.gap_sum;
+        gap_square_sum += other.gap_square_sum;
+        compressed_bytes += other.compressed_bytes;
+        stats.message_count += other.stats.message_count;
+        stats.bytes += other.stats.bytes;
+        stats.out_of_order += other.stats.out_of_order;
+        stats.first_time = std::min(stats.first_time, other.stats.first_time);
+        stats.last_time = std::max(stats.last_time, other.stats.last_time);
+    }
+
+    // Adds the pending messages logged before watermark, which no chunk left
+    // to read can precede
+    void flush(mcap::Timestamp watermark)
+    {
+        if(!std::is_sorted(pending.begin(), pending.end()))
+        {
+            std::sort(pending.begin(), pending.end());
+        }
+        const auto end = watermark == mcap::MaxTime ?
+            pending.end() : std::lower_bound(pending.begin(), pending.end(), watermark);
+        for(auto it = pending.begin(); it != end; ++it)
+        {
+            addMessage(*it);
+        }
+        pending.erase(pending.begin(), end);
+    }
+
+    TopicStats finish() const
+    {
+        TopicStats result = stats;
+        result.compressed_bytes = uint64_t(std::llround(compressed_bytes));
+        if(gap_count > 0)
+        {
+            const long double mean = (long double)gap_sum / gap_count;
+            const long double variance = gap_square_sum / gap_count - mean * mean;
+            result.mean_gap = double(mean);
+            result.jitter = double(std::sqrt(std::max<long double>(variance, 0)));
+        }
+        return result;
+    }
+};
+
+using AccumulatorMap = std::unordered_map<mcap::ChannelId, Accumulator>;
+
+// Adds the messages of chunks, ordered by start time, to accumulators. The
+// messages of overlapping chunks are merged in log time order as they are
+// read: a message is only added once the next chunk starts after it.
+mcap::Status indexChunks(mcap::IReadable& source,
+                         const std::vector<const mcap::ChunkIndex*>& chunks,
+                         size_t begin, size_t end, AccumulatorMap& accumulators)
+{
+    struct Entry
+    {
+        mcap::ByteOffset offset;
+        Accumulator* accumulator;
+    };
+    std::vector<Entry> entries;
+    std::vector<Accumulator*> pending;
+    mcap::MessageIndex message_index;
+
+    for(size_t i = begin; i < end; i++)
+    {
+        const auto& chunk_index = *chunks[i];
+        std::byte* data = nullptr;
+        const uint64_t index_start = chunk_index.chunkStartOffset + chunk_index.chunkLength;
+        if(source.read(&data, index_start, chunk_index.messageIndexLength) !=
+           chunk_index.messageIndexLength)
+        {
+            return {mcap::StatusCode::ReadFailed, "can't read the message indexes at offset " +
+                                                      std::to_string(index_start)};
+        }
+
+        entries.clear();
+        mcap::BufferReader records;
+        records.reset(data, chunk_index.messageIndexLength, chunk_index.messageIndexLength);
+        mcap::RecordReader record_reader(records, 0, chunk_index.messageIndexLength);
+        for(auto record = record_reader.next(); record; record = record_reader.next())
+        {
+            if(record->opcode != mcap::OpCode::MessageIndex)
+            {
+                continue;
+            }
+            message_index.records.clear();
+            auto status = mcap::McapReader::ParseMessageIndex(*record, &message_index);
+            if(!status.ok())
+            {
+                return status;
+            }
+            auto& accumulator = accumulators[message_index.channelId];
+            if(accumulator.pending.empty() && !message_index.records.empty())
+            {
+                pending.push_back(&accumulator);
+            }
+            for(const auto& [time, offset]: message_index.records)
+            {
+                accumulator.pending.push_back(time);
+                entries.push_back({offset, &accumulator});
+            }
+        }
+        if(!record_reader.status().ok())
+        {
+            return record_reader.status();
+        }
+
+        // A message ends where the next one starts
+        std::sort(entries.begin(), entries.end(),
+                  [](const Entry& a, const Entry& b) { return a.offset < b.offset; });
+        const double ratio = chunk_index.uncompressedSize > 0 ?
+            double(chunk_index.compressedSize) / double(chunk_index.uncompressedSize) : 1.0;
+        for(size_t j = 0; j < entries.size(); j++)
+        {
+            const uint64_t next = j + 1 < entries.size() ? entries[j + 1].offset :
+                                                           chunk_index.uncompressedSize;
+            const uint64_t size = next > entries[j].offset ? next - entries[j].offset : 0;
+            entries[j].accumulator->stats.bytes += size;
+            entries[j].accumulator->compressed_bytes += double(size) * ratio;
+        }
+
+        const auto watermark = i + 1 < end ? chunks[i + 1]->messageStartTime : mcap::MaxTime;
+        for(auto* accumulator: pending)
+        {
+            accumulator->flush(watermark);
+        }
+        pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                     [](const Accumulator* accumulator)
+                                     { return accumulator->pending.empty(); }),
+                      pending.end());
+    }
+    return {};
+}
+}  // namespace
+
+double TopicStats::averageRate() const
+{
+    if(message_count < 2 || last_time == first_time)
+    {
+        return 0;
+    }
+    return double(message_count - 1) * NS_PER_S / double(last_time - first_time);
+}
+
+double TopicStats::maxRate() const
+{
+    return min_gap > 0 ? NS_PER_S / double(min_gap) : 0;
+}
+
+double TopicStats::minRate() const
+{
+    return max_gap > 0 ? NS_PER_S / double(max_gap) : 0;
+}
+
+mcap::Status computeTopicStats(mcap::McapReader& reader, TopicStatsMap& stats, unsigned threads)
+{
+    stats.clear();
+    auto* source = reader.dataSource();
+    if(!source)
+    {
+        return {mcap::StatusCode::NotOpen};
+    }
+
+    // In log time order, so that the gaps of a channel are between its
+    // consecutive messages, unless its chunks overlap
+    std::vector<const mcap::ChunkIndex*> chunks;
+    uint64_t index_bytes = 0;
+    for(const auto& chunk_index: reader.chunkIndexes())
+    {
+        if(chunk_index.messageIndexLength > 0)
+        {
+            chunks.push_back(&chunk_index);
+            index_bytes += chunk_index.messageIndexLength;
+        }
+    }
+    if(chunks.empty())
+    {
+        return {mcap::StatusCode::NoMessageIndexesAvailable, "the file has no message indexes"};
+    }
+    std::stable_sort(chunks.begin(), chunks.end(),
+                     [](const mcap::ChunkIndex* a, const mcap::ChunkIndex* b)
+                     { return a->messageStartTime < b->messageStartTime; });
+
+    // Contiguous runs of chunks with about as many message indexes each
+    const size_t part_count = source->stablePointers() ?
+        std::clamp<size_t>(threads, 1, chunks.size()) : 1;
+    std::vector<size_t> part_ends;
+    uint64_t part_bytes = 0;
+    for(size_t i = 0; i < chunks.size(); i++)
+    {
+        part_bytes += chunks[i]->messageIndexLength;
+        if(part_bytes * part_count >= index_bytes * (part_ends.size() + 1))
+        {
+            part_ends.push_back(i + 1);
+        }
+    }
+    part_ends.back() = chunks.size();
+
+    std::vector<AccumulatorMap> parts(part_ends.size());
+    std::vector<mcap::Status> statuses(part_ends.size());
+    auto index_part = [&](size_t part)
+    {
+        const size_t begin = part == 0 ? 0 : part_ends[part - 1];
+        statuses[part] = indexChunks(*source, chunks, begin, part_ends[part], parts[part]);
+    };
+    if(parts.size() == 1)
+    {
+        index_part(0);
+    }
+    else {
+        mcap::internal::ThreadPool pool(parts.size() - 1);
+        std::vector<std::future<void>> done;
+        for(size_t part = 1; part < parts.size(); part++)
+        {
+            done.push_back(pool.submit([&index_part, part] { index_part(part); }));
+        }
+        index_part(0);
+        for(auto& future: done)
+        {
+            future.get();
+        }
+    }
+
+    AccumulatorMap merged = std::move(parts.front());
+    for(size_t part = 1; part < parts.size(); part++)
+    {
+        for(const auto& [channel_id, accumulator]: parts[part])
+        {
+            merged[channel_id].merge(accumulator);
+        }
+    }
+    for(const auto& status: statuses)
+    {
+        if(!status.ok())
+        {
+            return status;
+        }
+    }
+    for(const auto& [channel_id, accumulator]: merged)
+    {
+        stats.emplace(channel_id, accumulator.finish());
+    }
+    return {};
+}
+
+}  // namespace mcap_editor
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <mcap/reader.hpp>
+#include <unordered_map>
+
+namespace mcap_editor
+{
+
+// What the chunk and message indexes tell about a channel, without
+// decompressing any message. Sizes come from the offsets of the messages in
+// their chunk, times from their log time.
+struct TopicStats
+{
+    uint64_t message_count = 0;
+    // Size of the message records, uncompressed
+    uint64_t bytes = 0;
+    // Their share of the compressed chunks, assuming every message of a chunk
+    // compresses equally well
+    uint64_t compressed_bytes = 0;
+
+    mcap::Timestamp first_time = 0;
+    mcap::Timestamp last_time = 0;
+
+    // Between two consecutive messages, in log time
+    mcap::Timestamp min_gap = 0;
+    mcap::Timestamp max_gap = 0;
+    // Log time of the message before the largest gap
+    mcap::Timestamp max_gap_start = 0;
+    double mean_gap = 0;
+    // Standard deviation of the gaps
+    double jitter = 0;
+    // Messages logged before the previous message of the channel. Their gap
+    // is not counted.
+    uint64_t out_of_order = 0;
+
+    // Messages per second over the whole topic, and at its fastest and
+    // slowest (from the smallest and largest gap). 0 when unknown.
+    double averageRate() const;
+    double maxRate() const;
+    double minRate() const;
+};
+
+using TopicStatsMap = std::unordered_map<mcap::ChannelId, TopicStats>;
+
+// Reads the message indexes of every chunk listed in the summary (already
+// read) and computes the statistics of each channel. With threads > 1 and a
+// data source with stable pointers (see mcap::IReadable::stablePointers), the
+// chunks are split between that many threads.
+// Fails with NoMessageIndexesAvailable if no chunk has message indexes.
+mcap::Status computeTopicStats(mcap::McapReader& reader, TopicStatsMap& stats,
+                               unsigned threads = 0);
+
+}  // namespace mcap_editor
@@ -0,0 +1,250 @@
+#include "write_behind_writer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define WRITE_BEHIND_SUPPORTED
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace mcap_editor
+{
+
+namespace
+{
+#ifdef WRITE_BEHIND_SUPPORTED
+int syncData(int fd)
+{
+#ifdef __linux__
+    // The size only changes with the last block, synced with fsync() on close
+    return ::fdatasync(fd);
+#else
+    return ::fsync(fd);
+#endif
+}
+
+#ifdef O_DIRECT
+// Later writes go through the page cache, e.g. the last block, whose size
+// isn't a multiple of the alignment
+bool clearDirect(int fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags & ~O_DIRECT) == 0;
+}
+#endif
+#endif
+}  // namespace
+
+void WriteBehindWriter::AlignedDelete::operator()(std::byte* data) const
+{
+    ::operator delete(data, std::align_val_t(ALIGNMENT));
+}
+
+WriteBehindWriter::WriteBehindWriter(WriteBehindOptions options) :
+    options_(options)
+{
+    options_.block_size = std::max(ALIGNMENT, (options_.block_size + ALIGNMENT - 1) /
+                                                  ALIGNMENT * ALIGNMENT);
+    options_.blocks = std::max(1u, options_.blocks);
+}
+
+WriteBehindWriter::~WriteBehindWriter()
+{
+    end();
+}
+
+mcap::Status WriteBehindWriter::open(const std::string& filename, uint64_t size_hint)
+{
+    end();
+    offset_ = 0;
+    unsynced_ = 0;
+    current_ = -1;
+    closing_ = false;
+    filled_.clear();
+    free_.clear();
+    direct_ = false;
+    preallocated_ = false;
+#ifdef WRITE_BEHIND_SUPPORTED
+    const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+#ifdef O_DIRECT
+    if(options_.direct)
+    {
+        // Refused by some file systems, e.g. tmpfs
+        fd_ = ::open(filename.c_str(), flags | O_DIRECT, 0644);
+        direct_ = fd_ >= 0;
+    }
+#endif
+    if(fd_ < 0)
+    {
+        fd_ = ::open(filename.c_str(), flags, 0644);
+    }
+    if(fd_ < 0)
+    {
+        return {mcap::StatusCode::OpenFailed, "failed to open \"" + filename + "\""};
+    }
+    direct_writes_ = direct_;
+#ifdef __linux__
+    if(options_.preallocate && size_hint > 0)
+    {
+        // The size of the file stays the size written
+        preallocated_ = ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, off_t(size_hint)) == 0;
+    }
+#else
+    (void)size_hint;
+#endif
+
+    blocks_.resize(options_.blocks);
+    for(unsigned index = 0; index < options_.blocks; index++)
+    {
+        auto& block = blocks_[index];
+        if(!block.data)
+        {
+            block.data.reset(static_cast<std::byte*>(
+                ::operator new(size_t(options_.block_size), std::align_val_t(ALIGNMENT))));
+        }
+        block.size = 0;
+        free_.push_back(index);
+    }
+    startBlocks(filename, options_.block_size);
+    thread_ = std::thread(&WriteBehindWriter::writeBlocks, this);
+    return {};
+#else
+    (void)size_hint;
+    return {mcap::StatusCode::OpenFailed, "write-behind files are not supported"};
+#endif
+}
+
+void WriteBehindWriter::end()
+{
+    if(fd_ < 0)
+    {
+        return;
+    }
+    stopBlocks();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closing_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+
+#ifdef WRITE_BEHIND_SUPPORTED
+    // Frees the space allocated past the end
+    if(preallocated_ && ::ftruncate(fd_, off_t(size())) != 0)
+    {
+        fail("truncate", errno);
+    }
+    if(options_.sync != FileSync::None && ::fsync(fd_) != 0)
+    {
+        fail("sync", errno);
+    }
+    if(::close(fd_) != 0)
+    {
+        fail("close", errno);
+    }
+#endif
+    fd_ = -1;
+    blocks_.clear();
+}
+
+std::byte* WriteBehindWriter::nextBlock()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return !free_.empty(); });
+    current_ = int(free_.back());
+    free_.pop_back();
+    return blocks_[size_t(current_)].data.get();
+}
+
+void WriteBehindWriter::writeBlock(uint64_t size)
+{
+    blocks_[size_t(current_)].size = size;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        filled_.push_back(unsigned(current_));
+    }
+    changed_.notify_all();
+    current_ = -1;
+}
+
+void WriteBehindWriter::writeBlocks()
+{
+    // After an error the blocks are only given back, the file is incomplete
+    bool ok = true;
+    for(;;)
+    {
+        unsigned index = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this] { return !filled_.empty() || closing_; });
+            if(filled_.empty())
+            {
+                return;
+            }
+            index = filled_.front();
+            filled_.pop_front();
+        }
+        ok = ok && writeToFile(blocks_[index]);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(index);
+        }
+        changed_.notify_all();
+    }
+}
+
+bool WriteBehindWriter::writeToFile(const Block& block)
+{
+#ifdef WRITE_BEHIND_SUPPORTED
+#ifdef O_DIRECT
+    if(direct_writes_ && block.size % ALIGNMENT != 0)
+    {
+        direct_writes_ = !clearDirect(fd_);
+    }
+#endif
+    uint64_t done = 0;
+    while(done < block.size)
+    {
+        const ssize_t result = ::pwrite(fd_, block.data.get() + done, size_t(block.size - done),
+                                        off_t(offset_ + done));
+        if(result < 0 && errno == EINTR)
+        {
+            continue;
+        }
+#ifdef O_DIRECT
+        if(result < 0 && errno == EINVAL && direct_writes_ && clearDirect(fd_))
+        {
+            // Opened, but not written with O_DIRECT (e.g. some network file systems)
+            direct_writes_ = false;
+            continue;
+        }
+#endif
+        if(result <= 0)
+        {
+            fail("write", result < 0 ? errno : EIO);
+            return false;
+        }
+        done += uint64_t(result);
+    }
+    offset_ += block.size;
+    unsynced_ += block.size;
+    if(options_.sync == FileSync::Interval && unsynced_ >= options_.sync_interval)
+    {
+        unsynced_ = 0;
+        if(syncData(fd_) != 0)
+        {
+            fail("sync", errno);
+            return false;
+        }
+    }
+    return true;
+#else
+    (void)block;
+    return false;
+#endif
+}
+
+}  // namespace mcap_editor
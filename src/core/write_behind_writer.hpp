@@ -0,0 +1,108 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "block_writer.hpp"
+
+namespace mcap_editor
+{
+
+// When WriteBehindWriter makes the file durable
+enum class FileSync
+{
+    // Left to the system
+    None,
+    // Once everything is written, before the file is closed
+    Close,
+    // Also every sync_interval bytes, so that the dirty pages never pile up
+    Interval
+};
+
+struct WriteBehindOptions
+{
+    // Size of each write, rounded up to a multiple of WriteBehindWriter::ALIGNMENT
+    uint64_t block_size = 8 * 1024 * 1024;
+    // Blocks filled while the others are written (2 = double buffering)
+    unsigned blocks = 2;
+    // Bypass the page cache (O_DIRECT), where the file system allows it
+    bool direct = false;
+    // Allocate the disk space of the estimated size of the output up front
+    // (Linux), so that the file is not fragmented as it grows
+    bool preallocate = false;
+    FileSync sync = FileSync::None;
+    uint64_t sync_interval = 256 * 1024 * 1024;
+};
+
+// BlockWriter writing large aligned blocks in order from a background thread,
+// which can bypass the page cache and sync the file as it goes. A write error
+// stops the thread from writing the next blocks, only given back.
+class WriteBehindWriter: public BlockWriter {
+public:
+
+    // Alignment of the blocks in memory and in the file, as O_DIRECT needs
+    static constexpr uint64_t ALIGNMENT = 4096;
+
+    explicit WriteBehindWriter(WriteBehindOptions options = {});
+    ~WriteBehindWriter() override;
+
+    WriteBehindWriter(const WriteBehindWriter&) = delete;
+    WriteBehindWriter& operator=(const WriteBehindWriter&) = delete;
+
+    // With options.preallocate, size_hint bytes are allocated to the file,
+    // which is cut to the size written when closed
+    mcap::Status open(const std::string& filename, uint64_t size_hint = 0);
+
+    // True if the file was opened with O_DIRECT
+    bool direct() const { return direct_; }
+
+    void end() override;
+
+protected:
+    std::byte* nextBlock() override;
+    void writeBlock(uint64_t size) override;
+
+private:
+    struct AlignedDelete
+    {
+        void operator()(std::byte* data) const;
+    };
+
+    struct Block
+    {
+        std::unique_ptr<std::byte, AlignedDelete> data;
+        uint64_t size = 0;
+    };
+
+    WriteBehindOptions options_;
+    int fd_ = -1;
+    bool direct_ = false;
+    bool preallocated_ = false;
+    std::vector<Block> blocks_;
+    // Block being filled, or -1
+    int current_ = -1;
+
+    // Shared with the writing thread
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<unsigned> filled_;
+    std::vector<unsigned> free_;
+    bool closing_ = false;
+    std::thread thread_;
+
+    // Written by the thread only
+    uint64_t offset_ = 0;
+    uint64_t unsynced_ = 0;
+    bool direct_writes_ = false;
+
+    void writeBlocks();
+    // Writes a block at offset_, false on error
+    bool writeToFile(const Block& block);
+};
+
+}  // namespace mcap_editor
@@ -0,0 +1,108 @@
+#include "export_worker.h"
+#include "file_info.hpp"
+
+namespace
+{
+// The GUI doesn't need more than this, and signals are not free
+constexpr qint64 PROGRESS_INTERVAL_MS = 50;
+}
+
+ExportWorker::ExportWorker(ExportSettings settings, QObject *parent) :
+    QObject(parent),
+    exporter_(std::move(settings.plan)),
+    input_buffer_(std::move(settings.input_buffer))
+{
+    if(!settings.merge_inputs.empty())
+    {
+        merger_ = std::make_unique<mcap_editor::Merger>(std::move(settings.merge_inputs),
+                                                        exporter_.plan());
+    }
+#ifndef USING_WASM
+    // Filled when the file was opened, if it has no summary
+    exporter_.setSummaryCache(
+        mcap_editor::SummaryCache(mcap_editor::SummaryCache::defaultDirectory()));
+#endif
+    exporter_.setProgressCallback([this](uint64_t done, uint64_t total) {
+        reportProgress(done, total);
+    });
+    if(merger_)
+    {
+#ifndef USING_WASM
+        merger_->setSummaryCache(
+            mcap_editor::SummaryCache(mcap_editor::SummaryCache::defaultDirectory()));
+#endif
+        merger_->setProgressCallback([this](uint64_t done, uint64_t total) {
+            reportProgress(done, total);
+        });
+    }
+}
+
+void ExportWorker::cancel()
+{
+    if(merger_)
+    {
+        merger_->cancel();
+    }
+    exporter_.cancel();
+}
+
+bool ExportWorker::canceled() const
+{
+    return merger_ ? merger_->canceled() : exporter_.canceled();
+}
+
+mcap_editor::SegmentedBuffer& ExportWorker::outputBuffer()
+{
+    return output_buffer_;
+}
+
+void ExportWorker::run()
+{
+    progress_timer_.start();
+    const QString error = exportFile();
+    if(error.isEmpty() && !canceled())
+    {
+        const auto& stats = merger_ ? merger_->stats() : exporter_.stats();
+        emit statistics(QString::fromStdString(stats.summary()),
+                        QString::fromStdString(stats.report()));
+    }
+    emit finished(error);
+}
+
+void ExportWorker::reportProgress(uint64_t done, uint64_t total)
+{
+    if(progress_timer_.elapsed() >= PROGRESS_INTERVAL_MS)
+    {
+        progress_timer_.restart();
+        emit progress(qint64(done), qint64(total));
+    }
+}
+
+QString ExportWorker::exportFile()
+{
+    mcap::Status status;
+    if(merger_)
+    {
+        status = merger_->run();
+    }
+    else if(!input_buffer_.isEmpty())
+    {
+        mcap::BufferReader read_buffer;
+        read_buffer.reset(reinterpret_cast<const std::byte*>(input_buffer_.data()),
+                          input_buffer_.size(), input_buffer_.size());
+        {
+            // Allocate the whole output at once, rather than while it grows
+            mcap::McapReader reader;
+            if(reader.open(read_buffer).ok() &&
+               reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan).ok())
+            {
+                output_buffer_.reserve(mcap_editor::estimateOutputSize(reader, exporter_.plan()));
+            }
+        }
+        status = exporter_.run(read_buffer, output_buffer_);
+    }
+    else {
+        status = exporter_.run();
+    }
+    return status.ok() ? QString() : QString::fromStdString(status.message);
+}
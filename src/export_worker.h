@@ -0,0 +1,72 @@
+#ifndef EXPORT_WORKER_H
+#define EXPORT_WORKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+#include "exporter.hpp"
+#include "merger.hpp"
+#include "segmented_buffer.hpp"
+
+// Everything an export needs to know, copied from the GUI so that
+// the worker never touches a widget.
+struct ExportSettings
+{
+  mcap_editor::EditPlan plan;
+  // When not empty, it replaces plan.input_file, and the output is kept
+  // in memory instead of plan.output_file (see ExportWorker::outputBuffer)
+  QByteArray input_buffer;
+  // When not empty, these files are merged into plan.output_file instead
+  // (see mcap_editor::Merger)
+  std::vector<mcap_editor::MergeInput> merge_inputs;
+};
+
+// Runs a mcap_editor::Exporter, or a mcap_editor::Merger, and reports to the GUI with signals.
+// It owns its own McapReader and McapWriter, so it can live in a separate thread.
+class ExportWorker : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit ExportWorker(ExportSettings settings, QObject *parent = nullptr);
+
+  // Thread safe: can be called while run() is executing in another thread.
+  void cancel();
+
+  bool canceled() const;
+
+  // The output of in-memory exports, see ExportSettings::input_buffer
+  mcap_editor::SegmentedBuffer& outputBuffer();
+
+public slots:
+  void run();
+
+signals:
+  // Bytes of the input file processed so far. Emitted at a bounded rate.
+  void progress(qint64 done, qint64 total);
+
+  // Emitted before finished() when the export succeeded: one line, and the
+  // table of every stage (see mcap_editor::PipelineStats)
+  void statistics(QString summary, QString report);
+
+  // error is empty on success
+  void finished(QString error);
+
+private:
+  mcap_editor::Exporter exporter_;
+  std::unique_ptr<mcap_editor::Merger> merger_;
+  QByteArray input_buffer_;
+  mcap_editor::SegmentedBuffer output_buffer_;
+  QElapsedTimer progress_timer_;
+
+  QString exportFile();
+
+  void reportProgress(uint64_t done, uint64_t total);
+};
+
+#endif // EXPORT_WORKER_H
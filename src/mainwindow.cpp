@@ -1,23 +1,118 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
-#include "bytearray_writable.hpp"
+#include "compression_dialog.h"
+#include "file_info.hpp"
+#include "topic_stats.hpp"
+#include "topic_table_model.h"
 
 #include <QSettings>
 #include <QFileDialog>
+#include <QListWidget>
+#include <QLocale>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QStatusBar>
+#include <QThread>
+#include <QTimer>
 #include <set>
 
+#ifdef USING_WASM
+#include <emscripten.h>
+
+// Downloads a file made of several pieces. The browser assembles them in a
+// Blob, so unlike QFileDialog::saveFileContent the file is never concatenated
+// in the (size limited) wasm heap.
+EM_JS(void, beginDownload, (), {
+    Module.mcapEditorDownload = [];
+});
+
+EM_JS(void, appendDownload, (const char* data, size_t size), {
+    Module.mcapEditorDownload.push(HEAPU8.slice(data, data + size));
+});
+
+EM_JS(void, finishDownload, (const char* filename), {
+    const blob = new Blob(Module.mcapEditorDownload, {type: "application/octet-stream"});
+    Module.mcapEditorDownload = null;
+    const link = document.createElement("a");
+    link.href = URL.createObjectURL(blob);
+    link.download = UTF8ToString(filename);
+    document.body.appendChild(link);
+    link.click();
+    document.body.removeChild(link);
+    setTimeout(() => URL.revokeObjectURL(link.href), 0);
+});
+#endif
+
+namespace
+{
+// Resolution of the progress bar
+constexpr int PROGRESS_STEPS = 1000;
+// Before this, the estimated time left jumps around too much to be useful
+constexpr qint64 ETA_DELAY_MS = 1000;
+// Typing pause after which the topic filter is applied
+constexpr int TOPIC_FILTER_DELAY_MS = 150;
+
+QString formatDuration(qint64 seconds)
+{
+    if(seconds < 60)
+    {
+        return QString("%1 s").arg(seconds);
+    }
+    return QString("%1 min %2 s").arg(seconds / 60).arg(seconds % 60);
+}
+
+// QDateTime stops at the millisecond: the nanoseconds after it are edited
+// apart, so that the time range keeps the precision of mcap::Timestamp
+constexpr mcap::Timestamp NS_PER_MS = 1000000;
+
+QDateTime toDateTime(mcap::Timestamp time)
+{
+    return QDateTime::fromMSecsSinceEpoch(qint64(time / NS_PER_MS));
+}
+
+int subMillisecond(mcap::Timestamp time)
+{
+    return int(time % NS_PER_MS);
+}
+
+mcap::Timestamp toTimestamp(const QDateTime& date_time, int nanoseconds)
+{
+    return mcap::Timestamp(std::max<qint64>(0, date_time.toMSecsSinceEpoch())) * NS_PER_MS +
+           mcap::Timestamp(nanoseconds);
+}
+}
+
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
-    ui->tableTopics->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    topic_model_ = new TopicTableModel(this);
+    ui->tableTopics->setModel(topic_model_);
+    ui->tableTopics->sortByColumn(TopicTableModel::COLUMN_TOPIC, Qt::AscendingOrder);
+    ui->tableTopics->horizontalHeader()->setSectionResizeMode(TopicTableModel::COLUMN_TOPIC,
+                                                              QHeaderView::Stretch);
+    // All rows have the same height, no need to measure them
+    ui->tableTopics->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    connect(ui->tableTopics->selectionModel(), &QItemSelectionModel::selectionChanged,
+            this, &MainWindow::onTopicSelectionChanged);
+
+    // The filter is applied once the user stops typing
+    topic_filter_timer_ = new QTimer(this);
+    topic_filter_timer_->setSingleShot(true);
+    topic_filter_timer_->setInterval(TOPIC_FILTER_DELAY_MS);
+    connect(topic_filter_timer_, &QTimer::timeout, this, &MainWindow::applyTopicFilter);
+
+    // Shown for the files that have some
+    ui->labelAttachments->setHidden(true);
+    ui->listAttachments->setHidden(true);
 
 #ifdef USING_WASM
     ui->buttonLoad->setText("Upload an MCAP");
     ui->buttonSave->setText("Save and Download");
+    // Merges read their inputs from disk
+    ui->buttonMerge->setHidden(true);
 #else
     ui->horizontalWidgetSaveAs->setHidden(true);
 #endif
@@ -25,6 +120,15 @@ MainWindow::MainWindow(QWidget *parent) :
 
 MainWindow::~MainWindow()
 {
+    if(export_worker_)
+    {
+        export_worker_->cancel();
+    }
+    if(export_thread_)
+    {
+        export_thread_->quit();
+        export_thread_->wait();
+    }
     delete ui;
 }
 
@@ -45,8 +149,11 @@ void MainWindow::openFile()
         dir = QFileInfo(filename).absolutePath();
         settings.setValue("MainWindow.lastDirectoryLoad", dir);
 
+        // Only the summary is read here, mostly from the end of the file
         mcap::McapReader reader;
-        auto res = reader.open(filename.toStdString());
+        mcap_editor::MmapReader mmap_reader;
+        auto res = mcap_editor::openFile(reader, mmap_reader, filename.toStdString(),
+                                         mcap_editor::MmapReader::AccessPattern::Random);
         if(!res.ok())
         {
             QMessageBox::warning(this, "Error opening file",
@@ -88,7 +195,7 @@ void MainWindow::openFileWASM()
                                     fileContentReady);
 }
 
-void MainWindow::saveFile(mcap::McapWriterOptions options)
+void MainWindow::saveFile(ExportSettings export_settings)
 {
     QSettings settings;
     QString dir = settings.value("MainWindow.lastDirectorySave",
@@ -99,6 +206,7 @@ void MainWindow::saveFile(mcap::McapWriterOptions options)
 
     if(filename.isEmpty())
     {
+        ui->buttonSave->setText("Save");
         return;
     }
     if(QFileInfo(filename).suffix() != "mcap")
@@ -108,28 +216,15 @@ void MainWindow::saveFile(mcap::McapWriterOptions options)
     dir = QFileInfo(filename).absolutePath();
     settings.setValue("MainWindow.lastDirectorySave", dir);
 
-    // Read and write loop
-
-    mcap::McapWriter writer;
-    auto status = writer.open(filename.toStdString(), options);
-    if (!status.ok())
-    {
-        QMessageBox::warning(this, "Error opening file",
-                             "Can't open the file for writing");
-        return;
-    }
-    writeMCAP(writer);
+    // Read and write loop, in a separate thread
+    export_settings.plan.output_file = filename.toStdString();
+    startExport(std::move(export_settings));
 }
 
-void MainWindow::saveFileWASM(mcap::McapWriterOptions options)
+void MainWindow::saveFileWASM(ExportSettings export_settings)
 {
-    ByteArrayInterface array;
-    mcap::McapWriter writer;
-    writer.open(array, options);
-
-    writeMCAP(writer);
-
-    QFileDialog::saveFileContent(array.byteArray(), ui->lineEditSaveAs->text());
+    // The output is kept in memory and downloaded in onExportFinished()
+    startExport(std::move(export_settings));
 }
 
 void MainWindow::on_buttonLoad_clicked()
@@ -143,23 +238,11 @@ void MainWindow::on_buttonLoad_clicked()
 
 void MainWindow::on_buttonSave_clicked()
 {
-    mcap::McapWriterOptions options(profile_);
-    if(ui->radioLZ4->isChecked()) {
-        options.compression = mcap::Compression::Lz4;
-    }
-    else if(ui->radioZSTD->isChecked()) {
-        options.compression = mcap::Compression::Zstd;
-    }
-    else {
-        options.compression = mcap::Compression::None;
-    }
-
+    saveCompressionOption();
 #ifdef USING_WASM
-    saveFileWASM(options);
-    ui->buttonSave->setText("Save and Download");
+    saveFileWASM(exportSettings());
 #else
-    saveFile(options);
-    ui->buttonSave->setText("Save");
+    saveFile(exportSettings());
 #endif
 }
 
@@ -171,19 +254,24 @@ void MainWindow::on_buttonSave_pressed()
 
 void MainWindow::readMCAP(mcap::McapReader& reader)
 {
-    profile_ = reader.header()->profile;
     ui->lineProfile->setText({});
 
-    ui->tableTopics->clearContents();
-    ui->tableTopics->model()->removeRows(0, ui->tableTopics->rowCount());
-    ui->tableTopics->setRowCount(0);
+    topic_model_->clear();
+    ui->listAttachments->clear();
+    ui->labelAttachments->setHidden(true);
+    ui->listAttachments->setHidden(true);
 
-    schema_by_id_.clear();
-    schema_id_by_channel_.clear();
-    channel_encoding_.clear();
     ui->widgetSave->setEnabled(false);
 
-    auto status = reader.readSummary(mcap::ReadSummaryMethod::AllowFallbackScan);
+#ifdef USING_WASM
+    auto status = mcap_editor::readFileInfo(reader, file_info_);
+#else
+    // Files without summary are scanned by every core, once: their summary is
+    // then kept in the cache shared with mcap_editor_cli
+    const mcap_editor::SummaryCache cache(mcap_editor::SummaryCache::defaultDirectory());
+    auto status = mcap_editor::readFileInfo(reader, file_info_, QThread::idealThreadCount(),
+                                            &cache, file_opened_.toStdString());
+#endif
 
     if(!status.ok())
     {
@@ -191,59 +279,41 @@ void MainWindow::readMCAP(mcap::McapReader& reader)
                              QString::fromStdString(status.message));
         return;
     }
+    ui->lineProfile->setText(QString::fromStdString(file_info_.profile));
+    restoreCompressionOption();
 
-    auto stats_pt = reader.statistics();
-    if (!stats_pt)
-    {
-        QMessageBox::warning(this, "Error opening file",
-                             "Can't read file statistics");
-        return;
-    }
-    ui->lineProfile->setText(QString::fromStdString(reader.header()->profile));
-
-    const auto& statistics = stats_pt.value();
-    time_start_ = statistics.messageStartTime;
-    time_end_ = statistics.messageEndTime;
-
-    for (const auto& [schema_id, schema] : reader.schemas())
-    {
-        std::string schema_str(reinterpret_cast<const char*>(schema->data.data()),
-                               schema->data.size());
+    // From the message indexes only, nothing is decompressed. Files without
+    // them leave the columns empty.
+    mcap_editor::TopicStatsMap topic_stats;
+#ifdef USING_WASM
+    (void)mcap_editor::computeTopicStats(reader, topic_stats);
+#else
+    (void)mcap_editor::computeTopicStats(reader, topic_stats, QThread::idealThreadCount());
+#endif
 
-        SchemaInfo info = {schema->name, schema->encoding, schema_str};
-        schema_by_id_[schema_id] = info;
-    }
+    // The model keeps the topics, file_info_ the rest
+    topic_model_->setTopics(std::move(file_info_.topics), topic_stats);
+    file_info_.topics.clear();
 
-    for (const auto& [channel_id, channel] : reader.channels())
+    // All checked: every attachment is copied unless unchecked
+    const QLocale locale;
+    for(const auto& attachment: file_info_.attachments)
     {
-        const auto schema = reader.schemas().at(channel->schemaId);
-        const auto channel_name = QString::fromStdString(channel->topic);
-        const auto schema_name = QString::fromStdString(schema->name);
-        const auto encoding = QString::fromStdString(channel->messageEncoding);
-        uint64_t msg_count = 0;
-        {
-            auto it =  statistics.channelMessageCounts.find(channel_id);
-            if( it != statistics.channelMessageCounts.end())
-            {
-                msg_count = it->second;
-            }
-        }
-
-        const int row = ui->tableTopics->rowCount();
-        ui->tableTopics->insertRow (row);
-        auto channel_item = new QTableWidgetItem(channel_name);
-        channel_item->setCheckState(Qt::Checked);
-        ui->tableTopics->setItem(row, 0, channel_item);
-        ui->tableTopics->setItem(row, 1, new QTableWidgetItem(schema_name));
-        ui->tableTopics->setItem(row, 2, new QTableWidgetItem(encoding));
-        ui->tableTopics->setItem(row, 3, new QTableWidgetItem(QString::number(msg_count)));
-
-        schema_id_by_channel_[channel->topic] = channel->schemaId;
-        channel_encoding_[channel->topic] = channel->messageEncoding;
+        const auto name = QString::fromStdString(attachment.name);
+        auto* item = new QListWidgetItem(
+            QString("%1 (%2, %3)").arg(name, QString::fromStdString(attachment.media_type),
+                                       locale.formattedDataSize(qint64(attachment.data_size))),
+            ui->listAttachments);
+        item->setData(Qt::UserRole, name);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
     }
+    ui->labelAttachments->setHidden(file_info_.attachments.empty());
+    ui->listAttachments->setHidden(file_info_.attachments.empty());
 
-    auto start_date = QDateTime::fromMSecsSinceEpoch(time_start_ / 1000000);
-    auto end_date = QDateTime::fromMSecsSinceEpoch(1 + time_end_ / 1000000);
+    // The end of the range is exclusive
+    auto start_date = toDateTime(file_info_.start_time);
+    auto end_date = toDateTime(file_info_.end_time + 1);
     bool is_date = start_date.date() > QDate(1999, 1, 1) &&
                    end_date.date() > QDate(1999, 1, 1);
 
@@ -254,11 +324,11 @@ void MainWindow::readMCAP(mcap::McapReader& reader)
         if(!is_date)
         {
             edit->setTimeSpec(Qt::TimeSpec::UTC);
-            edit->setDisplayFormat("H:mm:ss");
+            edit->setDisplayFormat("H:mm:ss.zzz");
         }
         else {
             edit->setTimeSpec(Qt::TimeSpec::LocalTime);
-            edit->setDisplayFormat("yyyy/M/d - H:mm:ss");
+            edit->setDisplayFormat("yyyy/M/d - H:mm:ss.zzz");
         }
     }
 
@@ -267,10 +337,13 @@ void MainWindow::readMCAP(mcap::McapReader& reader)
     on_buttonResetTimeRange_clicked();
 
     auto horizontalHeader = ui->tableTopics->horizontalHeader();
-    horizontalHeader->setSectionResizeMode(0, QHeaderView::ResizeToContents);
-    horizontalHeader->setSectionResizeMode(1, QHeaderView::Stretch);
-    horizontalHeader->setSectionResizeMode(2, QHeaderView::ResizeToContents);
-    horizontalHeader->setSectionResizeMode(3, QHeaderView::ResizeToContents);
+    horizontalHeader->setSectionResizeMode(TopicTableModel::COLUMN_TOPIC,
+                                           QHeaderView::ResizeToContents);
+    horizontalHeader->setSectionResizeMode(TopicTableModel::COLUMN_SCHEMA, QHeaderView::Stretch);
+    for(int column = TopicTableModel::COLUMN_ENCODING; column < TopicTableModel::COLUMNS; column++)
+    {
+        horizontalHeader->setSectionResizeMode(column, QHeaderView::ResizeToContents);
+    }
 
     ui->widgetSave->setEnabled(true);
 }
@@ -282,9 +355,11 @@ void MainWindow::on_buttonResetTimeRange_clicked()
 
     ui->dateTimeStartNew->setDateTime(start);
     ui->dateTimeEndNew->setDateTime(end);
+    ui->spinBoxStartNewNs->setValue(subMillisecond(file_info_.start_time));
+    ui->spinBoxEndNewNs->setValue(subMillisecond(file_info_.end_time + 1));
 }
 
-void MainWindow::on_tableTopics_itemSelectionChanged()
+void MainWindow::onTopicSelectionChanged()
 {
     QModelIndexList selection = ui->tableTopics->selectionModel()->selectedRows();
 
@@ -292,118 +367,302 @@ void MainWindow::on_tableTopics_itemSelectionChanged()
 
     if(selection.count() == 1)
     {
-        QModelIndex index = selection.front();
-        auto channel = ui->tableTopics->item(index.row(), 0)->text();
-        auto it = schema_id_by_channel_.find(channel.toStdString());
-        if( it != schema_id_by_channel_.end())
-        {
-            auto schema = QString::fromStdString(schema_by_id_.at(it->second).text);
-            ui->textSchema->setPlainText(schema);
-        }
+        const auto& schema = topic_model_->topic(selection.front().row()).schema_text;
+        ui->textSchema->setPlainText(QString::fromStdString(schema));
     }
 }
 
-void MainWindow::writeMCAP(mcap::McapWriter& writer)
+void MainWindow::on_lineEditTopicFilter_textChanged(const QString&)
+{
+    topic_filter_timer_->start();
+}
+
+void MainWindow::applyTopicFilter()
+{
+    const bool valid = topic_model_->setFilter(ui->lineEditTopicFilter->text());
+    ui->lineEditTopicFilter->setStyleSheet(valid ? QString() : QString("color: red;"));
+    ui->lineEditTopicFilter->setToolTip(valid ? QString() :
+                                                QString("Invalid regular expression"));
+}
+
+void MainWindow::on_buttonCheckAll_clicked()
 {
-    std::set<std::string> select_channels;
+    topic_model_->setAllChecked(true);
+}
 
-    for(int row=0; row<ui->tableTopics->rowCount(); row++)
+void MainWindow::on_buttonUncheckAll_clicked()
+{
+    topic_model_->setAllChecked(false);
+}
+
+void MainWindow::on_buttonAnalyzeCompression_clicked()
+{
+    CompressionDialog dialog(file_opened_, read_buffer_, this);
+    if(dialog.exec() == QDialog::Accepted)
     {
-        auto item = ui->tableTopics->item(row, 0);
-        if(item->checkState() == Qt::Checked)
-        {
-            select_channels.insert(item->text().toStdString());
-        }
+        setCompressionOption(dialog.selectedOption());
+        saveCompressionOption();
     }
+}
 
-    std::map<mcap::SchemaId, mcap::SchemaId> old_to_new_schema_id;
-    std::map<std::string, mcap::ChannelId> channel_ids_;
+void MainWindow::on_buttonMerge_clicked()
+{
+    QSettings settings;
+    const QString dir = settings.value("MainWindow.lastDirectoryLoad",
+                                       QDir::currentPath()).toString();
+    const auto filenames = QFileDialog::getOpenFileNames(
+        this, "Select the MCAP files to merge", dir, "MCAP files (*.mcap)");
+    if(filenames.isEmpty())
+    {
+        return;
+    }
+    settings.setValue("MainWindow.lastDirectoryLoad",
+                      QFileInfo(filenames.front()).absolutePath());
 
-    for(const auto& channel_name: select_channels)
+    // Every topic and the whole time range of every file
+    ExportSettings export_settings;
+    setOutputOptions(export_settings.plan);
+    for(const auto& filename: filenames)
     {
-        auto old_id = schema_id_by_channel_.at(channel_name);
-        auto it = old_to_new_schema_id.find(old_id);
-        // add if missing
-        if( it == old_to_new_schema_id.end()) {
-            const auto& schema = schema_by_id_.at(old_id);
-            mcap::Schema mcap_schema(schema.name, schema.encoding, schema.text);
-            writer.addSchema(mcap_schema);
-            it = old_to_new_schema_id.insert({old_id, mcap_schema.id}).first;
-        }
-        mcap::SchemaId new_schema_id = it->second;
+        export_settings.merge_inputs.push_back({filename.toStdString(), 0});
+    }
+    saveFile(std::move(export_settings));
+}
 
-        mcap::Channel channel(channel_name,
-                              channel_encoding_.at(channel_name),
-                              new_schema_id);
-        writer.addChannel(channel);
-        channel_ids_.insert({channel.topic, channel.id});
+mcap_editor::CompressionOption MainWindow::compressionOption() const
+{
+    mcap_editor::CompressionOption option;
+    if(ui->radioLZ4->isChecked()) {
+        option.compression = mcap::Compression::Lz4;
+    }
+    else if(ui->radioZSTD->isChecked()) {
+        option.compression = mcap::Compression::Zstd;
+    }
+    else {
+        option.compression = mcap::Compression::None;
     }
-    mcap::ReadMessageOptions options;
-    mcap::ProblemCallback problem = [](const mcap::Status&) {};
-    options.topicFilter = [&select_channels](std::string_view name) -> bool
+    // The items follow the order of mcap::CompressionLevel
+    option.level = mcap::CompressionLevel(ui->comboLevel->currentIndex());
+    option.chunk_size = uint64_t(ui->spinBoxChunkSize->value()) * 1024;
+    return option;
+}
+
+void MainWindow::setCompressionOption(const mcap_editor::CompressionOption& option)
+{
+    switch(option.compression)
     {
-        return select_channels.count(std::string(name)) != 0;
-    };
+    case mcap::Compression::Lz4: ui->radioLZ4->setChecked(true); break;
+    case mcap::Compression::Zstd: ui->radioZSTD->setChecked(true); break;
+    case mcap::Compression::None: ui->radioNone->setChecked(true); break;
+    }
+    ui->comboLevel->setCurrentIndex(int(option.level));
+    ui->spinBoxChunkSize->setValue(int(option.chunk_size / 1024));
+}
+
+void MainWindow::saveCompressionOption() const
+{
+    const auto option = compressionOption();
+    QSettings().setValue("MainWindow.compression." + QString::fromStdString(file_info_.profile),
+                         QVariantList{int(option.compression), int(option.level),
+                                      qulonglong(option.chunk_size)});
+}
 
-    if(ui->dateTimeStart->dateTime() != ui->dateTimeStartNew->dateTime())
+void MainWindow::restoreCompressionOption()
+{
+    const auto values = QSettings().value("MainWindow.compression." +
+                                          QString::fromStdString(file_info_.profile)).toList();
+    // Otherwise, the widgets keep the last option used
+    if(values.size() == 3)
     {
-        options.startTime = ui->dateTimeStartNew->dateTime().toMSecsSinceEpoch() * 1000000;
+        mcap_editor::CompressionOption option;
+        option.compression = mcap::Compression(values[0].toInt());
+        option.level = mcap::CompressionLevel(values[1].toInt());
+        option.chunk_size = values[2].toULongLong();
+        setCompressionOption(option);
     }
-    if(ui->dateTimeEnd->dateTime() != ui->dateTimeEndNew->dateTime())
+}
+
+void MainWindow::setOutputOptions(mcap_editor::EditPlan& plan) const
+{
+    const auto option = compressionOption();
+    plan.compression = option.compression;
+    plan.compression_level = option.level;
+    plan.chunk_size = option.chunk_size;
+    plan.copy_chunks = ui->checkBoxPassthrough->isChecked();
+    plan.chunk_grouping.automatic = ui->checkBoxGroupChunks->isChecked();
+    // Decoded messages are written in log time order, the chunks read ahead
+    plan.log_time_order = true;
+#ifndef USING_WASM
+    // Keep a couple of chunks per core in flight
+    plan.read_ahead_chunks = 2 * std::max(1, QThread::idealThreadCount());
+    // Chunks are compressed in parallel, while the export thread keeps reading
+    plan.compression_threads = std::max(1, QThread::idealThreadCount() - 1);
+#endif
+}
+
+ExportSettings MainWindow::exportSettings() const
+{
+    ExportSettings settings;
+    auto& plan = settings.plan;
+    plan.input_file = file_opened_.toStdString();
+    settings.input_buffer = read_buffer_;
+    setOutputOptions(plan);
+
+    // Without a channel list, every channel is kept
+    if(topic_model_->checkedCount() != topic_model_->topicCount())
     {
-        options.endTime = ui->dateTimeEndNew->dateTime().toMSecsSinceEpoch() * 1000000;
+        plan.channels = topic_model_->checkedChannels();
     }
 
-    QProgressDialog progress("Please wait, this may take a while...", "Cancel", 0, 0, this);
-    progress.setWindowTitle("Saving file");
-    progress.setWindowModality(Qt::WindowModal);
-    progress.show();
+    // Attachments are selected by name: one of several sharing a name keeps
+    // them all
+    std::set<std::string> attachments;
+    bool all_attachments = true;
+    for(int row = 0; row < ui->listAttachments->count(); row++)
+    {
+        const auto* item = ui->listAttachments->item(row);
+        if(item->checkState() == Qt::Checked)
+        {
+            attachments.insert(item->data(Qt::UserRole).toString().toStdString());
+        }
+        else {
+            all_attachments = false;
+        }
+    }
+    if(!all_attachments)
+    {
+        plan.attachments = std::move(attachments);
+    }
+
+    // Only an edited range trims: the whole file is kept otherwise
+    const auto start_time = toTimestamp(ui->dateTimeStartNew->dateTime(),
+                                        ui->spinBoxStartNewNs->value());
+    const auto end_time = toTimestamp(ui->dateTimeEndNew->dateTime(),
+                                      ui->spinBoxEndNewNs->value());
+    if(start_time != file_info_.start_time)
+    {
+        plan.start_time = start_time;
+    }
+    if(end_time != file_info_.end_time + 1)
+    {
+        plan.end_time = end_time;
+    }
+    return settings;
+}
+
+void MainWindow::startExport(ExportSettings settings)
+{
+    auto worker = new ExportWorker(std::move(settings));
+    export_worker_ = worker;
+
+    export_progress_ = new QProgressDialog("Please wait, this may take a while...",
+                                           "Cancel", 0, PROGRESS_STEPS, this);
+    export_progress_->setWindowTitle("Saving file");
+    export_progress_->setWindowModality(Qt::WindowModal);
+    export_progress_->setAutoClose(false);
+    export_progress_->setAutoReset(false);
+    export_progress_->setMinimumDuration(0);
+    export_progress_->setValue(0);
+    // Merges don't need a file to be loaded
+    save_enabled_ = ui->widgetSave->isEnabled();
+    ui->widgetSave->setEnabled(false);
+    export_timer_.start();
+
+    // cancel() is thread safe, no need to go through the event loop of the worker
+    connect(export_progress_, &QProgressDialog::canceled,
+            worker, [worker]() { worker->cancel(); }, Qt::DirectConnection);
+    connect(worker, &ExportWorker::progress, this, &MainWindow::onExportProgress);
+    connect(worker, &ExportWorker::statistics, this, &MainWindow::onExportStatistics);
+    connect(worker, &ExportWorker::finished, this, &MainWindow::onExportFinished);
 
-    mcap::McapReader reader;
 #ifdef USING_WASM
-    mcap::BufferReader read_buffer;
-    read_buffer.reset(reinterpret_cast<const std::byte*>(read_buffer_.data()),
-                 read_buffer_.size(), read_buffer_.size());
-    auto read_stat = reader.open(read_buffer);
+    // No threads in the browser: run the export here, and keep the GUI alive
+    // when the worker reports its progress.
+    connect(worker, &ExportWorker::progress, this, []() {
+        QCoreApplication::processEvents();
+    });
+    worker->run();
 #else
-    auto res = reader.open(file_opened_.toStdString());
+    auto thread = new QThread(this);
+    export_thread_ = thread;
+    worker->moveToThread(thread);
+    connect(thread, &QThread::started, worker, &ExportWorker::run);
+    connect(worker, &ExportWorker::finished, thread, &QThread::quit);
+    connect(thread, &QThread::finished, worker, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
 #endif
+}
 
-    int count = 0;
+void MainWindow::onExportProgress(qint64 done, qint64 total)
+{
+    if(!export_progress_ || total <= 0)
+    {
+        return;
+    }
+    done = std::min(done, total);
+    export_progress_->setValue(int(PROGRESS_STEPS * done / total));
+
+    // Bytes of the input file, the time left assumes that the rest goes as fast
+    const QLocale locale;
+    QString text = QString("Processed %1 of %2")
+                       .arg(locale.formattedDataSize(done), locale.formattedDataSize(total));
+    const qint64 elapsed_ms = export_timer_.elapsed();
+    if(elapsed_ms >= ETA_DELAY_MS && done > 0)
+    {
+        const double bytes_per_ms = double(done) / double(elapsed_ms);
+        const qint64 left_ms = qint64(double(total - done) / bytes_per_ms);
+        text += QString(" (%1/s)\nAbout %2 left")
+                    .arg(locale.formattedDataSize(qint64(bytes_per_ms * 1000)),
+                         formatDuration((left_ms + 999) / 1000));
+    }
+    export_progress_->setLabelText(text);
+}
+
+void MainWindow::onExportStatistics(QString summary, QString report)
+{
+    // The details of each stage are in the tooltip
+    statusBar()->showMessage("Saved: " + summary);
+    statusBar()->setToolTip("<pre>" + report.toHtmlEscaped() + "</pre>");
+}
 
-    for (const auto& msg : reader.readMessages(problem, options))
+void MainWindow::onExportFinished(QString error)
+{
+    if(export_progress_)
     {
-        auto new_channel_id = channel_ids_.at(msg.channel->topic);
+        export_progress_->close();
+        export_progress_->deleteLater();
+        export_progress_ = nullptr;
+    }
+    ui->widgetSave->setEnabled(save_enabled_);
 
-        mcap::Message new_msg = msg.message;
-        new_msg.channelId = new_channel_id;
-        auto status = writer.write(new_msg);
-        if (!status.ok())
-        {
-            QMessageBox::warning(this, "Error writing file",
-                                 "Can't write a message");
-            break;
-        }
-        if(count++ % 100 == 0)
-        {
-            QCoreApplication::processEvents();
-        }
-        if (progress.wasCanceled())
+    if(!error.isEmpty())
+    {
+        QMessageBox::warning(this, "Error writing file", error);
+    }
+
+#ifdef USING_WASM
+    if(export_worker_)
+    {
+        if(error.isEmpty() && !export_worker_->canceled())
         {
-            break;
+            // Each block is freed as soon as the browser has a copy
+            beginDownload();
+            export_worker_->outputBuffer().drain([](const std::byte* data, uint64_t size) {
+                appendDownload(reinterpret_cast<const char*>(data), size);
+            });
+            finishDownload(ui->lineEditSaveAs->text().toUtf8().constData());
         }
+        export_worker_->deleteLater();
     }
-    progress.close();
+    ui->buttonSave->setText("Save and Download");
+#else
+    ui->buttonSave->setText("Save");
+#endif
 }
 
 void MainWindow::on_buttonToggleSelected_clicked()
 {
-    for(auto item: ui->tableTopics->selectedItems())
-    {
-        if(item->column() == 0)
-        {
-            item->setCheckState( (item->checkState() == Qt::Unchecked) ? Qt::Checked : Qt::Unchecked);
-        }
-    }
+    topic_model_->toggleChecked(ui->tableTopics->selectionModel()->selectedRows());
 }
 
@@ -2,11 +2,22 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QElapsedTimer>
+#include <QPointer>
 #include <set>
 
 #include <mcap/writer.hpp>
 #include <mcap/reader.hpp>
 
+#include "compression_analysis.hpp"
+#include "export_worker.h"
+#include "file_info.hpp"
+
+class QProgressDialog;
+class QThread;
+class QTimer;
+class TopicTableModel;
+
 namespace Ui {
 class MainWindow;
 }
@@ -24,7 +35,15 @@ private slots:
 
   void on_buttonResetTimeRange_clicked();
 
-  void on_tableTopics_itemSelectionChanged();
+  void onTopicSelectionChanged();
+
+  void on_lineEditTopicFilter_textChanged(const QString& text);
+
+  void applyTopicFilter();
+
+  void on_buttonCheckAll_clicked();
+
+  void on_buttonUncheckAll_clicked();
 
   void on_buttonSave_clicked();
 
@@ -32,37 +51,54 @@ private slots:
 
   void on_buttonSave_pressed();
 
+  void on_buttonAnalyzeCompression_clicked();
+
+  void on_buttonMerge_clicked();
+
+  void onExportProgress(qint64 done, qint64 total);
+
+  void onExportStatistics(QString summary, QString report);
+
+  void onExportFinished(QString error);
+
   private:
   Ui::MainWindow *ui;
 
   void openFile();
   void openFileWASM();
 
-  void saveFile(mcap::McapWriterOptions options);
-  void saveFileWASM(mcap::McapWriterOptions options);
+  void saveFile(ExportSettings settings);
+  void saveFileWASM(ExportSettings settings);
 
   void readMCAP(mcap::McapReader &reader);
-  void writeMCAP(mcap::McapWriter& writer);
 
-  struct SchemaInfo
-  {
-      std::string name;
-      std::string encoding;
-      std::string text;
-  };
-
-  std::map<mcap::SchemaId, SchemaInfo> schema_by_id_;
-  std::map<std::string, mcap::SchemaId> schema_id_by_channel_;
-  std::map<std::string, std::string> channel_encoding_;
-
-  uint64_t time_start_;
-  uint64_t time_end_;
+  ExportSettings exportSettings() const;
+  // Compression, chunks and threads of the output, from the widgets
+  void setOutputOptions(mcap_editor::EditPlan& plan) const;
+
+  // Codec, level and chunk size of the widgets
+  mcap_editor::CompressionOption compressionOption() const;
+  void setCompressionOption(const mcap_editor::CompressionOption& option);
+  // Remembered per profile, since files of a profile compress alike
+  void saveCompressionOption() const;
+  void restoreCompressionOption();
+  void startExport(ExportSettings settings);
+
+  // Without its topics, which are in topic_model_
+  mcap_editor::FileInfo file_info_;
+  TopicTableModel* topic_model_ = nullptr;
+  QTimer* topic_filter_timer_ = nullptr;
   std::string wasm_buffer_;
-  std::string profile_;
 
   QByteArray read_buffer_;
 
   QString file_opened_;
+
+  QPointer<ExportWorker> export_worker_;
+  QPointer<QThread> export_thread_;
+  QProgressDialog* export_progress_ = nullptr;
+  QElapsedTimer export_timer_;
+  bool save_enabled_ = false;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,333 @@
+// Checks that Exporter, Splitter and Merger write every message of files
+// mixing chunks with and without message indexes, whatever the threads and
+// read order asked: the indexed reader would skip the chunks without. Also
+// checks the time windows of Splitter on files read in either order.
+
+#include "exporter.hpp"
+#include "merger.hpp"
+#include "message_copy.hpp"
+#include "splitter.hpp"
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr int BLOCKS = 10;
+constexpr int BLOCK_MESSAGES = 10;
+
+class VectorWriter: public mcap::IWritable {
+public:
+
+    std::vector<std::byte> data;
+
+    void end() override {}
+
+    uint64_t size() const override { return data.size(); }
+
+protected:
+    void handleWrite(const std::byte* bytes, uint64_t size) override
+    {
+        data.insert(data.end(), bytes, bytes + size);
+    }
+};
+
+enum class Indexes
+{
+    All,
+    Mixed,
+    None,
+};
+
+// Blocks of messages on two channels, each in chunks of its own. With
+// message indexes, a block is written by the writer; without, it is copied
+// as a chunk of hand-made records, which the chunk index lists but no
+// message index does. Reversed, the log times go backwards.
+std::vector<std::byte> makeFile(Indexes indexes, bool reversed = false)
+{
+    mcap::McapWriterOptions options("test");
+    options.compression = mcap::Compression::None;
+    options.chunkSize = 200;
+    VectorWriter output;
+    mcap::McapWriter writer;
+    writer.open(output, options);
+    mcap::Schema schema("schema", "raw", "");
+    writer.addSchema(schema);
+    mcap::Channel channel_a("/a", "raw", schema.id);
+    mcap::Channel channel_b("/b", "raw", schema.id);
+    writer.addChannel(channel_a);
+    writer.addChannel(channel_b);
+
+    const char payload[] = "payload";
+    uint32_t index = 0;
+    for(int block = 0; block < BLOCKS; block++)
+    {
+        const bool indexed =
+            indexes == Indexes::All || (indexes == Indexes::Mixed && block % 2 == 0);
+        VectorWriter records;
+        if(!indexed && block == 0)
+        {
+            // The writer only writes them ahead of the messages it indexes
+            mcap::McapWriter::write(records, schema);
+            mcap::McapWriter::write(records, channel_a);
+            mcap::McapWriter::write(records, channel_b);
+        }
+        mcap::Timestamp start_time = mcap::MaxTime;
+        mcap::Timestamp end_time = 0;
+        for(int i = 0; i < BLOCK_MESSAGES; i++, index++)
+        {
+            mcap::Message message;
+            message.channelId = index % 2 == 0 ? channel_a.id : channel_b.id;
+            message.sequence = index;
+            message.logTime = 1000 + (reversed ? BLOCKS * BLOCK_MESSAGES - 1 - index : index) * 10;
+            start_time = std::min(start_time, message.logTime);
+            end_time = std::max(end_time, message.logTime);
+            message.publishTime = message.logTime;
+            message.data = reinterpret_cast<const std::byte*>(payload);
+            message.dataSize = sizeof(payload);
+            if(indexed)
+            {
+                (void)writer.write(message);
+            }
+            else {
+                mcap::McapWriter::write(records, message);
+            }
+        }
+        if(!indexed)
+        {
+            mcap::Chunk chunk;
+            chunk.messageStartTime = start_time;
+            chunk.messageEndTime = end_time;
+            chunk.uncompressedSize = records.data.size();
+            chunk.uncompressedCrc = 0;
+            chunk.compression = "";
+            chunk.compressedSize = records.data.size();
+            chunk.records = records.data.data();
+            (void)writer.copyChunk(chunk, {});
+        }
+    }
+    writer.close();
+    return std::move(output.data);
+}
+
+// The messages of a file, and whether they are in log time order
+struct Messages
+{
+    uint64_t count = 0;
+    bool ordered = true;
+};
+
+Messages readMessages(mcap::IReadable& source)
+{
+    Messages messages;
+    mcap::McapReader reader;
+    if(!reader.open(source).ok())
+    {
+        return messages;
+    }
+    mcap::Timestamp last_time = 0;
+    for(const auto& msg: reader.readMessages())
+    {
+        messages.count++;
+        messages.ordered = messages.ordered && msg.message.logTime >= last_time;
+        last_time = msg.message.logTime;
+    }
+    return messages;
+}
+
+Messages readMessages(const std::vector<std::byte>& data)
+{
+    mcap::BufferReader source;
+    source.reset(data.data(), data.size(), data.size());
+    return readMessages(source);
+}
+
+Messages readMessages(const std::string& filename)
+{
+    mcap::McapReader reader;
+    if(!reader.open(filename).ok())
+    {
+        return {};
+    }
+    return readMessages(*reader.dataSource());
+}
+
+void writeFile(const std::string& filename, const std::vector<std::byte>& data)
+{
+    std::FILE* file = std::fopen(filename.c_str(), "wb");
+    if(file)
+    {
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fclose(file);
+    }
+}
+
+// The plans tried on each file: decoding every chunk, in file or log time
+// order, with and without read-ahead, grouped, and with a topic dropped
+std::vector<std::pair<std::string, mcap_editor::EditPlan>> plans()
+{
+    std::vector<std::pair<std::string, mcap_editor::EditPlan>> plans;
+    mcap_editor::EditPlan plan;
+    plan.copy_chunks = false;
+    plans.emplace_back("decoded", plan);
+    plan.read_ahead_chunks = 8;
+    plan.decompression_threads = 4;
+    plans.emplace_back("decoded, read-ahead", plan);
+    plan.log_time_order = true;
+    plans.emplace_back("decoded in log time order, read-ahead", plan);
+    plan.chunk_grouping.automatic = true;
+    plans.emplace_back("grouped in log time order, read-ahead", plan);
+    plan.topics = std::set<std::string>{"/a"};
+    plans.emplace_back("one topic in log time order, read-ahead", plan);
+    return plans;
+}
+
+}  // namespace
+
+int main()
+{
+    const auto directory =
+        std::filesystem::temp_directory_path() / "mcap_editor_message_copy_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    int failures = 0;
+    auto check = [&](const std::string& name, bool success)
+    {
+        std::printf("%s %s\n", success ? "ok" : "FAIL", name.c_str());
+        failures += success ? 0 : 1;
+    };
+
+    const std::pair<const char*, Indexes> files[] = {
+        {"indexed", Indexes::All},
+        {"mixed", Indexes::Mixed},
+        {"unindexed", Indexes::None},
+    };
+    constexpr uint64_t ALL = BLOCKS * BLOCK_MESSAGES;
+    const auto other_file = (directory / "other.mcap").string();
+    writeFile(other_file, makeFile(Indexes::None));
+    for(const auto& [file_name, indexes]: files)
+    {
+        const auto data = makeFile(indexes);
+        const auto input_file = (directory / (std::string(file_name) + ".mcap")).string();
+        writeFile(input_file, data);
+
+        {
+            // Log time order only when every chunk can be read so
+            mcap::BufferReader source;
+            source.reset(data.data(), data.size(), data.size());
+            mcap::McapReader reader;
+            (void)reader.open(source);
+            (void)reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+            mcap_editor::EditPlan plan;
+            mcap_editor::ChannelSelection selection(plan);
+            mcap_editor::PipelineStats stats;
+            const auto options =
+                mcap_editor::readMessageOptions(plan, reader, true, selection, stats);
+            check(std::string(file_name) + ": read order",
+                  mcap_editor::readsInLogTimeOrder(options) == (indexes == Indexes::All));
+        }
+
+        for(const auto& [plan_name, plan]: plans())
+        {
+            const uint64_t expected = plan.topics ? ALL / 2 : ALL;
+            const std::string name = std::string(file_name) + ", " + plan_name;
+
+            mcap_editor::Exporter exporter(plan);
+            mcap::BufferReader source;
+            source.reset(data.data(), data.size(), data.size());
+            VectorWriter output;
+            const auto status = exporter.run(source, output);
+            const auto exported = readMessages(output.data);
+            // The chunks of different groups overlap in time, read in file order
+            check(name + ": export",
+                  status.ok() && exported.count == expected &&
+                      (exported.ordered || plan.chunk_grouping.enabled()));
+
+            auto split_plan = plan;
+            split_plan.input_file = input_file;
+            split_plan.output_file = (directory / "split.mcap").string();
+            mcap_editor::SplitLimits limits;
+            limits.max_bytes = 1024 * 1024;
+            mcap_editor::Splitter splitter(split_plan, limits);
+            uint64_t split = 0;
+            const bool split_ok = splitter.run().ok();
+            for(const auto& split_file: splitter.files())
+            {
+                split += readMessages(split_file).count;
+            }
+            check(name + ": split", split_ok && split == expected);
+
+            // With an input without message indexes
+            mcap_editor::Merger merger({{input_file}, {other_file}}, plan);
+            VectorWriter merge_output;
+            const bool merge_ok = merger.run(merge_output).ok();
+            const auto merged = readMessages(merge_output.data);
+            check(name + ": merge",
+                  merge_ok && merged.count == 2 * expected &&
+                      (merged.ordered || plan.chunk_grouping.enabled()));
+        }
+    }
+
+    // Time windows of 300 ns, i.e. 30 messages, from a reversed recording.
+    // With message indexes, they are exact even without summary (cut off as
+    // by an interrupted recording), found by a scan. Without, the messages
+    // after the first are late.
+    for(const auto indexes: {Indexes::All, Indexes::None})
+    {
+        auto data = makeFile(indexes, true);
+        std::string file_name = indexes == Indexes::All ? "indexed" : "unindexed";
+        if(indexes == Indexes::All)
+        {
+            mcap::BufferReader source;
+            source.reset(data.data(), data.size(), data.size());
+            mcap::McapReader reader;
+            (void)reader.open(source);
+            (void)reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan);
+            data.resize(reader.footer()->summaryStart);
+            file_name += " without summary";
+        }
+        mcap_editor::EditPlan plan;
+        plan.input_file = (directory / "reversed.mcap").string();
+        plan.output_file = (directory / "window.mcap").string();
+        writeFile(plan.input_file, data);
+        mcap_editor::SplitLimits limits;
+        limits.max_duration = 300;
+        mcap_editor::Splitter splitter(plan, limits);
+        const bool split_ok = splitter.run().ok();
+        uint64_t split = 0;
+        bool exact = true;
+        for(const auto& split_file: splitter.files())
+        {
+            split += readMessages(split_file).count;
+            mcap::McapReader reader;
+            exact = exact && reader.open(split_file).ok() &&
+                    reader.readSummary(mcap::ReadSummaryMethod::NoFallbackScan).ok() &&
+                    reader.statistics() &&
+                    reader.statistics()->messageEndTime -
+                            reader.statistics()->messageStartTime < limits.max_duration;
+        }
+        if(indexes == Indexes::All)
+        {
+            check("reversed, " + file_name + ": exact windows",
+                  split_ok && split == ALL && exact && splitter.files().size() == 4 &&
+                      splitter.lateMessages() == 0);
+        }
+        else {
+            check("reversed, " + file_name + ": late messages",
+                  split_ok && split == ALL && splitter.lateMessages() == ALL - 1);
+        }
+    }
+
+    std::filesystem::remove_all(directory);
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,346 @@
+// Checks that scanning the Data section with several threads finds the same
+// records as the sequential scan, on files made to confuse the search of the
+// Chunk records where the regions start.
+
+#include <mcap/reader.hpp>
+#include <mcap/writer.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+constexpr uint64_t MiB = 1024 * 1024;
+
+class VectorWriter: public mcap::IWritable {
+public:
+
+    std::vector<std::byte> data;
+
+    void end() override {}
+
+    uint64_t size() const override { return data.size(); }
+
+protected:
+    void handleWrite(const std::byte* bytes, uint64_t size) override
+    {
+        data.insert(data.end(), bytes, bytes + size);
+    }
+};
+
+template <typename T>
+void put(std::vector<std::byte>& data, size_t& position, T value)
+{
+    if(position + sizeof(T) <= data.size())
+    {
+        std::memcpy(data.data() + position, &value, sizeof(T));
+    }
+    position += sizeof(T);
+}
+
+// Writes at `position` the header of a Chunk record holding `length` bytes
+// after its opcode, which passes the checks of the parallel scan
+void putFakeChunk(std::vector<std::byte>& data, size_t position, uint64_t length,
+                  const std::string& compression)
+{
+    const uint64_t records_size = length - 40 - compression.size();
+    put<uint8_t>(data, position, uint8_t(mcap::OpCode::Chunk));
+    put<uint64_t>(data, position, length);
+    put<uint64_t>(data, position, 1000);
+    put<uint64_t>(data, position, 2000);
+    put<uint64_t>(data, position, compression.empty() ? records_size : records_size * 3);
+    put<uint32_t>(data, position, 0);
+    put<uint32_t>(data, position, uint32_t(compression.size()));
+    for(char c : compression)
+    {
+        put<char>(data, position, c);
+    }
+    put<uint64_t>(data, position, records_size);
+}
+
+// Random bytes with plausible Chunk records every few hundred bytes: small
+// ones, compressed ones, and some running over several MiB of the file
+std::vector<std::byte> fakeChunks(std::mt19937& random, size_t size)
+{
+    std::vector<std::byte> data(size);
+    for(auto& byte : data)
+    {
+        byte = std::byte(random());
+    }
+    static const char* const compressions[] = {"", "", "lz4", "zstd"};
+    for(size_t position = random() % 64; position + 64 < size;
+        position += 128 + random() % 512)
+    {
+        const uint64_t length = random() % 8 == 0 ? 1 * MiB + random() % (6 * MiB)
+                                                   : 48 + random() % 256;
+        putFakeChunk(data, position, length, compressions[random() % 4]);
+    }
+    return data;
+}
+
+void check(const mcap::Status& status)
+{
+    if(!status.ok())
+    {
+        std::printf("failed to write the test file: %s\n", status.message.c_str());
+        std::exit(1);
+    }
+}
+
+struct Case
+{
+    std::string name;
+    std::vector<std::byte> data;
+};
+
+struct FileOptions
+{
+    mcap::Compression compression = mcap::Compression::None;
+    bool chunked = true;
+    uint64_t chunk_size = 1 * MiB;
+    // Message times of the two channels going in opposite directions, so
+    // that every chunk overlaps the others
+    bool overlapping = false;
+    // Attachments and metadata records between the chunks
+    bool attachments = false;
+    uint64_t data_size = 40 * MiB;
+};
+
+Case makeFile(const std::string& name, const FileOptions& options, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::vector<std::vector<std::byte>> payloads;
+    for(int index = 0; index < 8; index++)
+    {
+        payloads.push_back(fakeChunks(random, 16 * 1024 + random() % (64 * 1024)));
+    }
+    // Some messages without fake records, so that some regions start at real
+    // chunks
+    payloads.emplace_back(24 * 1024, std::byte{0x5a});
+
+    mcap::McapWriterOptions writer_options("test");
+    writer_options.compression = options.compression;
+    writer_options.noChunking = !options.chunked;
+    writer_options.chunkSize = options.chunk_size;
+    VectorWriter output;
+    mcap::McapWriter writer;
+    writer.open(output, writer_options);
+    mcap::Schema schema("schema", "raw", "");
+    writer.addSchema(schema);
+    std::vector<mcap::Channel> channels;
+    for(const char* topic : {"/a", "/b", "/c"})
+    {
+        channels.emplace_back(topic, "raw", schema.id);
+        writer.addChannel(channels.back());
+    }
+
+    uint64_t index = 0;
+    while(output.size() < options.data_size)
+    {
+        const auto& payload = payloads[random() % payloads.size()];
+        mcap::Message message;
+        message.channelId = channels[index % channels.size()].id;
+        message.sequence = uint32_t(index);
+        message.logTime = 1'000'000 + index * 1000;
+        if(options.overlapping && index % 2 == 1)
+        {
+            message.logTime = 1'000'000'000'000 - index * 1000;
+        }
+        message.publishTime = message.logTime;
+        message.data = payload.data();
+        message.dataSize = payload.size();
+        check(writer.write(message));
+
+        if(options.attachments && index % 97 == 0)
+        {
+            const auto& content = index % 2 == 0 ? payloads[random() % 8] : payloads.back();
+            mcap::Attachment attachment;
+            attachment.name = "attachment" + std::to_string(index % 5);
+            attachment.mediaType = "application/octet-stream";
+            attachment.logTime = message.logTime;
+            attachment.createTime = message.logTime;
+            attachment.data = content.data();
+            attachment.dataSize = content.size();
+            check(writer.write(attachment));
+        }
+        if(options.attachments && index % 131 == 0)
+        {
+            mcap::Metadata metadata;
+            metadata.name = "metadata" + std::to_string(index % 3);
+            metadata.metadata = {{"index", std::to_string(index)}};
+            check(writer.write(metadata));
+        }
+        index++;
+    }
+    writer.close();
+    return {name, std::move(output.data)};
+}
+
+// Everything the scan finds, to compare as text
+std::string describe(const std::vector<std::byte>& data, unsigned threads)
+{
+    mcap::BufferReader source;
+    source.reset(data.data(), data.size(), data.size());
+    mcap::McapReader reader;
+    std::ostringstream out;
+    auto status = reader.open(source);
+    if(!status.ok())
+    {
+        out << "open: " << int(status.code) << " " << status.message << "\n";
+        return out.str();
+    }
+    reader.setScanThreads(threads);
+    status = reader.readSummary(mcap::ReadSummaryMethod::ForceScan);
+    out << "status: " << int(status.code) << " " << status.message << "\n";
+    out << "data end: " << reader.dataEnd() << "\n";
+
+    std::map<mcap::SchemaId, const mcap::Schema*> schemas;
+    for(const auto& [id, schema] : reader.schemas())
+    {
+        schemas[id] = schema.get();
+    }
+    for(const auto& [id, schema] : schemas)
+    {
+        out << "schema " << id << " " << schema->name << " " << schema->encoding << " "
+            << schema->data.size() << "\n";
+    }
+    std::map<mcap::ChannelId, const mcap::Channel*> channels;
+    for(const auto& [id, channel] : reader.channels())
+    {
+        channels[id] = channel.get();
+    }
+    for(const auto& [id, channel] : channels)
+    {
+        out << "channel " << id << " " << channel->topic << " " << channel->schemaId << "\n";
+    }
+    for(const auto& chunk : reader.chunkIndexes())
+    {
+        out << "chunk " << chunk.chunkStartOffset << " " << chunk.chunkLength << " "
+            << chunk.messageStartTime << " " << chunk.messageEndTime << " "
+            << chunk.messageIndexLength << " " << chunk.compression << " "
+            << chunk.compressedSize << " " << chunk.uncompressedSize << "\n";
+    }
+    for(const auto& [name, attachment] : reader.attachmentIndexes())
+    {
+        out << "attachment " << name << " " << attachment.offset << " " << attachment.length
+            << " " << attachment.logTime << " " << attachment.dataSize << "\n";
+    }
+    for(const auto& [name, metadata] : reader.metadataIndexes())
+    {
+        out << "metadata " << name << " " << metadata.offset << " " << metadata.length << "\n";
+    }
+    if(const auto& statistics = reader.statistics())
+    {
+        out << "statistics " << statistics->messageCount << " " << statistics->schemaCount << " "
+            << statistics->channelCount << " " << statistics->attachmentCount << " "
+            << statistics->metadataCount << " " << statistics->chunkCount << " "
+            << statistics->messageStartTime << " " << statistics->messageEndTime << "\n";
+        const std::map<mcap::ChannelId, uint64_t> counts(
+            statistics->channelMessageCounts.begin(), statistics->channelMessageCounts.end());
+        for(const auto& [id, count] : counts)
+        {
+            out << "messages " << id << " " << count << "\n";
+        }
+    }
+    return out.str();
+}
+
+// The first line that differs, for the report
+std::string firstDifference(const std::string& expected, const std::string& actual)
+{
+    std::istringstream expected_lines(expected);
+    std::istringstream actual_lines(actual);
+    std::string expected_line;
+    std::string actual_line;
+    for(;;)
+    {
+        const bool has_expected = bool(std::getline(expected_lines, expected_line));
+        const bool has_actual = bool(std::getline(actual_lines, actual_line));
+        if(!has_expected && !has_actual)
+        {
+            return {};
+        }
+        if(!has_expected || !has_actual || expected_line != actual_line)
+        {
+            return "expected \"" + (has_expected ? expected_line : "") + "\", found \"" +
+                   (has_actual ? actual_line : "") + "\"";
+        }
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<Case> cases;
+    {
+        FileOptions options;
+        cases.push_back(makeFile("uncompressed chunks", options, 1));
+    }
+    {
+        FileOptions options;
+        options.chunk_size = 64 * 1024;
+        cases.push_back(makeFile("small uncompressed chunks", options, 2));
+    }
+    {
+        FileOptions options;
+        options.chunked = false;
+        cases.push_back(makeFile("unchunked", options, 3));
+    }
+    {
+        FileOptions options;
+        options.overlapping = true;
+        cases.push_back(makeFile("overlapping chunks", options, 4));
+        options.compression = mcap::Compression::Lz4;
+        cases.push_back(makeFile("overlapping lz4 chunks", options, 5));
+    }
+    {
+        FileOptions options;
+        options.attachments = true;
+        cases.push_back(makeFile("attachments and metadata", options, 6));
+        options.compression = mcap::Compression::Zstd;
+        options.overlapping = true;
+        cases.push_back(makeFile("attachments and metadata, zstd chunks", options, 7));
+    }
+
+    // Cut in the middle of records, where the last region ends before the
+    // end of the Data section
+    const size_t complete_cases = cases.size();
+    for(size_t index = 0; index < complete_cases; index++)
+    {
+        for(double fraction : {0.37, 0.61, 0.93})
+        {
+            const auto& complete = cases[index];
+            const size_t size = size_t(double(complete.data.size()) * fraction) + 13;
+            cases.push_back({complete.name + ", truncated at " + std::to_string(size),
+                             {complete.data.begin(), complete.data.begin() + ptrdiff_t(size)}});
+        }
+    }
+
+    int failures = 0;
+    for(const auto& test : cases)
+    {
+        const int previous_failures = failures;
+        const std::string expected = describe(test.data, 1);
+        for(unsigned threads : {2u, 3u, 8u, 16u})
+        {
+            const std::string difference = firstDifference(expected, describe(test.data, threads));
+            if(!difference.empty())
+            {
+                std::printf("FAIL %s, %u threads: %s\n", test.name.c_str(), threads,
+                            difference.c_str());
+                failures++;
+            }
+        }
+        std::printf("%s %s\n", failures == previous_failures ? "ok" : "--", test.name.c_str());
+    }
+    std::printf("%d failures\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,386 @@
+#include "topic_table_model.h"
+
+#include <QDateTime>
+#include <QLocale>
+#include <algorithm>
+
+namespace
+{
+const char* const HEADERS[TopicTableModel::COLUMNS] = {
+    "Topic", "Schema", "Encoding", "Count", "Size", "Rate [Hz]", "Max gap", "Jitter"};
+
+QString formatNanoseconds(double nanoseconds)
+{
+    if(nanoseconds >= 1e9)
+    {
+        return QString("%1 s").arg(nanoseconds / 1e9, 0, 'f', 2);
+    }
+    return QString("%1 ms").arg(nanoseconds / 1e6, 0, 'f', 2);
+}
+
+// Characters that make a filter more than a plain string
+bool isLiteral(const QString& pattern)
+{
+    static const QString special = "\\^$.|?*+()[]{}";
+    return std::none_of(pattern.begin(), pattern.end(),
+                        [](QChar c) { return special.contains(c); });
+}
+}
+
+TopicTableModel::TopicTableModel(QObject *parent) :
+    QAbstractTableModel(parent)
+{
+}
+
+void TopicTableModel::setTopics(std::vector<mcap_editor::TopicInfo> topics,
+                                const mcap_editor::TopicStatsMap& stats)
+{
+    beginResetModel();
+    topics_ = std::move(topics);
+    stats_.clear();
+    if(!stats.empty())
+    {
+        stats_.resize(topics_.size());
+        for(size_t i = 0; i < topics_.size(); i++)
+        {
+            auto it = stats.find(topics_[i].channel_id);
+            if(it != stats.end())
+            {
+                stats_[i] = it->second;
+            }
+        }
+    }
+    checked_.assign(topics_.size(), 1);
+    checked_count_ = topics_.size();
+    names_.clear();
+
+    rows_.clear();
+    rows_.reserve(topics_.size());
+    for(uint32_t i = 0; i < topics_.size(); i++)
+    {
+        if(matches(i))
+        {
+            rows_.push_back(i);
+        }
+    }
+    sortRows(rows_);
+    endResetModel();
+}
+
+void TopicTableModel::clear()
+{
+    setTopics({}, {});
+}
+
+const mcap_editor::TopicInfo& TopicTableModel::topic(int row) const
+{
+    return topics_[rows_[row]];
+}
+
+std::set<mcap::ChannelId> TopicTableModel::checkedChannels() const
+{
+    std::set<mcap::ChannelId> channels;
+    for(size_t i = 0; i < topics_.size(); i++)
+    {
+        if(checked_[i])
+        {
+            channels.insert(channels.end(), topics_[i].channel_id);
+        }
+    }
+    return channels;
+}
+
+bool TopicTableModel::matches(uint32_t topic_index) const
+{
+    if(filter_.pattern().isEmpty())
+    {
+        return true;
+    }
+    if(names_.size() != topics_.size())
+    {
+        names_.resize(topics_.size());
+    }
+    auto& name = names_[topic_index];
+    if(name.isNull())
+    {
+        name = QString::fromStdString(topics_[topic_index].topic);
+    }
+    return filter_.match(name).hasMatch();
+}
+
+bool TopicTableModel::setFilter(const QString& pattern)
+{
+    QRegularExpression filter(pattern, QRegularExpression::CaseInsensitiveOption);
+    if(!filter.isValid())
+    {
+        return false;
+    }
+    // While a plain name is typed, only the rows shown need to be checked again
+    const bool literal = isLiteral(pattern);
+    const bool narrowing = literal && literal_filter_ &&
+                           pattern.contains(filter_.pattern(), Qt::CaseInsensitive);
+    filter_ = std::move(filter);
+    literal_filter_ = literal;
+
+    beginResetModel();
+    if(narrowing)
+    {
+        // Already sorted
+        rows_.erase(std::remove_if(rows_.begin(), rows_.end(),
+                                   [this](uint32_t i) { return !matches(i); }),
+                    rows_.end());
+    }
+    else {
+        rows_.clear();
+        for(uint32_t i = 0; i < topics_.size(); i++)
+        {
+            if(matches(i))
+            {
+                rows_.push_back(i);
+            }
+        }
+        sortRows(rows_);
+    }
+    endResetModel();
+    return true;
+}
+
+void TopicTableModel::setChecked(uint32_t topic_index, bool checked)
+{
+    if(bool(checked_[topic_index]) != checked)
+    {
+        checked_[topic_index] = checked;
+        checked ? checked_count_++ : checked_count_--;
+    }
+}
+
+void TopicTableModel::emitCheckChanged(int first_row, int last_row)
+{
+    if(first_row <= last_row)
+    {
+        emit dataChanged(index(first_row, COLUMN_TOPIC), index(last_row, COLUMN_TOPIC),
+                         {Qt::CheckStateRole});
+    }
+}
+
+void TopicTableModel::setAllChecked(bool checked)
+{
+    for(const auto topic_index: rows_)
+    {
+        setChecked(topic_index, checked);
+    }
+    emitCheckChanged(0, rowCount() - 1);
+}
+
+void TopicTableModel::toggleChecked(const QModelIndexList& rows)
+{
+    int first_row = rowCount();
+    int last_row = -1;
+    for(const auto& index: rows)
+    {
+        if(!index.isValid() || index.row() >= rowCount())
+        {
+            continue;
+        }
+        const auto topic_index = rows_[index.row()];
+        setChecked(topic_index, !checked_[topic_index]);
+        first_row = std::min(first_row, index.row());
+        last_row = std::max(last_row, index.row());
+    }
+    emitCheckChanged(first_row, last_row);
+}
+
+int TopicTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(rows_.size());
+}
+
+int TopicTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : COLUMNS;
+}
+
+QVariant TopicTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= rowCount())
+    {
+        return {};
+    }
+    const auto topic_index = rows_[index.row()];
+    const auto& topic = topics_[topic_index];
+    const int column = index.column();
+
+    if(role == Qt::CheckStateRole && column == COLUMN_TOPIC)
+    {
+        return int(checked_[topic_index] ? Qt::Checked : Qt::Unchecked);
+    }
+    if(role == Qt::TextAlignmentRole && column >= COLUMN_MESSAGES)
+    {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if(role != Qt::DisplayRole && role != Qt::ToolTipRole)
+    {
+        return {};
+    }
+    const bool tool_tip = role == Qt::ToolTipRole;
+
+    switch(column)
+    {
+    case COLUMN_TOPIC:
+        return QString::fromStdString(topic.topic);
+    case COLUMN_SCHEMA:
+        return QString::fromStdString(topic.schema_name);
+    case COLUMN_ENCODING:
+        return QString::fromStdString(topic.message_encoding);
+    case COLUMN_MESSAGES:
+        return tool_tip ? QVariant() : QVariant(QString::number(topic.message_count));
+    }
+
+    // Statistics, see mcap_editor::computeTopicStats
+    if(stats_.empty())
+    {
+        return {};
+    }
+    const auto& stats = stats_[topic_index];
+    const QLocale locale;
+    switch(column)
+    {
+    case COLUMN_SIZE:
+        return tool_tip ? QString("%1 compressed (estimated)")
+                              .arg(locale.formattedDataSize(qint64(stats.compressed_bytes))) :
+                          locale.formattedDataSize(qint64(stats.bytes));
+    case COLUMN_RATE:
+        return tool_tip ? QString("min %1 Hz, max %2 Hz")
+                              .arg(stats.minRate(), 0, 'f', 1)
+                              .arg(stats.maxRate(), 0, 'f', 1) :
+                          QString::number(stats.averageRate(), 'f', 1);
+    case COLUMN_MAX_GAP:
+        return tool_tip ? QString("after %1").arg(
+                              QDateTime::fromMSecsSinceEpoch(qint64(stats.max_gap_start / 1000000))
+                                  .toString("yyyy/M/d - H:mm:ss.zzz")) :
+                          formatNanoseconds(double(stats.max_gap));
+    case COLUMN_JITTER:
+        return tool_tip ? QString("standard deviation of the time between messages, "
+                                  "%1 out of order").arg(qulonglong(stats.out_of_order)) :
+                          formatNanoseconds(stats.jitter);
+    }
+    return {};
+}
+
+QVariant TopicTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation == Qt::Horizontal && role == Qt::DisplayRole &&
+       section >= 0 && section < COLUMNS)
+    {
+        return QString(HEADERS[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+Qt::ItemFlags TopicTableModel::flags(const QModelIndex &index) const
+{
+    auto flags = QAbstractTableModel::flags(index);
+    if(index.isValid() && index.column() == COLUMN_TOPIC)
+    {
+        flags |= Qt::ItemIsUserCheckable;
+    }
+    return flags;
+}
+
+bool TopicTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if(!index.isValid() || index.row() >= rowCount() ||
+       index.column() != COLUMN_TOPIC || role != Qt::CheckStateRole)
+    {
+        return false;
+    }
+    setChecked(rows_[index.row()], value.toInt() == Qt::Checked);
+    emitCheckChanged(index.row(), index.row());
+    return true;
+}
+
+void TopicTableModel::sortRows(std::vector<uint32_t>& rows) const
+{
+    if(sort_column_ < 0)
+    {
+        // Channel id order, as read
+        std::sort(rows.begin(), rows.end());
+        return;
+    }
+    auto number = [this](uint32_t i) -> double
+    {
+        if(sort_column_ == COLUMN_MESSAGES)
+        {
+            return double(topics_[i].message_count);
+        }
+        if(stats_.empty())
+        {
+            return 0;
+        }
+        const auto& stats = stats_[i];
+        switch(sort_column_)
+        {
+        case COLUMN_SIZE: return double(stats.bytes);
+        case COLUMN_RATE: return stats.averageRate();
+        case COLUMN_MAX_GAP: return double(stats.max_gap);
+        case COLUMN_JITTER: return stats.jitter;
+        }
+        return 0;
+    };
+    auto less = [&](uint32_t a, uint32_t b) -> bool
+    {
+        switch(sort_column_)
+        {
+        case COLUMN_TOPIC: return topics_[a].topic < topics_[b].topic;
+        case COLUMN_SCHEMA: return topics_[a].schema_name < topics_[b].schema_name;
+        case COLUMN_ENCODING: return topics_[a].message_encoding < topics_[b].message_encoding;
+        }
+        return number(a) < number(b);
+    };
+    // Rows that compare equal stay in channel id order
+    std::sort(rows.begin(), rows.end());
+    if(sort_order_ == Qt::AscendingOrder)
+    {
+        std::stable_sort(rows.begin(), rows.end(), less);
+    }
+    else {
+        std::stable_sort(rows.begin(), rows.end(),
+                         [&less](uint32_t a, uint32_t b) { return less(b, a); });
+    }
+}
+
+void TopicTableModel::sort(int column, Qt::SortOrder order)
+{
+    if(column < 0 || column >= COLUMNS)
+    {
+        return;
+    }
+    sort_column_ = column;
+    sort_order_ = order;
+
+    // The selection and the current row follow their topic
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    const auto old_indexes = persistentIndexList();
+    std::vector<uint32_t> old_topics;
+    old_topics.reserve(old_indexes.size());
+    for(const auto& index: old_indexes)
+    {
+        old_topics.push_back(rows_[index.row()]);
+    }
+
+    sortRows(rows_);
+
+    std::vector<int> new_rows(topics_.size(), -1);
+    for(size_t row = 0; row < rows_.size(); row++)
+    {
+        new_rows[rows_[row]] = int(row);
+    }
+    QModelIndexList new_indexes;
+    new_indexes.reserve(old_indexes.size());
+    for(int i = 0; i < old_indexes.size(); i++)
+    {
+        new_indexes.append(index(new_rows[old_topics[i]], old_indexes[i].column()));
+    }
+    changePersistentIndexList(old_indexes, new_indexes);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
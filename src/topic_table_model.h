@@ -0,0 +1,100 @@
+#ifndef TOPIC_TABLE_MODEL_H
+#define TOPIC_TABLE_MODEL_H
+
+#include <QAbstractTableModel>
+#include <QRegularExpression>
+#include <QString>
+#include <set>
+#include <vector>
+
+#include "file_info.hpp"
+#include "topic_stats.hpp"
+
+// The topics of a file, one row per channel, for a QTableView.
+// Backed by plain arrays: the text of a cell is only converted to a QString
+// when the view asks for it, so that files with tens of thousands of
+// channels open, filter and save without delay.
+// Rows can be sorted by any column, and filtered by a regular expression on
+// the topic name. Hidden rows keep their check state.
+class TopicTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum Column
+  {
+    COLUMN_TOPIC = 0,
+    COLUMN_SCHEMA,
+    COLUMN_ENCODING,
+    COLUMN_MESSAGES,
+    COLUMN_SIZE,
+    COLUMN_RATE,
+    COLUMN_MAX_GAP,
+    COLUMN_JITTER,
+    COLUMNS
+  };
+
+  explicit TopicTableModel(QObject *parent = nullptr);
+
+  // Every topic starts checked. stats may be empty, which leaves the
+  // statistics columns empty.
+  void setTopics(std::vector<mcap_editor::TopicInfo> topics,
+                 const mcap_editor::TopicStatsMap& stats);
+
+  void clear();
+
+  // The topic shown at row
+  const mcap_editor::TopicInfo& topic(int row) const;
+
+  size_t topicCount() const { return topics_.size(); }
+
+  size_t checkedCount() const { return checked_count_; }
+
+  // Ids of the checked channels, shown or hidden by the filter. Channels
+  // sharing a topic are checked separately.
+  std::set<mcap::ChannelId> checkedChannels() const;
+
+  // Shows only the topics whose name matches pattern, case insensitive. An
+  // empty pattern shows every topic. Returns false, and keeps the current
+  // filter, if pattern is not a valid regular expression.
+  bool setFilter(const QString& pattern);
+
+  // Bulk changes of the rows shown, with one dataChanged() signal
+  void setAllChecked(bool checked);
+  void toggleChecked(const QModelIndexList& rows);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+  QVariant headerData(int section, Qt::Orientation orientation,
+                      int role = Qt::DisplayRole) const override;
+  Qt::ItemFlags flags(const QModelIndex &index) const override;
+  bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+  std::vector<mcap_editor::TopicInfo> topics_;
+  // Same order as topics_, empty without statistics
+  std::vector<mcap_editor::TopicStats> stats_;
+  std::vector<uint8_t> checked_;
+  size_t checked_count_ = 0;
+
+  // Indexes in topics_ of the rows shown, in order
+  std::vector<uint32_t> rows_;
+
+  // Topic names as QString, converted the first time the filter needs them
+  mutable std::vector<QString> names_;
+  QRegularExpression filter_;
+  // The filter is a plain string: a longer one only hides more rows
+  bool literal_filter_ = true;
+
+  int sort_column_ = -1;
+  Qt::SortOrder sort_order_ = Qt::AscendingOrder;
+
+  bool matches(uint32_t topic_index) const;
+  void sortRows(std::vector<uint32_t>& rows) const;
+  void setChecked(uint32_t topic_index, bool checked);
+  void emitCheckChanged(int first_row, int last_row);
+};
+
+#endif // TOPIC_TABLE_MODEL_H